@@ -0,0 +1,547 @@
+// Microbenchmarks for the engine, neighbor counting, rendering and file I/O.
+// Every benchmark runs a few untimed warmup passes and then a number of timed
+// repetitions. The results go out as JSON (per-sample times, percentiles
+// and throughput), so runs from different commits can be diffed or
+// plotted. A short summary table is printed to stderr.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include "AntColony.h"
+#include "Grid.h"
+#include "Highway.h"
+#include "LangtonsAnt.h"
+#include "MacroAnt.h"
+#include "MappedUniverse.h"
+#include "NeighborCounts.h"
+#include "ParallelColony.h"
+#include "PixelRenderer.h"
+#include "SparseUniverse.h"
+#include "Timeline.h"
+#include "Turmite.h"
+#include "UniverseIO.h"
+
+namespace
+{
+    struct Options
+    {
+        int warmup = 2;
+        int repetitions = 10;
+        std::string filter;       // Only run benchmarks whose name contains this
+        std::string outputPath;   // JSON file; stdout when empty
+        std::string label;        // Free-form tag stored in the JSON (e.g. a commit hash)
+    };
+
+    struct Stats
+    {
+        double min = 0, max = 0, mean = 0, stddev = 0;
+        double median = 0, p90 = 0, p99 = 0;
+    };
+
+    struct Result
+    {
+        std::string name;
+        int64_t size = 0;           // Grid size the benchmark ran on
+        std::string unit;           // What work counts (steps, cells, frames, bytes)
+        double workPerRun = 0;      // Units of work done by one repetition
+        std::vector<double> samples;  // Seconds per repetition
+        Stats stats;
+    };
+
+    // Percentile with linear interpolation between the closest ranks
+    double Percentile(const std::vector<double>& sorted, double p)
+    {
+        if (sorted.empty())
+            return 0;
+        const double rank = p / 100.0 * double(sorted.size() - 1);
+        const size_t lower = static_cast<size_t>(rank);
+        const size_t upper = std::min(lower + 1, sorted.size() - 1);
+        const double fraction = rank - double(lower);
+        return sorted[lower] + (sorted[upper] - sorted[lower]) * fraction;
+    }
+
+    Stats ComputeStats(std::vector<double> samples)
+    {
+        Stats stats;
+        if (samples.empty())
+            return stats;
+
+        std::sort(samples.begin(), samples.end());
+        stats.min = samples.front();
+        stats.max = samples.back();
+
+        double sum = 0;
+        for (double s : samples)
+            sum += s;
+        stats.mean = sum / double(samples.size());
+
+        double squares = 0;
+        for (double s : samples)
+            squares += (s - stats.mean) * (s - stats.mean);
+        stats.stddev = samples.size() > 1 ? std::sqrt(squares / double(samples.size() - 1)) : 0.0;
+
+        stats.median = Percentile(samples, 50);
+        stats.p90 = Percentile(samples, 90);
+        stats.p99 = Percentile(samples, 99);
+        return stats;
+    }
+
+    class Runner
+    {
+    public:
+        explicit Runner(const Options& options) : options(options) {}
+
+        bool Enabled(const std::string& name) const
+        {
+            return options.filter.empty() || name.find(options.filter) != std::string::npos;
+        }
+
+        // Times each call of run() after the warmup passes
+        void Measure(const std::string& name, int64_t size, const std::string& unit, double workPerRun,
+            const std::function<void()>& run)
+        {
+            if (!Enabled(name))
+                return;
+
+            Result result;
+            result.name = name;
+            result.size = size;
+            result.unit = unit;
+            result.workPerRun = workPerRun;
+
+            for (int i = 0; i < options.warmup; ++i)
+                run();
+
+            for (int i = 0; i < options.repetitions; ++i)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                run();
+                const auto end = std::chrono::steady_clock::now();
+                result.samples.push_back(std::chrono::duration<double>(end - start).count());
+            }
+
+            result.stats = ComputeStats(result.samples);
+            std::fprintf(stderr, "%-24s size %-6lld median %10.3f ms  p90 %10.3f ms  %14.4g %s/s\n",
+                name.c_str(), static_cast<long long>(size), result.stats.median * 1e3, result.stats.p90 * 1e3,
+                result.stats.median > 0 ? workPerRun / result.stats.median : 0.0, unit.c_str());
+            results.push_back(std::move(result));
+        }
+
+        const std::vector<Result>& Results() const { return results; }
+
+    private:
+        const Options& options;
+        std::vector<Result> results;
+    };
+
+    // About half the cells alive, the same every run. Filled a word at a time
+    // so the 16K grids don't take longer to build than to measure.
+    Grid RandomGrid(int size)
+    {
+        Grid grid(size, size);
+        std::mt19937_64 rng(12345);
+        const int words = (size + 63) >> 6;
+        const int tail = size & 63;
+        for (int r = 0; r < size; ++r)
+        {
+            uint64_t* row = grid.Row(r);
+            for (int w = 0; w < words; ++w)
+                row[w] = rng();
+            if (tail)
+                row[words - 1] &= (uint64_t(1) << tail) - 1;  // Keep the padding dead
+        }
+        return grid;
+    }
+
+    void BenchEngine(Runner& runner)
+    {
+        const int sizes[] = { 15, 100, 1024, 16384 };
+        const uint64_t steps = 4000000;
+
+        for (int size : sizes)
+        {
+            if (!runner.Enabled("engine/grid"))
+                break;
+            Grid grid(size, size);
+            LangtonsAnt ant(size / 2, size / 2);
+            runner.Measure("engine/grid", size, "steps", double(steps),
+                [&] { ant.StepMany(grid, steps); });
+        }
+
+        // The same wrapping grid as engine/grid, in mapped memory with the blocked tile layout
+        for (int size : sizes)
+        {
+            if (!runner.Enabled("engine/mapped"))
+                break;
+            if (size % MappedUniverse::kTileSize != 0)
+                continue;
+            MappedUniverse universe;
+            if (!universe.Create("", size, size))
+                break;
+            LangtonsAnt ant(size / 2, size / 2);
+            runner.Measure("engine/mapped", size, "steps", double(steps),
+                [&] { universe.StepMany(ant, steps); });
+        }
+
+        if (runner.Enabled("engine/plane"))
+        {
+            SparseUniverse plane;
+            LangtonsAnt ant(0, 0);
+            runner.Measure("engine/plane", 0, "steps", double(steps),
+                [&] { ant.StepMany(plane, steps); });
+        }
+
+        // The inverse rule, which should keep up with the forward one
+        if (runner.Enabled("engine/grid_back"))
+        {
+            Grid grid(1024, 1024);
+            LangtonsAnt ant(512, 512);
+            runner.Measure("engine/grid_back", 1024, "steps", double(steps),
+                [&] { ant.StepBackMany(grid, steps); });
+        }
+
+        if (runner.Enabled("engine/plane_back"))
+        {
+            SparseUniverse plane;
+            LangtonsAnt ant(0, 0);
+            runner.Measure("engine/plane_back", 0, "steps", double(steps),
+                [&] { ant.StepBackMany(plane, steps); });
+        }
+
+        // Scrubbing a 10M step plane run: each pass seeks to 16 generations spread over it
+        if (runner.Enabled("engine/timeline_seek"))
+        {
+            const uint64_t runSteps = 10000000;
+            SparseUniverse plane;
+            LangtonsAnt ant(0, 0);
+            Timeline timeline;
+            timeline.Reset(ant, plane, 0);
+            uint64_t generation = 0;
+            while (generation < runSteps)
+            {
+                const uint64_t next = std::min(runSteps, timeline.NextKeyframe(generation));
+                ant.StepMany(plane, next - generation);
+                generation = next;
+                timeline.Record(ant, plane, generation);
+            }
+
+            std::mt19937_64 rng(2024);
+            const int seeks = 16;
+            runner.Measure("engine/timeline_seek", 0, "seeks", double(seeks),
+                [&]
+                {
+                    for (int i = 0; i < seeks; ++i)
+                    {
+                        const uint64_t target = rng() % (runSteps + 1);
+                        timeline.Seek(ant, plane, generation, target);
+                        generation = target;
+                    }
+                });
+        }
+
+        // The same ant with highway fast-forward; past the first ~10000 steps most periods are skipped
+        if (runner.Enabled("engine/plane_highway"))
+        {
+            SparseUniverse plane;
+            LangtonsAnt ant(0, 0);
+            HighwayDetector highway;
+            runner.Measure("engine/plane_highway", 0, "steps", double(steps),
+                [&] { highway.StepMany(ant, plane, steps); });
+        }
+
+        // The memoized quadtree engine; repeated passes mostly replay cached walks
+        if (runner.Enabled("engine/plane_memo"))
+        {
+            MacroAnt macro;
+            runner.Measure("engine/plane_memo", 0, "steps", double(steps),
+                [&] { macro.StepMany(steps); });
+        }
+
+        // Four-color turmite: the compiled-in LLRR kernel against the generic table loop
+        for (bool specialize : { true, false })
+        {
+            const char* name = specialize ? "engine/turmite_llrr" : "engine/turmite_generic";
+            if (!runner.Enabled(name))
+                continue;
+            TurmiteRule rule;
+            ParseTurmiteRule("LLRR", rule);
+            ByteGrid colors(1024, 1024);
+            Turmite turmite(rule, 512, 512, specialize);
+            runner.Measure(name, 1024, "steps", double(steps),
+                [&] { turmite.StepMany(colors, steps); });
+        }
+
+        // 4096 ants scattered over a 1024 grid, one pass per policy; work is counted in ant steps
+        for (CollisionPolicy policy : { CollisionPolicy::Sequential, CollisionPolicy::Simultaneous })
+        {
+            const char* name = policy == CollisionPolicy::Sequential ? "engine/colony_sequential" : "engine/colony_simultaneous";
+            if (!runner.Enabled(name))
+                continue;
+            const int antCount = 4096;
+            const uint64_t generations = steps / antCount;
+            Grid grid(1024, 1024);
+            AntColony colony(policy);
+            std::mt19937_64 rng(777);
+            for (int i = 0; i < antCount; ++i)
+                colony.Add(int64_t(rng() % 1024), int64_t(rng() % 1024), int(rng() & 3));
+            runner.Measure(name, 1024, "steps", double(generations) * antCount,
+                [&] { colony.StepMany(grid, generations); });
+        }
+
+        // The same sequential colony split across every core
+        if (runner.Enabled("engine/colony_parallel"))
+        {
+            const int antCount = 4096;
+            const uint64_t generations = steps / antCount;
+            Grid grid(1024, 1024);
+            AntColony colony;
+            std::mt19937_64 rng(777);
+            for (int i = 0; i < antCount; ++i)
+                colony.Add(int64_t(rng() % 1024), int64_t(rng() % 1024), int(rng() & 3));
+            ParallelColony parallel;
+            runner.Measure("engine/colony_parallel", 1024, "steps", double(generations) * antCount,
+                [&] { parallel.StepMany(colony, grid, generations); });
+        }
+
+        // Change logging as used by the incremental display updates
+        if (runner.Enabled("engine/grid_logged"))
+        {
+            Grid grid(1024, 1024);
+            LangtonsAnt ant(512, 512);
+            std::vector<CellChange> changes;
+            changes.reserve(steps);
+            runner.Measure("engine/grid_logged", 1024, "steps", double(steps),
+                [&] { changes.clear(); ant.StepMany(grid, steps, changes); });
+        }
+    }
+
+    void BenchNeighborCounts(Runner& runner)
+    {
+        // 16K would need a gigabyte of counts, which the panel never keeps for grids that large
+        const int sizes[] = { 15, 100, 1024, 4096 };
+        for (int size : sizes)
+        {
+            if (!runner.Enabled("neighbors/rebuild"))
+                break;
+            const Grid grid = RandomGrid(size);
+            std::vector<int> counts;
+            runner.Measure("neighbors/rebuild", size, "cells", double(size) * size,
+                [&] { CountNeighbors(grid, counts); });
+        }
+    }
+
+    void BenchRender(Runner& runner)
+    {
+        // An 800x800 offscreen RGB frame, like the panel's back buffer at the default window size
+        const int width = 800;
+        const int height = 800;
+        std::vector<uint8_t> pixels(size_t(width) * height * 3);
+        PixelRenderer renderer;
+
+        const int sizes[] = { 100, 1024, 4096, 16384 };
+        for (int size : sizes)
+        {
+            if (!runner.Enabled("render/density") && !runner.Enabled("render/any_alive"))
+                break;
+            const Grid grid = RandomGrid(size);
+            runner.Measure("render/density", size, "frames", 1,
+                [&] { renderer.Render(grid, width, height, pixels.data(), PixelRenderer::Downsample::Density); });
+            runner.Measure("render/any_alive", size, "frames", 1,
+                [&] { renderer.Render(grid, width, height, pixels.data(), PixelRenderer::Downsample::AnyAlive); });
+        }
+
+        // The panel's camera: the whole universe shaded from the density
+        // pyramid, and a zoomed-in corner that reads only the visible cells
+        for (int size : sizes)
+        {
+            if (!runner.Enabled("render/pyramid") && !runner.Enabled("render/viewport"))
+                break;
+            const Grid grid = RandomGrid(size);
+            DensityPyramid pyramid;
+            pyramid.Build(grid);
+            Camera fitted;
+            fitted.Fit(size, size, width, height);
+            runner.Measure("render/pyramid", size, "frames", 1,
+                [&] { renderer.Render(grid, fitted, width, height, pixels.data(), &pyramid); });
+
+            Camera zoomed = fitted;
+            zoomed.ZoomAt(8.0 * size / width, 0.0, 0.0);
+            runner.Measure("render/viewport", size, "frames", 1,
+                [&] { renderer.Render(grid, zoomed, width, height, pixels.data(), &pyramid); });
+        }
+    }
+
+    void BenchFileIO(Runner& runner)
+    {
+        namespace fs = std::filesystem;
+        const std::string path = (fs::temp_directory_path() / "antbench_universe.uni").string();
+
+        const int sizes[] = { 100, 1024, 4096 };
+        for (int size : sizes)
+        {
+            if (!runner.Enabled("io/save") && !runner.Enabled("io/load"))
+                break;
+            const Grid grid = RandomGrid(size);
+            WriteUniverse(path, grid);
+            const double bytes = double(fs::file_size(path));
+
+            runner.Measure("io/save", size, "bytes", bytes,
+                [&] { WriteUniverse(path, grid); });
+
+            Grid loaded;
+            runner.Measure("io/load", size, "bytes", bytes,
+                [&] { ReadUniverse(path, loaded); });
+        }
+
+        std::error_code ignored;
+        fs::remove(path, ignored);
+    }
+
+    // Escapes the characters JSON strings can't hold as-is
+    std::string JsonString(const std::string& text)
+    {
+        std::string out = "\"";
+        for (char ch : text)
+        {
+            if (ch == '"' || ch == '\\')
+            {
+                out += '\\';
+                out += ch;
+            }
+            else if (static_cast<unsigned char>(ch) < 0x20)
+            {
+                char buffer[8];
+                std::snprintf(buffer, sizeof(buffer), "\\u%04x", ch);
+                out += buffer;
+            }
+            else
+            {
+                out += ch;
+            }
+        }
+        return out + "\"";
+    }
+
+    std::string Compiler()
+    {
+#if defined _MSC_VER
+        return "MSVC " + std::to_string(_MSC_VER);
+#elif defined __VERSION__
+        return __VERSION__;
+#else
+        return "unknown";
+#endif
+    }
+
+    void WriteJson(std::FILE* out, const Options& options, const std::vector<Result>& results)
+    {
+        const std::time_t now = std::time(nullptr);
+        char timestamp[32];
+        std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+        std::fprintf(out, "{\n");
+        std::fprintf(out, "  \"schema\": 1,\n");
+        std::fprintf(out, "  \"label\": %s,\n", JsonString(options.label).c_str());
+        std::fprintf(out, "  \"timestamp\": \"%s\",\n", timestamp);
+        std::fprintf(out, "  \"compiler\": %s,\n", JsonString(Compiler()).c_str());
+        std::fprintf(out, "  \"warmup\": %d,\n", options.warmup);
+        std::fprintf(out, "  \"repetitions\": %d,\n", options.repetitions);
+        std::fprintf(out, "  \"benchmarks\": [");
+
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& r = results[i];
+            const Stats& s = r.stats;
+            std::fprintf(out, "%s\n    {\n", i ? "," : "");
+            std::fprintf(out, "      \"name\": %s,\n", JsonString(r.name).c_str());
+            std::fprintf(out, "      \"size\": %lld,\n", static_cast<long long>(r.size));
+            std::fprintf(out, "      \"unit\": %s,\n", JsonString(r.unit).c_str());
+            std::fprintf(out, "      \"work_per_run\": %.17g,\n", r.workPerRun);
+            std::fprintf(out, "      \"seconds\": { \"min\": %.9g, \"median\": %.9g, \"mean\": %.9g, "
+                "\"p90\": %.9g, \"p99\": %.9g, \"max\": %.9g, \"stddev\": %.9g },\n",
+                s.min, s.median, s.mean, s.p90, s.p99, s.max, s.stddev);
+            std::fprintf(out, "      \"throughput_per_second\": %.9g,\n", s.median > 0 ? r.workPerRun / s.median : 0.0);
+            std::fprintf(out, "      \"samples\": [");
+            for (size_t k = 0; k < r.samples.size(); ++k)
+                std::fprintf(out, "%s%.9g", k ? ", " : "", r.samples[k]);
+            std::fprintf(out, "]\n    }");
+        }
+        std::fprintf(out, "\n  ]\n}\n");
+    }
+
+    void PrintUsage(const char* program)
+    {
+        std::printf(
+            "Usage: %s [options]\n"
+            "  --warmup N        Untimed passes before measuring (default 2)\n"
+            "  --reps N          Timed repetitions per benchmark (default 10)\n"
+            "  --filter TEXT     Only run benchmarks whose name contains TEXT\n"
+            "                    (engine/, neighbors/, render/, io/)\n"
+            "  --output FILE     Write the JSON results to FILE instead of stdout\n"
+            "  --label TEXT      Tag stored with the results, e.g. a commit hash\n"
+            "  --help            Show this message\n",
+            program);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0)
+        {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        else if (std::strcmp(arg, "--warmup") == 0 && hasValue)
+            options.warmup = std::max(0, std::atoi(argv[++i]));
+        else if (std::strcmp(arg, "--reps") == 0 && hasValue)
+            options.repetitions = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(arg, "--filter") == 0 && hasValue)
+            options.filter = argv[++i];
+        else if (std::strcmp(arg, "--output") == 0 && hasValue)
+            options.outputPath = argv[++i];
+        else if (std::strcmp(arg, "--label") == 0 && hasValue)
+            options.label = argv[++i];
+        else
+        {
+            std::fprintf(stderr, "Unknown or incomplete option: %s\n", arg);
+            PrintUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    Runner runner(options);
+    BenchEngine(runner);
+    BenchNeighborCounts(runner);
+    BenchRender(runner);
+    BenchFileIO(runner);
+
+    std::FILE* out = stdout;
+    if (!options.outputPath.empty())
+    {
+        out = std::fopen(options.outputPath.c_str(), "w");
+        if (!out)
+        {
+            std::fprintf(stderr, "Failed to open %s\n", options.outputPath.c_str());
+            return 1;
+        }
+    }
+    WriteJson(out, options, runner.Results());
+    if (out != stdout)
+        std::fclose(out);
+    return 0;
+}
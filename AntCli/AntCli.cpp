@@ -0,0 +1,967 @@
+// Headless runner for batch jobs: loads a starting universe, runs the ant at
+// full speed with no UI, prints the speed and final state, and saves the result.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "AntColony.h"
+#include "Checkpoint.h"
+#include "Grid.h"
+#include "Highway.h"
+#include "LangtonsAnt.h"
+#include "MacroAnt.h"
+#include "MappedUniverse.h"
+#include "ParallelColony.h"
+#include "SparseUniverse.h"
+#include "Turmite.h"
+#include "UniverseIO.h"
+
+namespace
+{
+    struct Options
+    {
+        int gridSize = 256;
+        uint64_t steps = 1000000;
+        bool infinitePlane = false;
+        std::string rule = "RL";   // Turmite rule; anything but RL runs the turmite engine
+        CollisionPolicy policy = CollisionPolicy::Sequential;
+        int threads = 1;           // Threads for colonies on the wrapping grid (0 = one per core)
+        bool validate = false;     // Also run the sequential colony update and compare
+        bool fastForward = false;  // Skip highway periods instead of stepping them (single RL ant)
+        bool memo = false;         // Run the memoized quadtree engine (plane, single RL ant)
+        size_t memoBudget = MacroAnt::kDefaultBudget;
+        bool randomFill = false;   // Start from random cells instead of an empty grid
+        uint64_t seed = 0;
+        std::string patternPath;   // Stamped before the run, centered unless patternAt
+        bool patternAt = false;    // Put the pattern's top-left cell at (patternRow, patternCol)
+        int patternRow = 0;
+        int patternCol = 0;
+        std::string universePath;  // Starting universe (sets the grid size)
+        std::string outputPath;    // Where the final universe goes
+        std::string mappedPath;    // File-backed universe to run (and resume) instead of a heap grid
+        std::string checkpointDirectory;  // Where checkpoints go while running (empty = none)
+        uint64_t checkpointSteps = 0;     // Generations between checkpoints
+        uint64_t checkpointSeconds = 0;   // Seconds between checkpoints
+        std::string resumeDirectory;      // Start from the newest checkpoint here
+        bool resumed = false;             // universePath is that checkpoint; steps count from generation 0
+    };
+
+    // Checkpoint interval when --checkpoint gives neither steps nor seconds
+    const uint64_t kDefaultCheckpointSeconds = 60;
+
+    void PrintUsage(const char* program)
+    {
+        std::printf(
+            "Usage: %s [options]\n"
+            "  --size N          Grid size (default 256, ignored with --universe; up to\n"
+            "                    16777216 with --mapped, a multiple of 64)\n"
+            "  --steps N         Number of ant steps to run (default 1000000)\n"
+            "  --plane           Run on the unbounded plane instead of the wrapping grid\n"
+            "  --rule RULE       Turmite rule: a turn string like LLRR or a state table\n"
+            "                    like {{{1,8,1},{1,8,1}},{{1,2,1},{0,1,0}}} (default RL)\n"
+            "  --pattern FILE    Pattern to place in the center before the run (plain text\n"
+            "                    or RLE); its ant markers (^ > v <) replace the single center ant\n"
+            "  --pattern-at R,C  Place the pattern's top-left cell at row R, column C instead\n"
+            "  --policy NAME     How ants sharing a cell step: sequential (default) or simultaneous\n"
+            "  --threads N       Split a colony on the wrapping grid across N threads\n"
+            "                    (0 = one per core, default 1)\n"
+            "  --fast-forward    Skip the periods of a highway instead of stepping them (single ant)\n"
+            "  --memo            Run the memoized engine for very long runs (needs --plane, single ant)\n"
+            "  --memo-budget MB  Memory for the memoized engine's cache (default 256)\n"
+            "  --validate        With --threads, --fast-forward or --memo, rerun step by step\n"
+            "                    on one thread and check the results match\n"
+            "  --random SEED     Fill the size x size start area with random cells\n"
+            "  --universe FILE   Universe file to start from (with its ants and generation)\n"
+            "  --output FILE     Save the final universe (the size x size view in plane mode)\n"
+            "  --mapped FILE     Run a single ant on a universe kept in a memory-mapped file,\n"
+            "                    for grids larger than memory. An existing file resumes from\n"
+            "                    its saved ant and generation, and is synced after the run\n"
+            "  --checkpoint DIR  Save the universe to DIR in the background while running\n"
+            "                    (default every 60 s), and once more at the end. The newest\n"
+            "                    3 are kept\n"
+            "  --checkpoint-steps N    Checkpoint every N generations\n"
+            "  --checkpoint-seconds T  Checkpoint every T seconds\n"
+            "  --resume DIR      Start from the newest checkpoint in DIR that loads, or from\n"
+            "                    scratch if there is none. --steps then counts from generation\n"
+            "                    0, so rerunning the same command finishes the same run\n"
+            "  --help            Show this message\n",
+            program);
+    }
+
+    bool ParseNumber(const char* text, uint64_t& value)
+    {
+        char* end = nullptr;
+        value = std::strtoull(text, &end, 10);
+        return end != text && *end == '\0';
+    }
+
+    // Returns false (after printing why) if the arguments can't be used
+    bool ParseOptions(int argc, char** argv, Options& options, bool& showHelp)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const char* arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            uint64_t number = 0;
+
+            if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0)
+            {
+                showHelp = true;
+            }
+            else if (std::strcmp(arg, "--plane") == 0)
+            {
+                options.infinitePlane = true;
+            }
+            else if (std::strcmp(arg, "--fast-forward") == 0)
+            {
+                options.fastForward = true;
+            }
+            else if (std::strcmp(arg, "--memo") == 0)
+            {
+                options.memo = true;
+            }
+            else if (std::strcmp(arg, "--memo-budget") == 0 && hasValue)
+            {
+                if (!ParseNumber(argv[++i], number) || number < 1 || number > (uint64_t(1) << 20))
+                {
+                    std::fprintf(stderr, "Invalid memory budget: %s\n", argv[i]);
+                    return false;
+                }
+                options.memoBudget = size_t(number) << 20;
+            }
+            else if (std::strcmp(arg, "--random") == 0 && hasValue)
+            {
+                if (!ParseNumber(argv[++i], number))
+                {
+                    std::fprintf(stderr, "Invalid seed: %s\n", argv[i]);
+                    return false;
+                }
+                options.randomFill = true;
+                options.seed = number;
+            }
+            else if (std::strcmp(arg, "--validate") == 0)
+            {
+                options.validate = true;
+            }
+            else if (std::strcmp(arg, "--threads") == 0 && hasValue)
+            {
+                if (!ParseNumber(argv[++i], number) || number > 1024)
+                {
+                    std::fprintf(stderr, "Invalid thread count: %s\n", argv[i]);
+                    return false;
+                }
+                options.threads = static_cast<int>(number);
+            }
+            else if (std::strcmp(arg, "--size") == 0 && hasValue)
+            {
+                if (!ParseNumber(argv[++i], number) || number < 1 || number > (uint64_t(1) << 24))
+                {
+                    std::fprintf(stderr, "Grid size must be between 1 and 16777216\n");
+                    return false;
+                }
+                options.gridSize = static_cast<int>(number);
+            }
+            else if (std::strcmp(arg, "--steps") == 0 && hasValue)
+            {
+                if (!ParseNumber(argv[++i], number))
+                {
+                    std::fprintf(stderr, "Invalid step count: %s\n", argv[i]);
+                    return false;
+                }
+                options.steps = number;
+            }
+            else if (std::strcmp(arg, "--rule") == 0 && hasValue)
+            {
+                options.rule = argv[++i];
+            }
+            else if (std::strcmp(arg, "--policy") == 0 && hasValue)
+            {
+                const char* name = argv[++i];
+                if (std::strcmp(name, "sequential") == 0)
+                    options.policy = CollisionPolicy::Sequential;
+                else if (std::strcmp(name, "simultaneous") == 0)
+                    options.policy = CollisionPolicy::Simultaneous;
+                else
+                {
+                    std::fprintf(stderr, "Unknown collision policy: %s\n", name);
+                    return false;
+                }
+            }
+            else if (std::strcmp(arg, "--pattern") == 0 && hasValue)
+            {
+                options.patternPath = argv[++i];
+            }
+            else if (std::strcmp(arg, "--pattern-at") == 0 && hasValue)
+            {
+                char extra;
+                if (std::sscanf(argv[++i], "%d,%d%c", &options.patternRow, &options.patternCol, &extra) != 2)
+                {
+                    std::fprintf(stderr, "Invalid pattern position: %s (expected ROW,COL)\n", argv[i]);
+                    return false;
+                }
+                options.patternAt = true;
+            }
+            else if (std::strcmp(arg, "--universe") == 0 && hasValue)
+            {
+                options.universePath = argv[++i];
+            }
+            else if (std::strcmp(arg, "--output") == 0 && hasValue)
+            {
+                options.outputPath = argv[++i];
+            }
+            else if (std::strcmp(arg, "--mapped") == 0 && hasValue)
+            {
+                options.mappedPath = argv[++i];
+            }
+            else if (std::strcmp(arg, "--checkpoint") == 0 && hasValue)
+            {
+                options.checkpointDirectory = argv[++i];
+            }
+            else if (std::strcmp(arg, "--checkpoint-steps") == 0 && hasValue)
+            {
+                if (!ParseNumber(argv[++i], options.checkpointSteps) || options.checkpointSteps == 0)
+                {
+                    std::fprintf(stderr, "Invalid checkpoint interval: %s\n", argv[i]);
+                    return false;
+                }
+            }
+            else if (std::strcmp(arg, "--checkpoint-seconds") == 0 && hasValue)
+            {
+                if (!ParseNumber(argv[++i], options.checkpointSeconds) || options.checkpointSeconds == 0)
+                {
+                    std::fprintf(stderr, "Invalid checkpoint interval: %s\n", argv[i]);
+                    return false;
+                }
+            }
+            else if (std::strcmp(arg, "--resume") == 0 && hasValue)
+            {
+                options.resumeDirectory = argv[++i];
+            }
+            else
+            {
+                std::fprintf(stderr, "Unknown or incomplete option: %s\n", arg);
+                return false;
+            }
+        }
+        if (options.mappedPath.empty() && options.gridSize > kMaxUniverseSide)
+        {
+            std::fprintf(stderr, "Grid size must be between 1 and %d (larger grids need --mapped)\n", kMaxUniverseSide);
+            return false;
+        }
+        return true;
+    }
+
+    const char* DirectionName(int direction)
+    {
+        static const char* const names[] = { "up", "right", "down", "left" };
+        return names[direction & 3];
+    }
+
+    // The saved ants, then the pattern's ants, moved by the same offset as its
+    // cells and clipped to the grid; a single ant in the center when there are none
+    AntColony PlaceAnts(const Options& options, const AntColony& savedAnts, const std::vector<AntPlacement>& patternAnts,
+        int n, int startRow, int startCol)
+    {
+        AntColony colony(options.policy);
+        for (size_t i = 0; i < savedAnts.Size(); ++i)
+            colony.Add(savedAnts.GetRow(i), savedAnts.GetCol(i), savedAnts.GetDirection(i), savedAnts.GetState(i));
+        if (!options.infinitePlane)
+            colony.Wrap(n, n);
+        for (const AntPlacement& ant : patternAnts)
+        {
+            const int64_t row = startRow + ant.row;
+            const int64_t col = startCol + ant.col;
+            if (options.infinitePlane || (row >= 0 && row < n && col >= 0 && col < n))
+                colony.Add(row, col, ant.direction);
+        }
+        if (colony.Empty())
+            colony.Add(n / 2, n / 2);
+        return colony;
+    }
+
+    bool SameAnts(const AntColony& a, const AntColony& b)
+    {
+        if (a.Size() != b.Size())
+            return false;
+        for (size_t i = 0; i < a.Size(); ++i)
+        {
+            if (a.GetRow(i) != b.GetRow(i) || a.GetCol(i) != b.GetCol(i) ||
+                a.GetDirection(i) != b.GetDirection(i) || a.GetState(i) != b.GetState(i))
+                return false;
+        }
+        return true;
+    }
+
+    // Reads --universe; the grid must be square, as the app only saves square grids.
+    // A plane file run on the plane can have any shape, as it's a window of the plane.
+    // A resumed run only has the steps left to reach --steps to go.
+    bool LoadStart(Options& options, UniverseState& universe)
+    {
+        if (!ReadUniverse(options.universePath, universe))
+        {
+            std::fprintf(stderr, "Failed to load universe from %s\n", options.universePath.c_str());
+            return false;
+        }
+        const int rows = std::max(universe.cells.Rows(), universe.colors.Rows());
+        const int cols = std::max(universe.cells.Cols(), universe.colors.Cols());
+        const bool window = options.infinitePlane && universe.info.infinitePlane;
+        if (universe.plane.TileCount() > 0 && !options.infinitePlane)
+        {
+            std::fprintf(stderr, "Universe %s is a plane stored as tiles; run it with --plane\n", options.universePath.c_str());
+            return false;
+        }
+        if (universe.plane.TileCount() == 0 && (rows == 0 || (rows != cols && !window)))
+        {
+            std::fprintf(stderr, "Universe %s is %d x %d; only square grids can be run\n", options.universePath.c_str(), rows, cols);
+            return false;
+        }
+        if (options.resumed)
+        {
+            std::printf("Resumed:       %s (generation %llu)\n", options.universePath.c_str(),
+                static_cast<unsigned long long>(universe.info.generation));
+            options.steps = options.steps > universe.info.generation ? options.steps - universe.info.generation : 0;
+        }
+        return true;
+    }
+
+    // --checkpoint: the background writer, or nullptr without one
+    std::unique_ptr<Checkpointer> MakeCheckpointer(const Options& options)
+    {
+        if (options.checkpointDirectory.empty())
+            return nullptr;
+        CheckpointConfig config;
+        config.directory = options.checkpointDirectory;
+        config.everySteps = options.checkpointSteps;
+        config.everySeconds = double(options.checkpointSeconds);
+        if (config.everySteps == 0 && config.everySeconds == 0.0)
+            config.everySeconds = double(kDefaultCheckpointSeconds);
+        return std::make_unique<Checkpointer>(config);
+    }
+
+    // Runs steps through step(n) in slices, handing the universe to the
+    // checkpointer whenever one is due and once more at the end. capture fills
+    // everything but the generation. Without a checkpointer it's a single call.
+    template <typename Step, typename Capture>
+    void RunCheckpointed(Checkpointer* checkpointer, uint64_t generation, uint64_t steps, Step step, Capture capture)
+    {
+        if (!checkpointer)
+        {
+            step(steps);
+            return;
+        }
+
+        auto submit = [&](uint64_t at)
+        {
+            UniverseState& state = checkpointer->Buffer();
+            state.info.generation = at;
+            capture(state);
+            checkpointer->Submit();
+        };
+        checkpointer->Restart(generation);
+        uint64_t done = 0;
+        while (done < steps)
+        {
+            const uint64_t slice = std::min(steps - done, checkpointer->NextSlice(generation + done));
+            step(slice);
+            done += slice;
+            if (done < steps && checkpointer->Due(generation + done))
+                submit(generation + done);
+        }
+        submit(generation + steps);
+    }
+
+    // Waits for the last checkpoint and reports; false if any failed
+    bool FinishCheckpoints(Checkpointer* checkpointer)
+    {
+        if (!checkpointer)
+            return true;
+        checkpointer->Finish();
+        std::printf("Checkpoints:   %llu written to %s\n", static_cast<unsigned long long>(checkpointer->Written()),
+            checkpointer->Config().directory.c_str());
+        if (checkpointer->Failed() > 0)
+        {
+            std::fprintf(stderr, "%llu checkpoints could not be written to %s\n",
+                static_cast<unsigned long long>(checkpointer->Failed()), checkpointer->Config().directory.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // Top-left cell of the pattern: --pattern-at, or centered like the app does it
+    void PlacePattern(const Options& options, const Grid& pattern, int n, int& row, int& col)
+    {
+        row = options.patternAt ? options.patternRow : (n - pattern.Rows()) / 2;
+        col = options.patternAt ? options.patternCol : (n - pattern.Cols()) / 2;
+    }
+
+    // A lone ant, as the checkpoints of the single-ant engines hold it
+    void SetAnt(UniverseState& state, const LangtonsAnt& ant)
+    {
+        state.ants.Clear();
+        state.ants.Add(ant.GetRow(), ant.GetCol(), ant.GetDirection());
+    }
+
+    // --validate: runs the single-threaded, step-by-step update from the same start and compares
+    template <typename Cells, typename Step>
+    bool Validate(const Cells& startCells, const AntColony& startColony, const Cells& cells,
+        const AntColony& colony, Step step)
+    {
+        Cells expectedCells = startCells;
+        AntColony expectedColony = startColony;
+        step(expectedColony, expectedCells);
+        const bool same = expectedCells == cells && SameAnts(expectedColony, colony);
+        std::printf("Validation:    %s\n", same ? "matches the single-threaded, step-by-step run" : "MISMATCH");
+        return same;
+    }
+
+    // The grid's living cells, as the plane's window whose top-left cell is (row0, col0)
+    void FillPlane(const Grid& grid, int64_t row0, int64_t col0, SparseUniverse& plane)
+    {
+        for (int r = 0; r < grid.Rows(); ++r)
+            for (int c = 0; c < grid.Cols(); ++c)
+                if (grid.Get(r, c))
+                    plane.Set(row0 + r, col0 + c, true);
+    }
+
+    bool SamePlane(const SparseUniverse& a, const SparseUniverse& b)
+    {
+        // Tiles missing on one side must be all dead on the other
+        auto covers = [](const SparseUniverse& x, const SparseUniverse& y) {
+            bool same = true;
+            x.ForEachTile([&](int64_t tileRow, int64_t tileCol, const SparseUniverse::Tile& tile) {
+                const SparseUniverse::Tile* other = y.FindTile(tileRow, tileCol);
+                for (int r = 0; r < SparseUniverse::kTileSize && same; ++r)
+                    same = tile.rows[r] == (other ? other->rows[r] : 0);
+            });
+            return same;
+        };
+        return covers(a, b) && covers(b, a);
+    }
+
+    // The plane has no copy constructor, as copies are rarely wanted
+    void CopyPlane(const SparseUniverse& from, SparseUniverse& to)
+    {
+        from.ForEachTile([&](int64_t tileRow, int64_t tileCol, const SparseUniverse::Tile& tile) {
+            *to.GetOrCreateTile(tileRow, tileCol) = tile;
+        });
+    }
+
+    // --validate on the plane: steps expected, a copy of the start, and compares
+    bool ValidatePlane(SparseUniverse& expected, const AntColony& startColony,
+        const SparseUniverse& plane, const AntColony& colony, uint64_t steps)
+    {
+        AntColony expectedColony = startColony;
+        expectedColony.StepMany(expected, steps);
+        const bool same = SamePlane(expected, plane) && SameAnts(expectedColony, colony);
+        std::printf("Validation:    %s\n", same ? "matches the single-threaded, step-by-step run" : "MISMATCH");
+        return same;
+    }
+
+    void PrintAnts(const char* label, const AntColony& colony)
+    {
+        std::printf("%-15srow %lld, col %lld, facing %s", label,
+            static_cast<long long>(colony.GetRow(0)), static_cast<long long>(colony.GetCol(0)),
+            DirectionName(colony.GetDirection(0)));
+        if (colony.Size() > 1)
+            std::printf(" (first of %zu)", colony.Size());
+        std::printf("\n");
+    }
+
+    // Multi-color rules: same flow as Langton's ant, on a grid of color bytes
+    int RunTurmite(Options& options, const TurmiteRule& rule)
+    {
+        ByteGrid colors;
+        UniverseState saved;
+        int n = options.gridSize;
+        if (!options.universePath.empty())
+        {
+            if (!LoadStart(options, saved))
+                return 1;
+            colors = saved.colors.Rows() > 0 ? std::move(saved.colors) : CellsToColors(saved.cells);
+            n = colors.Rows();
+
+            // Saved states past the rule's table start over in state 0
+            AntColony ants;
+            for (size_t i = 0; i < saved.ants.Size(); ++i)
+            {
+                const int state = saved.ants.GetState(i) < rule.states ? saved.ants.GetState(i) : 0;
+                ants.Add(saved.ants.GetRow(i), saved.ants.GetCol(i), saved.ants.GetDirection(i), state);
+            }
+            saved.ants = std::move(ants);
+
+            // Colors the rule doesn't have would index past its table
+            for (int r = 0; r < n; ++r)
+                for (int c = 0; c < n; ++c)
+                    if (colors.Row(r)[c] >= rule.colors)
+                        colors.Row(r)[c] = 0;
+        }
+        else
+        {
+            colors = ByteGrid(n, n);
+        }
+
+        std::vector<AntPlacement> patternAnts;
+        int startRow = 0;
+        int startCol = 0;
+        if (!options.patternPath.empty() && !options.resumed)
+        {
+            Grid pattern;
+            if (!ReadPattern(options.patternPath, pattern, patternAnts))
+            {
+                std::fprintf(stderr, "Failed to load pattern from %s\n", options.patternPath.c_str());
+                return 1;
+            }
+
+            // Living pattern cells become color 1, clipped to the grid
+            PlacePattern(options, pattern, n, startRow, startCol);
+            for (int r = 0; r < pattern.Rows(); ++r)
+            {
+                for (int c = 0; c < pattern.Cols(); ++c)
+                {
+                    const int gridR = startRow + r;
+                    const int gridC = startCol + c;
+                    if (gridR >= 0 && gridR < n && gridC >= 0 && gridC < n)
+                        colors.Row(gridR)[gridC] = pattern.Get(r, c) ? 1 : 0;
+                }
+            }
+        }
+
+        AntColony colony = PlaceAnts(options, saved.ants, patternAnts, n, startRow, startCol);
+        const Turmite turmite(rule, 0, 0);  // Only asked which kernel the rule gets
+        const bool validate = options.validate && options.threads != 1;
+        const ByteGrid startColors = validate ? colors : ByteGrid();
+        const AntColony startColony = colony;
+
+        ParallelColony parallel(options.threads);
+        std::unique_ptr<Checkpointer> checkpointer = MakeCheckpointer(options);
+        const auto start = std::chrono::steady_clock::now();
+        RunCheckpointed(checkpointer.get(), saved.info.generation, options.steps,
+            [&](uint64_t slice) { parallel.StepMany(colony, colors, rule, slice); },
+            [&](UniverseState& state)
+            {
+                state.info.rule = rule;
+                state.ants = colony;
+                CaptureColors(colors, state);
+            });
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const double stepsPerSecond = seconds > 0.0 ? double(options.steps) * double(colony.Size()) / seconds : 0.0;  // Ant steps
+        std::printf("Mode:          turmite %s (%s kernel)\n", rule.ToString().c_str(),
+            turmite.IsSpecialized() ? "compiled" : "generic");
+        std::printf("Grid size:     %d\n", n);
+        if (parallel.ThreadCount() > 1)
+            std::printf("Threads:       %d\n", parallel.ThreadCount());
+        std::printf("Steps:         %llu\n", static_cast<unsigned long long>(options.steps));
+        std::printf("Elapsed:       %.3f s\n", seconds);
+        std::printf("Steps/second:  %.0f\n", stepsPerSecond);
+        PrintAnts("Turmite:", colony);
+        if (!FinishCheckpoints(checkpointer.get()))
+            return 1;
+        if (validate && !Validate(startColors, startColony, colors, colony,
+            [&](AntColony& c, ByteGrid& g) { c.StepMany(g, rule, options.steps); }))
+            return 1;
+
+        uint64_t histogram[kMaxTurmiteColors] = {};
+        for (int r = 0; r < n; ++r)
+            for (int c = 0; c < n; ++c)
+                ++histogram[colors.Row(r)[c]];
+        for (int color = 0; color < rule.colors; ++color)
+        {
+            std::printf("Color %-2d       %llu (%.2f%%)\n", color, static_cast<unsigned long long>(histogram[color]),
+                100.0 * double(histogram[color]) / (double(n) * n));
+        }
+
+        if (!options.outputPath.empty())
+        {
+            UniverseInfo info;
+            info.rule = rule;
+            info.generation = saved.info.generation + options.steps;
+            if (!WriteUniverse(options.outputPath, colors, colony, info))
+            {
+                std::fprintf(stderr, "Failed to save universe to %s\n", options.outputPath.c_str());
+                return 1;
+            }
+            std::printf("Saved:         %s\n", options.outputPath.c_str());
+        }
+        return 0;
+    }
+
+    // --mapped: a single Langton's ant on a file-backed universe. An existing
+    // file picks up where its last sync left off; otherwise a new one is made.
+    int RunMapped(const Options& options)
+    {
+        MappedUniverse universe;
+        const bool resumed = universe.Open(options.mappedPath);
+        if (!resumed && !universe.Create(options.mappedPath, options.gridSize, options.gridSize))
+        {
+            std::fprintf(stderr, "Failed to map %s (the size must be a multiple of 64)\n", options.mappedPath.c_str());
+            return 1;
+        }
+
+        LangtonsAnt ant = universe.SavedAnt();
+        const uint64_t startGeneration = universe.SavedGeneration();
+        const int64_t n = universe.Rows();
+
+        // Validation steps a heap grid alongside, so it needs one that fits
+        const bool validate = options.validate && n <= kMaxUniverseSide;
+        Grid startGrid;
+        if (validate)
+        {
+            startGrid = Grid(static_cast<int>(n), static_cast<int>(n));
+            universe.CopyRegion(0, 0, startGrid);
+        }
+        const LangtonsAnt startAnt = ant;
+
+        const auto start = std::chrono::steady_clock::now();
+        universe.StepMany(ant, options.steps);
+        const bool synced = universe.Sync(ant, startGeneration + options.steps);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const double stepsPerSecond = seconds > 0.0 ? double(options.steps) / seconds : 0.0;
+        std::printf("Mode:          mapped file%s\n", resumed ? " (resumed)" : "");
+        std::printf("Grid size:     %lld\n", static_cast<long long>(n));
+        std::printf("Steps:         %llu\n", static_cast<unsigned long long>(options.steps));
+        std::printf("Elapsed:       %.3f s (with the final sync)\n", seconds);
+        std::printf("Steps/second:  %.0f\n", stepsPerSecond);
+        std::printf("Generation:    %llu\n", static_cast<unsigned long long>(startGeneration + options.steps));
+        std::printf("Mapped:        %zu bytes\n", universe.MappedBytes());
+        std::printf("Ant:           row %lld, col %lld, facing %s\n", static_cast<long long>(ant.GetRow()),
+            static_cast<long long>(ant.GetCol()), DirectionName(ant.GetDirection()));
+        if (!synced)
+        {
+            std::fprintf(stderr, "Failed to sync %s\n", options.mappedPath.c_str());
+            return 1;
+        }
+
+        if (validate)
+        {
+            Grid expected = startGrid;
+            LangtonsAnt expectedAnt = startAnt;
+            expectedAnt.StepMany(expected, options.steps);
+            Grid cells(static_cast<int>(n), static_cast<int>(n));
+            universe.CopyRegion(0, 0, cells);
+            const bool same = cells == expected && expectedAnt.GetRow() == ant.GetRow() &&
+                expectedAnt.GetCol() == ant.GetCol() && expectedAnt.GetDirection() == ant.GetDirection();
+            std::printf("Validation:    %s\n", same ? "matches the step-by-step run on a heap grid" : "MISMATCH");
+            if (!same)
+                return 1;
+        }
+
+        if (!options.outputPath.empty())
+        {
+            if (n > kMaxUniverseSide)
+            {
+                std::fprintf(stderr, "A %lld grid is too large for a universe file\n", static_cast<long long>(n));
+                return 1;
+            }
+            Grid cells(static_cast<int>(n), static_cast<int>(n));
+            universe.CopyRegion(0, 0, cells);
+            AntColony colony;
+            colony.Add(ant.GetRow(), ant.GetCol(), ant.GetDirection());
+            UniverseInfo info;
+            info.generation = startGeneration + options.steps;
+            if (!WriteUniverse(options.outputPath, cells, colony, info))
+            {
+                std::fprintf(stderr, "Failed to save universe to %s\n", options.outputPath.c_str());
+                return 1;
+            }
+            std::printf("Saved:         %s\n", options.outputPath.c_str());
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    bool showHelp = false;
+    if (!ParseOptions(argc, argv, options, showHelp))
+    {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+    if (showHelp)
+    {
+        PrintUsage(argv[0]);
+        return 0;
+    }
+
+    TurmiteRule rule;
+    if (!ParseTurmiteRule(options.rule, rule))
+    {
+        std::fprintf(stderr, "Invalid rule: %s\n", options.rule.c_str());
+        return 2;
+    }
+    if (!options.mappedPath.empty())
+    {
+        if (!rule.IsLangtonsAnt() || options.infinitePlane || !options.patternPath.empty() || !options.universePath.empty())
+        {
+            std::fprintf(stderr, "--mapped runs a single Langton's ant on the wrapping grid; drop --rule, --plane, --pattern and --universe\n");
+            return 2;
+        }
+        if (!options.checkpointDirectory.empty() || !options.resumeDirectory.empty())
+        {
+            std::fprintf(stderr, "--mapped keeps its state in the file itself; drop --checkpoint and --resume\n");
+            return 2;
+        }
+        return RunMapped(options);
+    }
+
+    // A checkpoint found takes the place of --universe; the cells it holds already have the pattern and random fill
+    if (!options.resumeDirectory.empty())
+    {
+        if (!options.universePath.empty())
+        {
+            std::fprintf(stderr, "--resume picks the universe to start from; drop --universe\n");
+            return 2;
+        }
+        options.universePath = Checkpointer::FindLatest(options.resumeDirectory);
+        options.resumed = !options.universePath.empty();
+        if (!options.resumed)
+            std::printf("Resumed:       nothing to resume in %s; starting over\n", options.resumeDirectory.c_str());
+    }
+    if (!rule.IsLangtonsAnt())
+    {
+        if (options.infinitePlane)
+            std::fprintf(stderr, "Turmite rules run on the wrapping grid; ignoring --plane\n");
+        options.infinitePlane = false;
+        return RunTurmite(options, rule);
+    }
+
+    // Starting state: a universe file (with its ants and generation), or an empty grid of the requested size.
+    // A plane file run on the plane is a window of the plane with its own origin; --size stays the view size.
+    // A plane stored as tiles keeps them for the plane, and the grid is only the view.
+    Grid grid;
+    UniverseState saved;
+    if (!options.universePath.empty() && !LoadStart(options, saved))
+        return 1;
+    const bool tiled = saved.plane.TileCount() > 0;
+    if (!options.universePath.empty() && !tiled)
+    {
+        grid = saved.cells.Rows() > 0 ? std::move(saved.cells) : ColorsToCells(saved.colors);
+        if (!options.infinitePlane || !saved.info.infinitePlane)
+        {
+            options.gridSize = grid.Rows();
+            saved.info.originRow = 0;
+            saved.info.originCol = 0;
+        }
+    }
+    else
+    {
+        grid = Grid(options.gridSize, options.gridSize);
+    }
+
+    const int n = options.gridSize;
+    const int64_t originRow = saved.info.originRow;
+    const int64_t originCol = saved.info.originCol;
+    const bool isView = originRow == 0 && originCol == 0 && grid.Rows() == n && grid.Cols() == n && !tiled;
+    if (options.resumed)
+    {
+        options.randomFill = false;
+        options.patternPath.clear();
+    }
+    if ((options.randomFill || !options.patternPath.empty()) && !isView)
+    {
+        std::fprintf(stderr, "This plane universe isn't a %d x %d view; --random and --pattern can't be placed on it\n", n, n);
+        return 2;
+    }
+    if (options.randomFill)
+    {
+        std::mt19937_64 rng(options.seed);
+        for (int r = 0; r < n; ++r)
+            for (int c = 0; c < n; ++c)
+                grid.Set(r, c, (rng() & 1) != 0);
+    }
+
+    std::vector<AntPlacement> patternAnts;
+    int startRow = 0;
+    int startCol = 0;
+    if (!options.patternPath.empty())
+    {
+        Grid pattern;
+        if (!ReadPattern(options.patternPath, pattern, patternAnts))
+        {
+            std::fprintf(stderr, "Failed to load pattern from %s\n", options.patternPath.c_str());
+            return 1;
+        }
+
+        // Clipped to the grid
+        PlacePattern(options, pattern, n, startRow, startCol);
+        grid.Paste(pattern, startRow, startCol);
+    }
+
+    // In plane mode the grid becomes the plane's window at its origin ([0, size) unless loaded), as in the app
+    SparseUniverse plane;
+    if (tiled)
+        plane = std::move(saved.plane);
+    else if (options.infinitePlane)
+        FillPlane(grid, originRow, originCol, plane);
+
+    // A lone ant runs LangtonsAnt's loop, so the colony costs nothing in the common case
+    AntColony colony = PlaceAnts(options, saved.ants, patternAnts, n, startRow, startCol);
+    if (options.memo && !options.infinitePlane)
+    {
+        std::fprintf(stderr, "The memoized engine runs on the plane; add --plane\n");
+        return 2;
+    }
+    const bool memo = options.memo && colony.Size() == 1;
+    const bool fastForward = options.fastForward && colony.Size() == 1 && !memo;
+    const bool validate = options.validate && (options.threads != 1 || fastForward || memo);
+    const Grid startGrid = validate && !options.infinitePlane ? grid : Grid();
+    SparseUniverse startPlane;
+    if (validate && options.infinitePlane)
+        CopyPlane(plane, startPlane);
+    const AntColony startColony = colony;
+    if ((options.fastForward || options.memo) && colony.Size() != 1)
+        std::fprintf(stderr, "%s needs a single ant; stepping normally\n", options.memo ? "The memoized engine" : "Fast-forward");
+
+    // Colonies on the wrapping grid can be split across threads; the plane is always single-threaded
+    ParallelColony parallel(options.infinitePlane ? 1 : options.threads);
+    HighwayDetector highway;
+    MacroAnt macro(memo ? options.memoBudget : 0);
+    std::unique_ptr<Checkpointer> checkpointer = MakeCheckpointer(options);
+    auto capture = [&](UniverseState& state)
+    {
+        state.info.rule = rule;
+        if (options.infinitePlane)
+            CapturePlane(plane, n, state);
+        else
+            CaptureCells(grid, state);
+    };
+    const auto start = std::chrono::steady_clock::now();
+    if (memo)
+    {
+        // The plane is only rebuilt from the quadtree when it's needed, as a long run can leave billions of cells
+        macro.Load(plane, LangtonsAnt(colony.GetRow(0), colony.GetCol(0), colony.GetDirection(0)));
+        RunCheckpointed(checkpointer.get(), saved.info.generation, options.steps,
+            [&](uint64_t slice) { macro.StepMany(slice); },
+            [&](UniverseState& state)
+            {
+                SparseUniverse stored;
+                macro.Store(stored);
+                SetAnt(state, macro.GetAnt());
+                state.info.rule = rule;
+                CapturePlane(stored, n, state);
+            });
+        const LangtonsAnt ant = macro.GetAnt();
+        colony.Clear();
+        colony.Add(ant.GetRow(), ant.GetCol(), ant.GetDirection());
+    }
+    else if (fastForward)
+    {
+        LangtonsAnt ant(colony.GetRow(0), colony.GetCol(0), colony.GetDirection(0));
+        RunCheckpointed(checkpointer.get(), saved.info.generation, options.steps,
+            [&](uint64_t slice)
+            {
+                if (options.infinitePlane)
+                    highway.StepMany(ant, plane, slice);
+                else
+                    highway.StepMany(ant, grid, slice);
+            },
+            [&](UniverseState& state)
+            {
+                SetAnt(state, ant);
+                capture(state);
+            });
+        colony.Clear();
+        colony.Add(ant.GetRow(), ant.GetCol(), ant.GetDirection());
+    }
+    else
+    {
+        RunCheckpointed(checkpointer.get(), saved.info.generation, options.steps,
+            [&](uint64_t slice)
+            {
+                if (options.infinitePlane)
+                    colony.StepMany(plane, slice);
+                else
+                    parallel.StepMany(colony, grid, slice);
+            },
+            [&](UniverseState& state)
+            {
+                state.ants = colony;
+                capture(state);
+            });
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const double stepsPerSecond = seconds > 0.0 ? double(options.steps) * double(colony.Size()) / seconds : 0.0;  // Ant steps
+    std::printf("Mode:          %s\n", options.infinitePlane ? "infinite plane" : "wrapping grid");
+    std::printf("Grid size:     %d\n", n);
+    if (parallel.ThreadCount() > 1)
+        std::printf("Threads:       %d\n", parallel.ThreadCount());
+    std::printf("Steps:         %llu\n", static_cast<unsigned long long>(options.steps));
+    std::printf("Elapsed:       %.3f s\n", seconds);
+    std::printf("Steps/second:  %.0f\n", stepsPerSecond);
+    if (fastForward)
+    {
+        std::printf("Skipped:       %llu steps", static_cast<unsigned long long>(highway.SkippedSteps()));
+        if (highway.Period() > 0)
+            std::printf(" (highway of period %d moving %lld, %lld)", highway.Period(),
+                static_cast<long long>(highway.DeltaRow()), static_cast<long long>(highway.DeltaCol()));
+        std::printf("\n");
+    }
+    if (memo)
+    {
+        std::printf("Cache:         %llu hits, %llu misses, %llu evictions, %llu collections\n",
+            static_cast<unsigned long long>(macro.Hits()), static_cast<unsigned long long>(macro.Misses()),
+            static_cast<unsigned long long>(macro.Evictions()), static_cast<unsigned long long>(macro.Collections()));
+        std::printf("Nodes:         %zu, %zu cached walks (%zu bytes)\n", macro.NodeCount(), macro.CachedWalks(), macro.MemoryBytes());
+    }
+    PrintAnts("Ant:", colony);
+    if (!FinishCheckpoints(checkpointer.get()))
+        return 1;
+    if (validate && memo)
+        macro.Store(plane);
+    if (validate && options.infinitePlane && !ValidatePlane(startPlane, startColony, plane, colony, options.steps))
+        return 1;
+    if (validate && !options.infinitePlane && !Validate(startGrid, startColony, grid, colony,
+        [&](AntColony& c, Grid& g) { c.StepMany(g, options.steps); }))
+        return 1;
+
+    if (memo)
+    {
+        std::printf("Living cells:  %llu\n", static_cast<unsigned long long>(macro.CountAlive()));
+    }
+    else if (options.infinitePlane)
+    {
+        std::printf("Living cells:  %llu\n", static_cast<unsigned long long>(plane.CountAlive()));
+        std::printf("Tiles:         %zu (%zu bytes)\n", plane.TileCount(), plane.MemoryBytes());
+    }
+    else
+    {
+        const uint64_t alive = grid.CountAlive();
+        std::printf("Living cells:  %llu of %llu (%.2f%%)\n",
+            static_cast<unsigned long long>(alive),
+            static_cast<unsigned long long>(uint64_t(n) * n),
+            100.0 * double(alive) / (double(n) * n));
+    }
+
+    if (!options.outputPath.empty())
+    {
+        if (options.infinitePlane && (grid.Rows() != n || grid.Cols() != n))
+            grid = Grid(n, n);
+        if (memo)
+            macro.CopyRegion(0, 0, grid);
+        else if (options.infinitePlane)
+            plane.CopyRegion(0, 0, grid);
+
+        UniverseInfo info;
+        info.generation = saved.info.generation + options.steps;
+        info.infinitePlane = options.infinitePlane;
+        if (!WriteUniverse(options.outputPath, grid, colony, info))
+        {
+            std::fprintf(stderr, "Failed to save universe to %s\n", options.outputPath.c_str());
+            return 1;
+        }
+        std::printf("Saved:         %s\n", options.outputPath.c_str());
+    }
+
+    return 0;
+}
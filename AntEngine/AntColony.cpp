@@ -0,0 +1,279 @@
+// Implements the colony step loops
+
+#include "AntColony.h"
+
+namespace
+{
+    // Cell access and movement on the wrapping grid
+    struct WrappingCells
+    {
+        Grid& grid;
+
+        bool Get(int64_t r, int64_t c) const { return grid.Get(static_cast<int>(r), static_cast<int>(c)); }
+        bool Flip(int64_t r, int64_t c) { return grid.Flip(static_cast<int>(r), static_cast<int>(c)); }
+
+        // Moves one cell in direction d and wraps around the edges without using modulo
+        void Move(int64_t& r, int64_t& c, int d) const
+        {
+            const int64_t rowCount = grid.Rows();
+            const int64_t colCount = grid.Cols();
+            r += kRowDelta[d];
+            c += kColDelta[d];
+            r += rowCount & -int64_t(r < 0);
+            r -= rowCount & -int64_t(r >= rowCount);
+            c += colCount & -int64_t(c < 0);
+            c -= colCount & -int64_t(c >= colCount);
+        }
+    };
+
+    // Cell access and movement on the unbounded plane
+    struct PlaneCells
+    {
+        SparseUniverse& universe;
+
+        bool Get(int64_t r, int64_t c) const { return universe.Get(r, c); }
+        bool Flip(int64_t r, int64_t c) { return universe.Flip(r, c); }
+
+        void Move(int64_t& r, int64_t& c, int d) const
+        {
+            r += kRowDelta[d];
+            c += kColDelta[d];
+        }
+    };
+}
+
+AntColony::AntColony(CollisionPolicy policy)
+    : policy(policy)
+{
+}
+
+void AntColony::Add(int64_t row, int64_t col, int direction, int state)
+{
+    rows.push_back(row);
+    cols.push_back(col);
+    dirs.push_back(uint8_t(direction & 3));
+    states.push_back(uint8_t(state));
+}
+
+bool AntColony::RemoveAt(int64_t row, int64_t col)
+{
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        if (rows[i] == row && cols[i] == col)
+        {
+            rows.erase(rows.begin() + i);
+            cols.erase(cols.begin() + i);
+            dirs.erase(dirs.begin() + i);
+            states.erase(states.begin() + i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void AntColony::Clear()
+{
+    rows.clear();
+    cols.clear();
+    dirs.clear();
+    states.clear();
+}
+
+void AntColony::Wrap(int rowCount, int colCount)
+{
+    if (rowCount <= 0 || colCount <= 0)
+        return;
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        rows[i] = ((rows[i] % rowCount) + rowCount) % rowCount;
+        cols[i] = ((cols[i] % colCount) + colCount) % colCount;
+    }
+}
+
+void AntColony::Shift(int64_t rowOffset, int64_t colOffset)
+{
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        rows[i] += rowOffset;
+        cols[i] += colOffset;
+    }
+}
+
+void AntColony::StepMany(Grid& grid, uint64_t n)
+{
+    if (grid.Rows() == 0 || grid.Cols() == 0 || RunSingle<false>(grid, n, nullptr))
+        return;
+    Run<false>(WrappingCells{ grid }, n, nullptr);
+}
+
+void AntColony::StepMany(SparseUniverse& universe, uint64_t n)
+{
+    if (!RunSingle<false>(universe, n, nullptr))
+        Run<false>(PlaneCells{ universe }, n, nullptr);
+}
+
+void AntColony::StepMany(Grid& grid, uint64_t n, std::vector<CellChange>& changes)
+{
+    if (grid.Rows() == 0 || grid.Cols() == 0 || RunSingle<true>(grid, n, &changes))
+        return;
+    Run<true>(WrappingCells{ grid }, n, &changes);
+}
+
+void AntColony::StepMany(SparseUniverse& universe, uint64_t n, std::vector<CellChange>& changes)
+{
+    if (!RunSingle<true>(universe, n, &changes))
+        Run<true>(PlaneCells{ universe }, n, &changes);
+}
+
+// A lone ant has nothing to collide with, so it takes LangtonsAnt's tight loop
+template <bool Record, typename Storage>
+bool AntColony::RunSingle(Storage& cells, uint64_t n, std::vector<CellChange>* changes)
+{
+    if (rows.size() != 1)
+        return false;
+
+    LangtonsAnt ant(rows[0], cols[0], dirs[0]);
+    if (Record)
+        ant.StepMany(cells, n, *changes);
+    else
+        ant.StepMany(cells, n);
+
+    rows[0] = ant.GetRow();
+    cols[0] = ant.GetCol();
+    dirs[0] = uint8_t(ant.GetDirection());
+    return true;
+}
+
+template <bool Record, typename Cells>
+void AntColony::Run(Cells cells, uint64_t n, std::vector<CellChange>* changes)
+{
+    const size_t count = rows.size();
+    int64_t* antRows = rows.data();
+    int64_t* antCols = cols.data();
+    uint8_t* antDirs = dirs.data();
+
+    if (policy == CollisionPolicy::Sequential)
+    {
+        for (uint64_t generation = 0; generation < n; ++generation)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                const bool cell = cells.Flip(antRows[i], antCols[i]);  // Flip, remembering the old color
+                if (Record)
+                    changes->push_back(CellChange{ antRows[i], antCols[i], !cell });
+
+                const int d = (antDirs[i] + kTurn[cell]) & 3;  // Turn right on white, left on black
+                antDirs[i] = uint8_t(d);
+                cells.Move(antRows[i], antCols[i], d);
+            }
+        }
+        return;
+    }
+
+    seen.resize(count);
+    uint8_t* read = seen.data();
+    for (uint64_t generation = 0; generation < n; ++generation)
+    {
+        // Everyone reads before anyone writes
+        for (size_t i = 0; i < count; ++i)
+            read[i] = cells.Get(antRows[i], antCols[i]);
+
+        // Then every ant flips its cell, in index order
+        for (size_t i = 0; i < count; ++i)
+        {
+            const bool old = cells.Flip(antRows[i], antCols[i]);
+            if (Record)
+                changes->push_back(CellChange{ antRows[i], antCols[i], !old });
+        }
+
+        // Turn and move: no memory is shared between ants here
+        for (size_t i = 0; i < count; ++i)
+        {
+            const int d = (antDirs[i] + 1 + 2 * read[i]) & 3;
+            antDirs[i] = uint8_t(d);
+            cells.Move(antRows[i], antCols[i], d);
+        }
+    }
+}
+
+void AntColony::StepMany(ByteGrid& colors, const TurmiteRule& rule, uint64_t n)
+{
+    if (colors.Rows() == 0 || colors.Cols() == 0 || rows.empty())
+        return;
+
+    // A lone turmite takes Turmite's kernels (compiled ones for the well-known rules)
+    if (rows.size() == 1)
+    {
+        Turmite turmite(rule, rows[0], cols[0]);
+        turmite.SetPosition(Turmite::Position{ rows[0], cols[0], dirs[0], states[0] });
+        turmite.StepMany(colors, n);
+
+        const Turmite::Position& position = turmite.GetPosition();
+        rows[0] = position.row;
+        cols[0] = position.col;
+        dirs[0] = uint8_t(position.dir);
+        states[0] = uint8_t(position.state);
+        return;
+    }
+
+    const int64_t rowCount = colors.Rows();
+    const int64_t colCount = colors.Cols();
+    uint8_t* cells = colors.Data();
+    const size_t stride = colors.StrideWords();
+    const size_t count = rows.size();
+
+    auto move = [&](size_t i, int d) {
+        int64_t r = rows[i] + kRowDelta[d];
+        int64_t c = cols[i] + kColDelta[d];
+        r += rowCount & -int64_t(r < 0);
+        r -= rowCount & -int64_t(r >= rowCount);
+        c += colCount & -int64_t(c < 0);
+        c -= colCount & -int64_t(c >= colCount);
+        rows[i] = r;
+        cols[i] = c;
+    };
+
+    if (policy == CollisionPolicy::Sequential)
+    {
+        for (uint64_t generation = 0; generation < n; ++generation)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                uint8_t& cell = cells[size_t(rows[i]) * stride + size_t(cols[i])];
+                const TurmiteTransition& t = rule.table[states[i]][cell];
+                cell = t.write;
+                states[i] = t.next;
+                const int d = (dirs[i] + t.turn) & 3;
+                dirs[i] = uint8_t(d);
+                move(i, d);
+            }
+        }
+        return;
+    }
+
+    // Simultaneous: all ants read, then recolor their cells in index order. Each
+    // recoloring starts from the color the cell has by then, so for RL two ants
+    // on one cell flip it twice, as on bit cells.
+    seen.resize(count);
+    for (uint64_t generation = 0; generation < n; ++generation)
+    {
+        for (size_t i = 0; i < count; ++i)
+            seen[i] = cells[size_t(rows[i]) * stride + size_t(cols[i])];
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint8_t& cell = cells[size_t(rows[i]) * stride + size_t(cols[i])];
+            cell = rule.table[states[i]][cell].write;
+        }
+
+        // The turn and next state come from the color each ant read
+        for (size_t i = 0; i < count; ++i)
+        {
+            const TurmiteTransition& t = rule.table[states[i]][seen[i]];
+            states[i] = t.next;
+            const int d = (dirs[i] + t.turn) & 3;
+            dirs[i] = uint8_t(d);
+            move(i, d);
+        }
+    }
+}
@@ -0,0 +1,100 @@
+// Defines AntColony, any number of ants sharing one universe. The ants are
+// stored as a structure of arrays (rows, columns, directions and states in
+// separate contiguous vectors), so one generation is a pass over flat arrays
+// instead of a walk over ant objects.
+//
+// Every ant takes one step per generation. When several ants stand on the
+// same cell, the CollisionPolicy decides what each of them sees:
+//   Sequential   - ants move one after another in index order; an ant sees
+//                  the flips of lower-index ants made in the same generation.
+//   Simultaneous - every ant turns by the color its cell had at the start of
+//                  the generation. The cells are then recolored in index order,
+//                  each ant starting from the color left by the ant before it
+//                  (two Langton's ants on one cell flip it back). The turn and
+//                  move run as a separate branch-free pass the compiler can vectorize.
+// A colony of one ant gives exactly the same result as LangtonsAnt or Turmite.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Grid.h"
+#include "LangtonsAnt.h"
+#include "SparseUniverse.h"
+#include "Turmite.h"
+
+enum class CollisionPolicy : uint8_t
+{
+    Sequential,
+    Simultaneous
+};
+
+// Where an ant goes when it is placed (by a click or from a pattern file)
+struct AntPlacement
+{
+    int64_t row, col;
+    int direction;  // 0 = up, 1 = right, 2 = down, 3 = left
+};
+
+class AntColony
+{
+public:
+    explicit AntColony(CollisionPolicy policy = CollisionPolicy::Sequential);
+
+    // Appends an ant; ants step in the order they were added
+    void Add(int64_t row, int64_t col, int direction = 0, int state = 0);
+
+    // Removes the lowest-index ant on the cell, keeping the others in order.
+    // Returns false if no ant stands there.
+    bool RemoveAt(int64_t row, int64_t col);
+
+    void Clear();
+
+    // Moves ants that fell outside a rows x cols grid (after a resize) back inside by wrapping
+    void Wrap(int rows, int cols);
+
+    // Moves every ant by the same offset (the cells moved by a resize)
+    void Shift(int64_t rowOffset, int64_t colOffset);
+
+    size_t Size() const { return rows.size(); }
+    bool Empty() const { return rows.empty(); }
+
+    CollisionPolicy GetPolicy() const { return policy; }
+    void SetPolicy(CollisionPolicy newPolicy) { policy = newPolicy; }
+
+    int64_t GetRow(size_t i) const { return rows[i]; }
+    int64_t GetCol(size_t i) const { return cols[i]; }
+    int GetDirection(size_t i) const { return dirs[i]; }
+    int GetState(size_t i) const { return states[i]; }
+
+    // Langton's ant (RL) on bit cells: n generations on a wrapping grid or the unbounded plane
+    void StepMany(Grid& grid, uint64_t n);
+    void StepMany(SparseUniverse& universe, uint64_t n);
+
+    // Same, with every flipped cell appended to changes (in the order the flips happened)
+    void StepMany(Grid& grid, uint64_t n, std::vector<CellChange>& changes);
+    void StepMany(SparseUniverse& universe, uint64_t n, std::vector<CellChange>& changes);
+
+    // Any turmite rule on a wrapping grid of colors. Every cell must hold a
+    // color below the rule's color count, and every state must be below its state count.
+    void StepMany(ByteGrid& colors, const TurmiteRule& rule, uint64_t n);
+
+private:
+    friend class ParallelColony;  // Splits the arrays into stripes and writes them back
+
+    template <bool Record, typename Cells>
+    void Run(Cells cells, uint64_t n, std::vector<CellChange>* changes);
+    template <bool Record, typename Storage>
+    bool RunSingle(Storage& cells, uint64_t n, std::vector<CellChange>* changes);
+
+    CollisionPolicy policy;
+
+    // One entry per ant, all the same length
+    std::vector<int64_t> rows;
+    std::vector<int64_t> cols;
+    std::vector<uint8_t> dirs;
+    std::vector<uint8_t> states;   // Turmite state; always 0 for Langton's ant
+
+    std::vector<uint8_t> seen;     // Scratch: the cell each ant read this generation (simultaneous policy)
+};
@@ -0,0 +1,58 @@
+// Implements the cell-to-pixel camera
+
+#include "Camera.h"
+#include <algorithm>
+#include <cmath>
+
+void Camera::Fit(int64_t rows, int64_t cols, int width, int height)
+{
+    if (rows <= 0 || cols <= 0 || width <= 0 || height <= 0)
+        return;
+
+    scale = std::min(double(width) / double(cols), double(height) / double(rows));
+    scale = std::min(scale, kMaxScale);
+    minScale = scale / 4.0;
+    CenterOn(rows / 2.0, cols / 2.0, width, height);
+}
+
+void Camera::ZoomAt(double factor, double x, double y)
+{
+    const double row = RowAt(y);
+    const double col = ColAt(x);
+    scale = std::clamp(scale * factor, std::min(minScale, kMaxScale), kMaxScale);
+    top = row - y / scale;
+    left = col - x / scale;
+}
+
+void Camera::Pan(double dx, double dy)
+{
+    left -= dx / scale;
+    top -= dy / scale;
+}
+
+void Camera::CenterOn(double row, double col, int width, int height)
+{
+    top = row - height / (2.0 * scale);
+    left = col - width / (2.0 * scale);
+}
+
+bool Camera::CellAt(double x, double y, int64_t rows, int64_t cols, int64_t& row, int64_t& col) const
+{
+    const double r = std::floor(RowAt(y));
+    const double c = std::floor(ColAt(x));
+    if (r < 0.0 || c < 0.0 || r >= double(rows) || c >= double(cols))
+        return false;
+    row = static_cast<int64_t>(r);
+    col = static_cast<int64_t>(c);
+    return true;
+}
+
+CellRange Camera::Visible(int width, int height, int64_t rows, int64_t cols) const
+{
+    CellRange range;
+    range.row0 = std::clamp<int64_t>(static_cast<int64_t>(std::floor(RowAt(0.0))), 0, rows);
+    range.col0 = std::clamp<int64_t>(static_cast<int64_t>(std::floor(ColAt(0.0))), 0, cols);
+    range.row1 = std::clamp<int64_t>(static_cast<int64_t>(std::ceil(RowAt(height))), 0, rows);
+    range.col1 = std::clamp<int64_t>(static_cast<int64_t>(std::ceil(ColAt(width))), 0, cols);
+    return range;
+}
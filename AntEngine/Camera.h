@@ -0,0 +1,57 @@
+// Defines Camera, the mapping between universe cells and view pixels used
+// for zooming and panning. Cell coordinates are continuous: cell (r, c)
+// covers [r, r + 1) x [c, c + 1), and pixel (x, y) shows the point
+// (Top() + y / Scale(), Left() + x / Scale()). Hit tests floor that point,
+// so they stay exact when a cell is smaller than a pixel.
+
+#pragma once
+
+#include <cstdint>
+
+// A rectangle of cells, [row0, row1) x [col0, col1)
+struct CellRange
+{
+    int64_t row0 = 0, col0 = 0;
+    int64_t row1 = 0, col1 = 0;
+
+    bool Empty() const { return row0 >= row1 || col0 >= col1; }
+};
+
+class Camera
+{
+public:
+    static constexpr double kMaxScale = 64.0;  // Pixels per cell, zoomed all the way in
+
+    // Shows the whole rows x cols universe in a width x height view, centered
+    void Fit(int64_t rows, int64_t cols, int width, int height);
+
+    // Multiplies the scale by factor, keeping the point under pixel (x, y) in place.
+    // Zooming out stops at a quarter of the fitted scale.
+    void ZoomAt(double factor, double x, double y);
+
+    // Moves the view by (dx, dy) pixels; the cells follow the mouse
+    void Pan(double dx, double dy);
+
+    // Puts the point (row, col) in the middle of a width x height view
+    void CenterOn(double row, double col, int width, int height);
+
+    double Scale() const { return scale; }
+    double Top() const { return top; }
+    double Left() const { return left; }
+
+    double RowAt(double y) const { return top + y / scale; }
+    double ColAt(double x) const { return left + x / scale; }
+    double YOf(double row) const { return (row - top) * scale; }
+    double XOf(double col) const { return (col - left) * scale; }
+
+    // Cell under pixel (x, y); false when it falls outside the rows x cols universe
+    bool CellAt(double x, double y, int64_t rows, int64_t cols, int64_t& row, int64_t& col) const;
+
+    // The cells a width x height view touches, clipped to the rows x cols universe
+    CellRange Visible(int width, int height, int64_t rows, int64_t cols) const;
+
+private:
+    double top = 0.0, left = 0.0;  // Cell coordinates of the view's top-left corner
+    double scale = 1.0;            // Pixels per cell
+    double minScale = 0.0;         // Set by Fit
+};
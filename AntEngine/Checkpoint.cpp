@@ -0,0 +1,249 @@
+// Implements the background checkpoint writer
+
+#include "Checkpoint.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <vector>
+#if defined _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // With only a time interval, the simulation checks the clock this often
+    const uint64_t kTimeSlice = uint64_t(1) << 20;
+
+    const char kExtension[] = ".uni";
+    const char kTempExtension[] = ".uni.tmp";
+
+    // Flushes a written file to the disk, so a rename can't expose a file whose data is still cached
+    bool SyncFile(const fs::path& path)
+    {
+#if defined _WIN32
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        const bool synced = FlushFileBuffers(file) != 0;
+        CloseHandle(file);
+        return synced;
+#else
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        const bool synced = fsync(fd) == 0;
+        close(fd);
+        return synced;
+#endif
+    }
+
+    // Makes a rename in the directory durable (Windows has no equivalent; MoveFileEx is enough there)
+    void SyncDirectory(const fs::path& directory)
+    {
+#if !defined _WIN32
+        const int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0)
+            return;
+        fsync(fd);
+        close(fd);
+#else
+        (void)directory;
+#endif
+    }
+
+    const size_t kDigits = 20;
+
+    // The numbers are zero-padded, so the names sort in sequence order
+    std::string FileName(const std::string& prefix, uint64_t sequence, uint64_t generation)
+    {
+        char digits[48];
+        std::snprintf(digits, sizeof(digits), "-%020llu-%020llu", static_cast<unsigned long long>(sequence),
+            static_cast<unsigned long long>(generation));
+        return prefix + digits + kExtension;
+    }
+
+    // True for <prefix>-<20 digits>-<20 digits><extension>
+    bool Matches(const std::string& name, const std::string& prefix, const std::string& extension)
+    {
+        if (name.size() != prefix.size() + 2 * (kDigits + 1) + extension.size() || name.compare(0, prefix.size(), prefix) != 0
+            || name.compare(name.size() - extension.size(), extension.size(), extension) != 0)
+            return false;
+        for (size_t i = prefix.size(); i < prefix.size() + 2 * (kDigits + 1); ++i)
+        {
+            const bool dash = (i - prefix.size()) % (kDigits + 1) == 0;
+            if (dash ? name[i] != '-' : (name[i] < '0' || name[i] > '9'))
+                return false;
+        }
+        return true;
+    }
+
+    uint64_t SequenceOf(const fs::path& path, const std::string& prefix)
+    {
+        return std::strtoull(path.filename().string().c_str() + prefix.size() + 1, nullptr, 10);
+    }
+
+    // Checkpoints (or leftover temporary files) with this prefix in directory, oldest first
+    std::vector<fs::path> List(const std::string& directory, const std::string& prefix, const char* extension)
+    {
+        std::vector<fs::path> found;
+        std::error_code error;
+        for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+        {
+            if (Matches(it->path().filename().string(), prefix, extension))
+                found.push_back(it->path());
+        }
+        std::sort(found.begin(), found.end());
+        return found;
+    }
+}
+
+Checkpointer::Checkpointer(const CheckpointConfig& checkpointConfig)
+    : config(checkpointConfig), lastTime(std::chrono::steady_clock::now())
+{
+    if (config.keep < 1)
+        config.keep = 1;
+
+    // On from the newest checkpoint already there, even one cut short
+    for (const char* extension : { kExtension, kTempExtension })
+    {
+        const std::vector<fs::path> found = List(config.directory, config.prefix, extension);
+        if (!found.empty())
+            sequence = std::max(sequence, SequenceOf(found.back(), config.prefix) + 1);
+    }
+    thread = std::thread(&Checkpointer::Run, this);
+}
+
+Checkpointer::~Checkpointer()
+{
+    Finish();
+}
+
+void Checkpointer::Finish()
+{
+    if (!thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void Checkpointer::Restart(uint64_t generation)
+{
+    lastGeneration = generation;
+    lastTime = std::chrono::steady_clock::now();
+}
+
+bool Checkpointer::Due(uint64_t generation) const
+{
+    if (config.everySteps > 0 && generation >= lastGeneration + config.everySteps)
+        return true;
+    if (config.everySeconds > 0.0)
+    {
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - lastTime;
+        return elapsed.count() >= config.everySeconds;
+    }
+    return false;
+}
+
+uint64_t Checkpointer::NextSlice(uint64_t generation) const
+{
+    uint64_t slice = UINT64_MAX;
+    if (config.everySteps > 0)
+    {
+        const uint64_t next = lastGeneration + config.everySteps;
+        slice = next > generation ? next - generation : 1;
+    }
+    if (config.everySeconds > 0.0)
+        slice = std::min(slice, kTimeSlice);
+    return slice;
+}
+
+void Checkpointer::Submit()
+{
+    Restart(buffers.Back().info.generation);
+    buffers.Publish();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+    wake.notify_one();
+}
+
+std::string Checkpointer::FindLatest(const std::string& directory, const std::string& prefix)
+{
+    std::vector<fs::path> found = List(directory, prefix, kExtension);
+    UniverseState state;
+    for (auto it = found.rbegin(); it != found.rend(); ++it)
+    {
+        if (ReadUniverse(it->string(), state))
+            return it->string();
+    }
+    return std::string();
+}
+
+void Checkpointer::Run()
+{
+    Trace().NameThread("Checkpoint writer");
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || buffers.Pending(); });
+            if (stopping && !buffers.Pending())
+                return;
+        }
+        buffers.Consume();
+        const bool saved = Write(buffers.Front());
+        (saved ? written : failed).fetch_add(1, std::memory_order_relaxed);
+        failing.store(!saved, std::memory_order_relaxed);
+    }
+}
+
+bool Checkpointer::Write(const UniverseState& state)
+{
+    ANT_TRACE_SCOPE("Checkpoint write");
+    std::error_code error;
+    fs::create_directories(config.directory, error);
+
+    const fs::path target = fs::path(config.directory) / FileName(config.prefix, sequence++, state.info.generation);
+    fs::path temp = target;
+    temp += ".tmp";
+
+    if (!WriteUniverse(temp.string(), state) || !SyncFile(temp))
+    {
+        fs::remove(temp, error);
+        return false;
+    }
+    fs::rename(temp, target, error);
+    if (error)
+    {
+        fs::remove(temp, error);
+        return false;
+    }
+    SyncDirectory(config.directory);
+    Prune();
+    return true;
+}
+
+void Checkpointer::Prune()
+{
+    std::error_code error;
+    const std::vector<fs::path> found = List(config.directory, config.prefix, kExtension);
+    for (size_t i = 0; i + size_t(config.keep) < found.size(); ++i)
+        fs::remove(found[i], error);
+
+    // Temporary files left by a run that died mid-write
+    for (const fs::path& stale : List(config.directory, config.prefix, kTempExtension))
+        fs::remove(stale, error);
+}
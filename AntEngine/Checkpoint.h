@@ -0,0 +1,87 @@
+// Defines Checkpointer, which saves the universe every N steps or T seconds
+// without stalling the simulation. The simulation thread copies its state
+// into a spare buffer and hands it over through a TripleBuffer; a writer
+// thread saves it to a temporary file, flushes it to disk and renames it
+// into place, so a checkpoint that exists is always complete. If the writer
+// falls behind, a newer state replaces the one still waiting.
+//
+// Checkpoints are universe files named <prefix>-<sequence>-<generation>.uni
+// in one directory. The sequence counts the checkpoints written there, on
+// from the highest one found, so it orders them by when they were written:
+// a run restarted at a lower generation (a new run, a loaded file, a seek)
+// is still the newest. Only the newest few are kept. FindLatest returns the
+// newest one that reads back; the file checksum catches a damaged one.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "TripleBuffer.h"
+#include "UniverseIO.h"
+
+struct CheckpointConfig
+{
+    std::string directory = "checkpoints";
+    std::string prefix = "checkpoint";
+    uint64_t everySteps = 0;     // Generations between checkpoints (0 = not by steps)
+    double everySeconds = 0.0;   // Seconds between checkpoints (0 = not by time)
+    int keep = 3;                // Newest checkpoints kept on disk
+};
+
+class Checkpointer
+{
+public:
+    explicit Checkpointer(const CheckpointConfig& config);
+    ~Checkpointer();  // Calls Finish
+
+    // Writes the checkpoint still waiting, then stops the thread (Submit must not follow)
+    void Finish();
+
+    const CheckpointConfig& Config() const { return config; }
+
+    // Simulation thread: counts the next interval from this generation and from now
+    void Restart(uint64_t generation);
+
+    // Simulation thread: true once the interval since the last checkpoint has passed
+    bool Due(uint64_t generation) const;
+
+    // Simulation thread: steps to run before asking Due again
+    uint64_t NextSlice(uint64_t generation) const;
+
+    // Simulation thread: fill the buffer (with CaptureCells, CaptureColors or
+    // CapturePlane), then Submit it. Buffers are reused, so their grids and
+    // tiles keep their memory. The file is named after info.generation.
+    UniverseState& Buffer() { return buffers.Back(); }
+    void Submit();
+
+    uint64_t Written() const { return written.load(std::memory_order_relaxed); }
+    uint64_t Failed() const { return failed.load(std::memory_order_relaxed); }
+    bool Failing() const { return failing.load(std::memory_order_relaxed); }  // The last write failed
+
+    // Path of the newest checkpoint in directory that loads, or "" if there is none
+    static std::string FindLatest(const std::string& directory, const std::string& prefix = "checkpoint");
+
+private:
+    void Run();
+    bool Write(const UniverseState& state);
+    void Prune();
+
+    CheckpointConfig config;
+    TripleBuffer<UniverseState> buffers;
+    uint64_t lastGeneration = 0;
+    std::chrono::steady_clock::time_point lastTime;
+    uint64_t sequence = 0;  // Of the next checkpoint (writer thread)
+
+    std::mutex mutex;  // Guards stopping; held around the wake-up so none is lost
+    std::condition_variable wake;
+    bool stopping = false;
+    std::atomic<uint64_t> written{ 0 };
+    std::atomic<uint64_t> failed{ 0 };
+    std::atomic<bool> failing{ false };
+    std::thread thread;
+};
@@ -0,0 +1,88 @@
+// Implements the living-cell count pyramid
+
+#include "DensityPyramid.h"
+
+// Counts the set bits of each byte of word separately, leaving each count in its byte
+static uint64_t BytePopCounts(uint64_t word)
+{
+    word -= (word >> 1) & 0x5555555555555555ull;
+    word = (word & 0x3333333333333333ull) + ((word >> 2) & 0x3333333333333333ull);
+    return (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+}
+
+void DensityPyramid::Clear()
+{
+    levels.clear();
+    rows = 0;
+    cols = 0;
+}
+
+void DensityPyramid::Build(const Grid& grid)
+{
+    Clear();
+    rows = grid.Rows();
+    cols = grid.Cols();
+    if (rows == 0 || cols == 0)
+        return;
+
+    // Level 0: each byte of a row word is the 8 cells of one block row, so
+    // adding the byte counts of 8 rows gives 8 blocks at once (at most 64 each)
+    Level base;
+    base.rows = (rows + 7) >> kBaseShift;
+    base.cols = (cols + 7) >> kBaseShift;
+    base.counts.assign(size_t(base.rows) * size_t(base.cols), 0);
+    const int64_t wordCount = (cols + 63) >> 6;
+    for (int64_t blockRow = 0; blockRow < base.rows; ++blockRow)
+    {
+        const int64_t r0 = blockRow << kBaseShift;
+        const int64_t r1 = r0 + 8 < rows ? r0 + 8 : rows;
+        uint32_t* counts = &base.counts[size_t(blockRow) * size_t(base.cols)];
+        for (int64_t w = 0; w < wordCount; ++w)
+        {
+            uint64_t sums = 0;
+            for (int64_t r = r0; r < r1; ++r)
+                sums += BytePopCounts(grid.Row(static_cast<int>(r))[w]);
+            for (int64_t block = w << 3; sums && block < base.cols; ++block, sums >>= 8)
+                counts[block] = uint32_t(sums & 0xFF);
+        }
+    }
+    levels.push_back(std::move(base));
+
+    // Each level above sums 2x2 blocks of the one below
+    while (levels.back().rows > 1 || levels.back().cols > 1)
+    {
+        const Level& below = levels.back();
+        Level level;
+        level.rows = (below.rows + 1) >> 1;
+        level.cols = (below.cols + 1) >> 1;
+        level.counts.assign(size_t(level.rows) * size_t(level.cols), 0);
+        for (int64_t r = 0; r < below.rows; ++r)
+        {
+            const uint32_t* from = &below.counts[size_t(r) * size_t(below.cols)];
+            uint32_t* to = &level.counts[size_t(r >> 1) * size_t(level.cols)];
+            for (int64_t c = 0; c < below.cols; ++c)
+                to[c >> 1] += from[c];
+        }
+        levels.push_back(std::move(level));
+    }
+}
+
+size_t DensityPyramid::MemoryBytes() const
+{
+    size_t bytes = 0;
+    for (const Level& level : levels)
+        bytes += level.counts.capacity() * sizeof(uint32_t);
+    return bytes;
+}
+
+void DensityPyramid::Add(int64_t row, int64_t col, int delta)
+{
+    if (row < 0 || row >= rows || col < 0 || col >= cols)
+        return;
+    for (size_t level = 0; level < levels.size(); ++level)
+    {
+        const int shift = kBaseShift + static_cast<int>(level);
+        Level& l = levels[level];
+        l.counts[size_t(row >> shift) * size_t(l.cols) + size_t(col >> shift)] += uint32_t(delta);
+    }
+}
@@ -0,0 +1,59 @@
+// Defines DensityPyramid, a mipmap of living-cell counts for drawing a
+// zoomed-out universe. Level 0 counts the living cells of each 8x8 block of
+// the grid, and each level above sums 2x2 blocks of the one below, up to a
+// single block. A pixel that covers many cells then reads one count instead
+// of the cells, so drawing costs the same at any universe size.
+//
+// A flipped cell changes one count per level, so the pyramid follows the
+// simulation's change log instead of being rebuilt every frame.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Grid.h"
+
+class DensityPyramid
+{
+public:
+    static constexpr int kBaseShift = 3;  // Level 0 blocks are 8x8 cells
+
+    // Counts every block of grid from scratch
+    void Build(const Grid& grid);
+
+    void Clear();
+
+    // A cell of the grid died (-1) or came alive (+1)
+    void Add(int64_t row, int64_t col, int delta);
+
+    int Levels() const { return static_cast<int>(levels.size()); }
+
+    // Cells per block side at a level
+    static int64_t BlockSize(int level) { return int64_t(1) << (kBaseShift + level); }
+
+    int64_t BlockRows(int level) const { return levels[level].rows; }
+    int64_t BlockCols(int level) const { return levels[level].cols; }
+
+    // Living cells in block (blockRow, blockCol) of a level
+    uint32_t Count(int level, int64_t blockRow, int64_t blockCol) const
+    {
+        const Level& l = levels[level];
+        return l.counts[size_t(blockRow) * size_t(l.cols) + size_t(blockCol)];
+    }
+
+    // Grid dimensions the pyramid was built for
+    int64_t Rows() const { return rows; }
+    int64_t Cols() const { return cols; }
+
+    size_t MemoryBytes() const;
+
+private:
+    struct Level
+    {
+        int64_t rows = 0, cols = 0;  // Blocks
+        std::vector<uint32_t> counts;
+    };
+
+    std::vector<Level> levels;
+    int64_t rows = 0, cols = 0;
+};
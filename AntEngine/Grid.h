@@ -0,0 +1,291 @@
+// Defines the Grid class that stores the universe's cells.
+// All cells live in one contiguous 64-byte aligned buffer with a
+// power-of-two row stride. The cell storage (1 bit or 1 byte per cell)
+// is picked at compile time through the Storage template parameter.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#if defined _MSC_VER
+#include <malloc.h>
+#include <intrin.h>
+#endif
+
+// Number of set bits in a word
+inline int PopCount64(uint64_t w)
+{
+#if defined _MSC_VER && (defined _M_X64 || defined _M_ARM64)
+    return static_cast<int>(__popcnt64(w));
+#elif defined _MSC_VER
+    return static_cast<int>(__popcnt(static_cast<uint32_t>(w)) + __popcnt(static_cast<uint32_t>(w >> 32)));
+#else
+    return __builtin_popcountll(w);
+#endif
+}
+
+// The count (1 to 64) cells of a bit row starting at col, as the low bits of a word
+inline uint64_t ReadBits(const uint64_t* row, int64_t col, int count)
+{
+    const int shift = static_cast<int>(col & 63);
+    uint64_t bits = row[col >> 6] >> shift;
+    if (shift != 0 && shift + count > 64)
+        bits |= row[(col >> 6) + 1] << (64 - shift);
+    return count == 64 ? bits : bits & ((uint64_t(1) << count) - 1);
+}
+
+// Overwrites the count (1 to 64) cells of a bit row starting at col with the low bits of bits
+inline void WriteBits(uint64_t* row, int64_t col, int count, uint64_t bits)
+{
+    const uint64_t mask = count == 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+    const int shift = static_cast<int>(col & 63);
+    bits &= mask;
+    uint64_t& low = row[col >> 6];
+    low = (low & ~(mask << shift)) | (bits << shift);
+    if (shift != 0 && shift + count > 64)
+    {
+        uint64_t& high = row[(col >> 6) + 1];
+        high = (high & ~(mask >> (64 - shift))) | (bits >> (64 - shift));
+    }
+}
+
+// Storage policy: 64 cells packed into each 64-bit word
+struct BitStorage
+{
+    using Word = uint64_t;
+    static constexpr int kCellShift = 6;   // log2(cells per word)
+};
+
+// Storage policy: one byte per cell (faster single-cell access, 8x the memory)
+struct ByteStorage
+{
+    using Word = uint8_t;
+    static constexpr int kCellShift = 0;
+};
+
+template <typename Storage>
+class BasicGrid
+{
+public:
+    using Word = typename Storage::Word;
+    static constexpr int kCellShift = Storage::kCellShift;
+    static constexpr int kCellsPerWord = 1 << kCellShift;
+    static constexpr size_t kAlignment = 64;  // One cache line
+
+    BasicGrid() = default;
+
+    // Creates a grid with every cell dead
+    BasicGrid(int rows, int cols)
+    {
+        Allocate(rows, cols);
+    }
+
+    BasicGrid(const BasicGrid& other)
+    {
+        Allocate(other.rows, other.cols);
+        if (data)
+            std::memcpy(data, other.data, SizeBytes());
+    }
+
+    BasicGrid(BasicGrid&& other) noexcept
+    {
+        Swap(other);
+    }
+
+    BasicGrid& operator=(BasicGrid other) noexcept
+    {
+        Swap(other);
+        return *this;
+    }
+
+    ~BasicGrid()
+    {
+        FreeAligned(data);
+    }
+
+    void Swap(BasicGrid& other) noexcept
+    {
+        std::swap(data, other.data);
+        std::swap(rows, other.rows);
+        std::swap(cols, other.cols);
+        std::swap(strideShift, other.strideShift);
+    }
+
+    int Rows() const { return rows; }
+    int Cols() const { return cols; }
+
+    // Number of words between the start of two consecutive rows (always a power of two)
+    size_t StrideWords() const { return size_t(1) << strideShift; }
+    size_t SizeBytes() const { return (size_t(rows) << strideShift) * sizeof(Word); }
+
+    Word* Row(int r) { return data + (size_t(r) << strideShift); }
+    const Word* Row(int r) const { return data + (size_t(r) << strideShift); }
+    Word* Data() { return data; }
+    const Word* Data() const { return data; }
+
+    bool Get(int r, int c) const
+    {
+        return (WordAt(r, c) >> BitOf(c)) & 1;
+    }
+
+    void Set(int r, int c, bool alive)
+    {
+        Word& w = WordAt(r, c);
+        const Word mask = Word(1) << BitOf(c);
+        w = alive ? Word(w | mask) : Word(w & ~mask);
+    }
+
+    // Flips a cell and returns the value it had before the flip
+    bool Flip(int r, int c)
+    {
+        Word& w = WordAt(r, c);
+        const int bit = BitOf(c);
+        const bool old = (w >> bit) & 1;
+        w ^= Word(1) << bit;
+        return old;
+    }
+
+    // Kills every cell
+    void Clear()
+    {
+        if (data)
+            std::memset(data, 0, SizeBytes());
+    }
+
+    // Counts the living cells
+    uint64_t CountAlive() const
+    {
+        uint64_t count = 0;
+        const size_t words = size_t(rows) << strideShift;
+        for (size_t i = 0; i < words; ++i)
+            count += PopCount64(data[i]);
+        return count;
+    }
+
+    // Changes the dimensions in one allocation. Cell (r, c) moves to
+    // (r + rowOffset, c + colOffset); cells that fall outside are dropped.
+    // Only the overlap is copied, a row at a time.
+    void Resize(int newRows, int newCols, int64_t rowOffset = 0, int64_t colOffset = 0)
+    {
+        if (newRows == rows && newCols == cols && rowOffset == 0 && colOffset == 0)
+            return;
+
+        BasicGrid resized(newRows, newCols);
+        resized.Paste(*this, rowOffset, colOffset);
+        Swap(resized);
+    }
+
+    // Copies every cell of source, dead ones too, so that its top-left cell
+    // lands on (row0, col0); what falls outside this grid is dropped
+    void Paste(const BasicGrid& source, int64_t row0, int64_t col0)
+    {
+        const int64_t firstRow = row0 < 0 ? -row0 : 0;
+        const int64_t firstCol = col0 < 0 ? -col0 : 0;
+        const int64_t lastRow = row0 + source.rows < rows ? source.rows : rows - row0;
+        const int64_t lastCol = col0 + source.cols < cols ? source.cols : cols - col0;
+        if (firstRow >= lastRow || firstCol >= lastCol)
+            return;
+
+        for (int64_t r = firstRow; r < lastRow; ++r)
+        {
+            const Word* from = source.Row(static_cast<int>(r));
+            Word* to = Row(static_cast<int>(row0 + r));
+            if (kCellShift == 0)
+            {
+                std::memcpy(to + col0 + firstCol, from + firstCol, size_t(lastCol - firstCol) * sizeof(Word));
+                continue;
+            }
+
+            // Whole words when the columns line up (a plain resize), then 64 cells
+            // at a time through shifts
+            int64_t c = firstCol;
+            if ((col0 & 63) == 0)
+            {
+                const int64_t words = (lastCol - firstCol) >> 6;
+                std::memcpy(to + ((col0 + firstCol) >> 6), from + (firstCol >> 6), size_t(words) * sizeof(Word));
+                c += words << 6;
+            }
+            for (; c < lastCol; c += 64)
+            {
+                const int count = lastCol - c < 64 ? static_cast<int>(lastCol - c) : 64;
+                WriteBits(reinterpret_cast<uint64_t*>(to), col0 + c, count,
+                    ReadBits(reinterpret_cast<const uint64_t*>(from), c, count));
+            }
+        }
+    }
+
+    bool operator==(const BasicGrid& other) const
+    {
+        if (rows != other.rows || cols != other.cols)
+            return false;
+        return SizeBytes() == 0 || std::memcmp(data, other.data, SizeBytes()) == 0;
+    }
+
+    bool operator!=(const BasicGrid& other) const { return !(*this == other); }
+
+private:
+    Word& WordAt(int r, int c)
+    {
+        return data[(size_t(r) << strideShift) + (size_t(c) >> kCellShift)];
+    }
+
+    const Word& WordAt(int r, int c) const
+    {
+        return data[(size_t(r) << strideShift) + (size_t(c) >> kCellShift)];
+    }
+
+    static int BitOf(int c)
+    {
+        return c & (kCellsPerWord - 1);
+    }
+
+    void Allocate(int newRows, int newCols)
+    {
+        rows = newRows > 0 ? newRows : 0;
+        cols = newCols > 0 ? newCols : 0;
+
+        // Round the row width up to a power-of-two number of words
+        const size_t wordsNeeded = (size_t(cols) + kCellsPerWord - 1) >> kCellShift;
+        strideShift = 0;
+        while ((size_t(1) << strideShift) < wordsNeeded)
+            ++strideShift;
+
+        data = nullptr;
+        if (rows > 0 && cols > 0)
+        {
+            data = static_cast<Word*>(AllocAligned(SizeBytes()));
+            std::memset(data, 0, SizeBytes());
+        }
+    }
+
+    static void* AllocAligned(size_t bytes)
+    {
+        // aligned_alloc needs the size to be a multiple of the alignment
+        bytes = (bytes + kAlignment - 1) & ~(kAlignment - 1);
+#if defined _MSC_VER
+        return _aligned_malloc(bytes, kAlignment);
+#else
+        return std::aligned_alloc(kAlignment, bytes);
+#endif
+    }
+
+    static void FreeAligned(void* p)
+    {
+#if defined _MSC_VER
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+
+    Word* data = nullptr;
+    int rows = 0;
+    int cols = 0;
+    int strideShift = 0;  // log2 of the row stride in words
+};
+
+// The universe uses bit-packed cells; swap in ByteStorage to trade memory for speed
+using Grid = BasicGrid<BitStorage>;
+using ByteGrid = BasicGrid<ByteStorage>;
@@ -0,0 +1,387 @@
+// Implements highway detection and the period-skipping jump
+
+#include "Highway.h"
+#include <algorithm>
+#include <cstdlib>
+#include <unordered_map>
+
+namespace
+{
+    // Steps stepped between two detection attempts, and per recording pass
+    const uint64_t kDetectInterval = 1024;
+    const uint64_t kChunk = 4096;
+
+    // Entries compared before a candidate period gets the full check
+    const int kQuickMatch = 64;
+
+    struct WrappingCells
+    {
+        Grid& grid;
+
+        static constexpr bool kWraps = true;
+        int64_t Rows() const { return grid.Rows(); }
+        int64_t Cols() const { return grid.Cols(); }
+
+        bool Get(int64_t r, int64_t c) const { return grid.Get(static_cast<int>(r), static_cast<int>(c)); }
+        void Set(int64_t r, int64_t c, bool alive) { grid.Set(static_cast<int>(r), static_cast<int>(c), alive); }
+        bool Flip(int64_t r, int64_t c) { return grid.Flip(static_cast<int>(r), static_cast<int>(c)); }
+
+        void Move(int64_t& r, int64_t& c, int d) const
+        {
+            const int64_t rows = grid.Rows();
+            const int64_t cols = grid.Cols();
+            r += kRowDelta[d];
+            c += kColDelta[d];
+            r += rows & -int64_t(r < 0);
+            r -= rows & -int64_t(r >= rows);
+            c += cols & -int64_t(c < 0);
+            c -= cols & -int64_t(c >= cols);
+        }
+    };
+
+    struct PlaneCells
+    {
+        SparseUniverse& universe;
+
+        static constexpr bool kWraps = false;
+        int64_t Rows() const { return 0; }
+        int64_t Cols() const { return 0; }
+
+        bool Get(int64_t r, int64_t c) const { return universe.Get(r, c); }
+        void Set(int64_t r, int64_t c, bool alive) { universe.Set(r, c, alive); }
+        bool Flip(int64_t r, int64_t c) { return universe.Flip(r, c); }
+
+        void Move(int64_t& r, int64_t& c, int d) const
+        {
+            r += kRowDelta[d];
+            c += kColDelta[d];
+        }
+    };
+
+    uint64_t CellKey(int64_t row, int64_t col)
+    {
+        return (uint64_t(uint32_t(row)) << 32) | uint32_t(col);
+    }
+
+    // Largest j <= limit with [low, high] + i * delta inside [0, size) for every i in 0..j (-1 if not even at 0)
+    int64_t FitCount(int64_t low, int64_t high, int64_t delta, int64_t size, int64_t limit)
+    {
+        if (low < 0 || high >= size)
+            return -1;
+        if (delta > 0)
+            return std::min(limit, (size - 1 - high) / delta);
+        if (delta < 0)
+            return std::min(limit, low / -delta);
+        return limit;
+    }
+}
+
+HighwayDetector::HighwayDetector()
+    : history(kHistorySize)
+{
+}
+
+void HighwayDetector::Reset()
+{
+    recorded = 0;
+    valid = 0;
+    lastDetect = 0;
+    locked = false;
+    period = 0;
+    deltaRow = deltaCol = 0;
+    reach = 0;
+    verified = 0;
+    entered.clear();
+    left.clear();
+    revisited.clear();
+    skipped = 0;
+    found = false;
+    highwayStart = 0;
+}
+
+uint64_t HighwayDetector::StepMany(LangtonsAnt& ant, Grid& grid, uint64_t n)
+{
+    if (grid.Rows() == 0 || grid.Cols() == 0)
+        return 0;
+    return Run(ant, WrappingCells{ grid }, n);
+}
+
+uint64_t HighwayDetector::StepMany(LangtonsAnt& ant, SparseUniverse& universe, uint64_t n)
+{
+    return Run(ant, PlaneCells{ universe }, n);
+}
+
+template <typename Cells>
+uint64_t HighwayDetector::Run(LangtonsAnt& ant, Cells cells, uint64_t n)
+{
+    uint64_t jumped = 0;
+    while (n > 0)
+    {
+        if (locked)
+        {
+            const uint64_t k = Jump(ant, cells, n / uint64_t(period));
+            if (k > 0)
+            {
+                ShiftHistory(k * period);
+                n -= k * period;
+                jumped += k * period;
+                if (n == 0)
+                    break;
+            }
+        }
+
+        // Exact steps; they knock the trail out of phase with the ant until the next detection
+        const uint64_t chunk = std::min(n, kChunk);
+        Record(ant, cells, chunk);
+        n -= chunk;
+        locked = false;
+
+        if (recorded - lastDetect >= kDetectInterval)
+        {
+            lastDetect = recorded;
+            locked = Detect();
+            if (locked && !found)
+            {
+                found = true;
+                highwayStart = RepeatStart();
+            }
+        }
+    }
+
+    skipped += jumped;
+    return jumped;
+}
+
+// Plain stepping that also logs every step into the history
+template <typename Cells>
+void HighwayDetector::Record(LangtonsAnt& ant, Cells& cells, uint64_t n)
+{
+    int64_t r = ant.GetRow();
+    int64_t c = ant.GetCol();
+    int d = ant.GetDirection();
+    uint8_t* log = history.data();
+    const uint64_t mask = kHistorySize - 1;
+
+    for (uint64_t i = 0; i < n; ++i)
+    {
+        const bool cell = cells.Flip(r, c);
+        d = (d + kTurn[cell]) & 3;
+        log[(recorded + i) & mask] = uint8_t(cell | (d << 1));
+        cells.Move(r, c, d);
+    }
+
+    recorded += n;
+    valid = std::min<uint64_t>(valid + n, kHistorySize);
+    ant = LangtonsAnt(r, c, d);
+}
+
+// Looks for the shortest period the recent history repeats with
+bool HighwayDetector::Detect()
+{
+    const uint64_t available = valid;
+    const uint8_t* log = history.data();
+    const uint64_t mask = kHistorySize - 1;
+    const uint64_t last = recorded - 1;
+
+    for (int candidate = 1; candidate <= kMaxPeriod; ++candidate)
+    {
+        if (uint64_t(3 * candidate + kQuickMatch) > available)
+            break;
+
+        bool match = true;
+        for (int i = 0; i < kQuickMatch && match; ++i)
+            match = log[(last - i) & mask] == log[(last - i - candidate) & mask];
+        if (match && BuildTrail(candidate))
+            return true;
+    }
+
+    period = 0;
+    return false;
+}
+
+// The first step of the history from which every entry repeats one period
+// later; the oldest entry kept if the repeat runs back further than that
+uint64_t HighwayDetector::RepeatStart() const
+{
+    const uint8_t* log = history.data();
+    const uint64_t mask = kHistorySize - 1;
+    const uint64_t oldest = recorded - valid;
+    uint64_t start = recorded - uint64_t(period);
+    while (start > oldest && log[(start - 1) & mask] == log[(start - 1 + period) & mask])
+        --start;
+    return start;
+}
+
+// Works out the trail of the last `candidate` steps and checks that the
+// history repeats for long enough to trust it
+bool HighwayDetector::BuildTrail(int candidate)
+{
+    const uint8_t* log = history.data();
+    const uint64_t mask = kHistorySize - 1;
+    const uint64_t last = recorded - 1;
+
+    // Walk back from the ant (at 0, 0) to find the cell of each step
+    std::vector<TrailCell> cells;
+    std::unordered_map<uint64_t, size_t> index;
+    std::vector<size_t> visit(candidate);
+    int64_t row = 0, col = 0;
+    for (int i = 0; i < candidate; ++i)
+    {
+        const int d = log[(last - i) & mask] >> 1;
+        row -= kRowDelta[d];
+        col -= kColDelta[d];
+        auto inserted = index.emplace(CellKey(row, col), cells.size());
+        if (inserted.second)
+            cells.push_back(TrailCell{ row, col, false, false, 0, true });
+        visit[candidate - 1 - i] = inserted.first->second;
+    }
+
+    const int64_t dr = -row;  // The ant started the period at (row, col) and ends it at (0, 0)
+    const int64_t dc = -col;
+    if (dr == 0 && dc == 0)
+        return false;
+
+    // First and last visit of each cell, in step order
+    std::vector<bool> seen(cells.size(), false);
+    for (int s = 0; s < candidate; ++s)
+    {
+        const bool read = log[(last - (candidate - 1 - s)) & mask] & 1;
+        TrailCell& cell = cells[visit[s]];
+        if (!seen[visit[s]])
+        {
+            cell.firstRead = read;
+            seen[visit[s]] = true;
+        }
+        cell.lastWrite = !read;
+    }
+
+    int64_t rowLow = 0, rowHigh = 0, colLow = 0, colHigh = 0;
+    for (const TrailCell& cell : cells)
+    {
+        rowLow = std::min(rowLow, cell.row);
+        rowHigh = std::max(rowHigh, cell.row);
+        colLow = std::min(colLow, cell.col);
+        colHigh = std::max(colHigh, cell.col);
+    }
+
+    // Periods further apart than this can't share a cell
+    const int64_t extent = std::max(rowHigh - rowLow, colHigh - colLow);
+    const int64_t overlap = extent / std::max(std::abs(dr), std::abs(dc)) + 1;
+
+    // Every cell a period reads must have been written the same way by the
+    // periods before it, so the history has to repeat for reach + 1 periods
+    const uint64_t needed = uint64_t(overlap + 2) * candidate;
+    if (needed > valid)
+        return false;
+    for (uint64_t i = 0; i + candidate < needed; ++i)
+    {
+        if (log[(last - i) & mask] != log[(last - i - candidate) & mask])
+            return false;
+    }
+
+    for (TrailCell& cell : cells)
+    {
+        for (int64_t i = 1; i <= overlap; ++i)
+        {
+            // Entered by the period i before, or visited again i periods later
+            if (cell.fresh && index.count(CellKey(cell.row + i * dr, cell.col + i * dc)))
+                cell.fresh = false;
+            if (cell.gap == 0 && index.count(CellKey(cell.row - i * dr, cell.col - i * dc)))
+                cell.gap = i;
+        }
+    }
+
+    entered.clear();
+    left.clear();
+    revisited.clear();
+    for (const TrailCell& cell : cells)
+    {
+        if (cell.fresh)
+            entered.push_back(cell);
+        if (cell.gap > 0)
+            revisited.push_back(cell);
+        else if (!cell.fresh || cell.lastWrite != cell.firstRead)
+            left.push_back(cell);  // A fresh cell left as it was found needs no write
+    }
+
+    period = candidate;
+    deltaRow = dr;
+    deltaCol = dc;
+    reach = overlap;
+    verified = needed;
+    minRow = rowLow;
+    maxRow = rowHigh;
+    minCol = colLow;
+    maxCol = colHigh;
+    return true;
+}
+
+// Skipped periods write the same cells as stepped ones, so a cell that
+// fresh cells of later periods depend on is never touched before it's checked
+template <typename Cells>
+uint64_t HighwayDetector::Jump(LangtonsAnt& ant, Cells& cells, uint64_t limit)
+{
+    const int64_t r = ant.GetRow();
+    const int64_t c = ant.GetCol();
+    int64_t k = static_cast<int64_t>(std::min<uint64_t>(limit, INT64_MAX / 4));
+
+    // On the grid neither the recorded periods nor the skipped ones may cross
+    // an edge, or the wrapped trail could meet itself
+    if (Cells::kWraps)
+    {
+        const int64_t back = reach + 1;
+        k = FitCount(r + minRow - back * deltaRow, r + maxRow - back * deltaRow, deltaRow, cells.Rows(), k + back) - back;
+        k = std::min(k, FitCount(c + minCol - back * deltaCol, c + maxCol - back * deltaCol, deltaCol, cells.Cols(), k + back) - back);
+    }
+
+    // Stop before the first period that would enter a cell with an unexpected color
+    int64_t done = 0;
+    for (int64_t j = 1; j <= k; ++j)
+    {
+        const int64_t pr = r + j * deltaRow;
+        const int64_t pc = c + j * deltaCol;
+        bool clear = true;
+        for (const TrailCell& cell : entered)
+        {
+            if (cells.Get(pr + cell.row, pc + cell.col) != cell.firstRead)
+            {
+                clear = false;
+                break;
+            }
+        }
+        if (!clear)
+            break;
+
+        for (const TrailCell& cell : left)
+            cells.Set(pr + cell.row, pc + cell.col, cell.lastWrite);
+        done = j;
+    }
+    if (done == 0)
+        return 0;
+
+    // A revisited cell keeps the color of the last period that visits it
+    for (const TrailCell& cell : revisited)
+    {
+        for (int64_t j = std::max<int64_t>(1, done - cell.gap + 1); j <= done; ++j)
+            cells.Set(r + cell.row + j * deltaRow, c + cell.col + j * deltaCol, cell.lastWrite);
+    }
+
+    ant = LangtonsAnt(r + done * deltaRow, c + done * deltaCol, ant.GetDirection());
+    return uint64_t(done);
+}
+
+// Moves the verified tail of the history forward by whole periods, so it
+// reads as if the skipped steps had been recorded
+void HighwayDetector::ShiftHistory(uint64_t steps)
+{
+    const uint64_t mask = kHistorySize - 1;
+    std::vector<uint8_t> tail(verified);
+    for (uint64_t i = 0; i < verified; ++i)
+        tail[i] = history[(recorded - verified + i) & mask];
+
+    recorded += steps;
+    for (uint64_t i = 0; i < verified; ++i)
+        history[(recorded - verified + i) & mask] = tail[i];
+    valid = verified;
+    lastDetect = recorded;
+}
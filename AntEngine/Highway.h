@@ -0,0 +1,107 @@
+// Defines HighwayDetector, which notices when a Langton's ant has settled
+// into a periodic "highway" (the classic one repeats every 104 steps and
+// moves 2 cells diagonally) and then skips whole periods at once.
+//
+// While stepping, the detector keeps a history of what the ant read and
+// which way it moved on every step. When the last stretch of that history
+// repeats with period P and the ant moved by a nonzero (dr, dc) per period,
+// the trail of one period is known exactly: the cells visited, the color
+// each had when first entered, and the color each was left with. Jumping k
+// periods then only needs
+//   - a check that the fresh cells the ant would enter in those periods
+//     hold the same colors as the fresh cells of the last period (normally
+//     all dead), which stops the jump just short of any existing structure;
+//   - the final colors of the trail stamped into the cells, without
+//     replaying the steps.
+// The history must repeat long enough for every cell of a period to have
+// been visited by earlier periods the same way, so the skipped steps give
+// exactly the universe and ant that stepping would.
+//
+// On the wrapping grid a jump never crosses an edge. Near an edge, or near
+// existing cells, the ant steps normally until it is clear again.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Grid.h"
+#include "LangtonsAnt.h"
+#include "SparseUniverse.h"
+
+class HighwayDetector
+{
+public:
+    HighwayDetector();
+
+    // Forgets the history; call after the universe or the ant was changed from outside
+    void Reset();
+
+    // Advances the ant n steps with the same result as ant.StepMany(universe, n).
+    // Returns how many of those steps were skipped rather than stepped.
+    uint64_t StepMany(LangtonsAnt& ant, Grid& grid, uint64_t n);
+    uint64_t StepMany(LangtonsAnt& ant, SparseUniverse& universe, uint64_t n);
+
+    // The highway found by the last detection (period 0 if none)
+    int Period() const { return period; }
+    int64_t DeltaRow() const { return deltaRow; }
+    int64_t DeltaCol() const { return deltaCol; }
+
+    // Steps skipped since the last Reset
+    uint64_t SkippedSteps() const { return skipped; }
+
+    // Steps since the last Reset after which the first highway detected set
+    // in: where its period starts repeating in the history, to the step. Only
+    // meaningful once Period was nonzero; detection itself runs a few thousand
+    // steps later.
+    uint64_t HighwayStart() const { return highwayStart; }
+
+    static constexpr int kHistorySize = 1 << 15;  // Steps of history kept (power of two)
+    static constexpr int kMaxPeriod = 2048;
+
+private:
+    // One cell of a period's trail, relative to the ant's position at the end of the period
+    struct TrailCell
+    {
+        int64_t row, col;
+        bool firstRead;   // Color when the period first entered the cell
+        bool lastWrite;   // Color the period left behind
+        int64_t gap;      // Periods until a later period visits the cell again (0 = never)
+        bool fresh;       // No earlier period visited it
+    };
+
+    template <typename Cells>
+    uint64_t Run(LangtonsAnt& ant, Cells cells, uint64_t n);
+
+    template <typename Cells>
+    void Record(LangtonsAnt& ant, Cells& cells, uint64_t n);
+
+    bool Detect();
+    bool BuildTrail(int candidate);
+    uint64_t RepeatStart() const;
+
+    // Skips up to `limit` periods, checking and stamping them one at a time; returns how many
+    template <typename Cells>
+    uint64_t Jump(LangtonsAnt& ant, Cells& cells, uint64_t limit);
+    void ShiftHistory(uint64_t steps);
+
+    // Step history: bit 0 is the color read, bits 1-2 the direction moved
+    std::vector<uint8_t> history;
+    uint64_t recorded = 0;   // Steps recorded since the last Reset
+    uint64_t valid = 0;      // Entries at the end of the history that belong to this run
+    uint64_t lastDetect = 0; // recorded at the last detection attempt
+
+    // The detected highway (valid while locked is true)
+    bool locked = false;
+    int period = 0;
+    int64_t deltaRow = 0, deltaCol = 0;
+    int64_t reach = 0;       // Periods this far apart still share cells
+    uint64_t verified = 0;   // History entries known to repeat
+    int64_t minRow = 0, maxRow = 0, minCol = 0, maxCol = 0;  // Bounding box of the trail
+    std::vector<TrailCell> entered;   // Fresh cells, checked before each skipped period
+    std::vector<TrailCell> left;      // Cells no later period visits, written by every skipped period
+    std::vector<TrailCell> revisited; // Cells later periods visit again, written once the jump length is known
+
+    uint64_t skipped = 0;
+    bool found = false;          // A highway was detected since the last Reset
+    uint64_t highwayStart = 0;
+};
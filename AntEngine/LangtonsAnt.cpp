@@ -0,0 +1,251 @@
+// Implements the ant's movement and turning logic
+#include "LangtonsAnt.h"
+
+LangtonsAnt::LangtonsAnt(int64_t startRow, int64_t startCol, int startDirection)
+    : row(startRow), col(startCol), dir(static_cast<Direction>(startDirection & 3))
+{
+    // Initialize the ant at the starting position, facing UP unless told otherwise
+}
+
+template <typename Storage>
+void LangtonsAnt::Step(BasicGrid<Storage>& grid)
+{
+    const int r = static_cast<int>(row);
+    const int c = static_cast<int>(col);
+
+    // Check the current cell color: true means black, false means white
+    bool cell = grid.Get(r, c);
+
+    if (cell) // If on a black cell
+    {
+        TurnLeft();          // Turn left 90 degrees
+        grid.Set(r, c, false); // Flip the cell to white
+    }
+    else // If on a white cell
+    {
+        TurnRight();         // Turn right 90 degrees
+        grid.Set(r, c, true);  // Flip the cell to black
+    }
+
+    // Move forward one step in the current direction, wrapping around edges
+    MoveForward(grid.Rows(), grid.Cols());
+}
+
+template <typename Storage>
+void LangtonsAnt::StepMany(BasicGrid<Storage>& grid, uint64_t n)
+{
+    RunGrid<false, false>(grid, n, nullptr);
+}
+
+template <typename Storage>
+void LangtonsAnt::StepMany(BasicGrid<Storage>& grid, uint64_t n, std::vector<CellChange>& changes)
+{
+    RunGrid<true, false>(grid, n, &changes);
+}
+
+void LangtonsAnt::StepMany(SparseUniverse& universe, uint64_t n)
+{
+    RunPlane<false, false>(universe, n, nullptr);
+}
+
+void LangtonsAnt::StepMany(SparseUniverse& universe, uint64_t n, std::vector<CellChange>& changes)
+{
+    RunPlane<true, false>(universe, n, &changes);
+}
+
+template <typename Storage>
+void LangtonsAnt::StepBack(BasicGrid<Storage>& grid)
+{
+    RunGrid<false, true>(grid, 1, nullptr);
+}
+
+template <typename Storage>
+void LangtonsAnt::StepBackMany(BasicGrid<Storage>& grid, uint64_t n)
+{
+    RunGrid<false, true>(grid, n, nullptr);
+}
+
+template <typename Storage>
+void LangtonsAnt::StepBackMany(BasicGrid<Storage>& grid, uint64_t n, std::vector<CellChange>& changes)
+{
+    RunGrid<true, true>(grid, n, &changes);
+}
+
+void LangtonsAnt::StepBackMany(SparseUniverse& universe, uint64_t n)
+{
+    RunPlane<false, true>(universe, n, nullptr);
+}
+
+void LangtonsAnt::StepBackMany(SparseUniverse& universe, uint64_t n, std::vector<CellChange>& changes)
+{
+    RunPlane<true, true>(universe, n, &changes);
+}
+
+template <bool Record, bool Backward, typename Storage>
+void LangtonsAnt::RunGrid(BasicGrid<Storage>& grid, uint64_t n, std::vector<CellChange>* changes)
+{
+    // Same rule as Step, but the state lives in locals and the turn/move
+    // use lookup tables instead of branches so the loop stays tight
+    const int rows = grid.Rows();
+    const int cols = grid.Cols();
+    int r = static_cast<int>(row);
+    int c = static_cast<int>(col);
+    int d = dir;
+
+    // Moves one cell along (dr, dc) and wraps around the edges without using modulo
+    auto move = [&](int dr, int dc)
+    {
+        r += dr;
+        c += dc;
+        r += rows & -(r < 0);
+        r -= rows & -(r >= rows);
+        c += cols & -(c < 0);
+        c -= cols & -(c >= cols);
+    };
+
+    for (uint64_t i = 0; i < n; ++i)
+    {
+        if (Backward)
+            move(-kRowDelta[d], -kColDelta[d]);  // Back to the cell the step left
+
+        const bool cell = grid.Flip(r, c);  // Flip the cell, remembering its old color
+        d = (d + kTurn[cell]) & 3;          // Turn right on white, left on black (or undo the turn)
+        if (Record)
+            changes->push_back(CellChange{ r, c, !cell });
+
+        if (!Backward)
+            move(kRowDelta[d], kColDelta[d]);
+    }
+
+    row = r;
+    col = c;
+    dir = static_cast<Direction>(d);
+}
+
+template <bool Record, bool Backward>
+void LangtonsAnt::RunPlane(SparseUniverse& universe, uint64_t n, std::vector<CellChange>* changes)
+{
+    // Work in tile-local coordinates and keep the current tile in a local,
+    // so the hash map is only consulted when the ant crosses a tile edge
+    const int shift = SparseUniverse::kTileShift;
+    const int mask = SparseUniverse::kTileMask;
+
+    int64_t tileRow = row >> shift;
+    int64_t tileCol = col >> shift;
+    int r = static_cast<int>(row & mask);
+    int c = static_cast<int>(col & mask);
+
+    // Direction kept as a (row, col) step vector: turning is then a swap plus a
+    // conditional negate, which is shorter than a table lookup on the critical path
+    int dr = kRowDelta[dir];
+    int dc = kColDelta[dir];
+
+    SparseUniverse::Tile* tile = universe.GetOrCreateTile(tileRow, tileCol);
+
+    // The ant often steps back and forth over a tile edge, so remember the previous tile too
+    SparseUniverse::Tile* prevTile = tile;
+    int64_t prevRow = tileRow;
+    int64_t prevCol = tileCol;
+
+    // Moves one cell along (stepR, stepC), switching tiles at a tile edge
+    auto move = [&](int stepR, int stepC)
+    {
+        r += stepR;
+        c += stepC;
+
+        // A negative or 64 coordinate shows up as a large unsigned value
+        if (static_cast<unsigned>(r | c) >= static_cast<unsigned>(SparseUniverse::kTileSize))
+        {
+            const int64_t nextRow = tileRow + (r >> shift);  // -1, 0 or +1
+            const int64_t nextCol = tileCol + (c >> shift);
+            r &= mask;
+            c &= mask;
+
+            SparseUniverse::Tile* next = (nextRow == prevRow && nextCol == prevCol)
+                ? prevTile
+                : universe.GetOrCreateTile(nextRow, nextCol);
+
+            prevTile = tile;
+            prevRow = tileRow;
+            prevCol = tileCol;
+            tile = next;
+            tileRow = nextRow;
+            tileCol = nextCol;
+        }
+    };
+
+    for (uint64_t i = 0; i < n; ++i)
+    {
+        if (Backward)
+            move(-dr, -dc);  // Back to the cell the step left
+
+        uint64_t& word = tile->rows[r];
+        const int cell = static_cast<int>((word >> c) & 1);
+        word ^= uint64_t(1) << c;           // Flip the cell
+        if (Record)
+            changes->push_back(CellChange{ tileRow * SparseUniverse::kTileSize + r,
+                tileCol * SparseUniverse::kTileSize + c, cell == 0 });
+
+        // Right turn maps (dr, dc) to (dc, -dr); a left turn is its negation.
+        // Stepping back, the cell held the color the step wrote, which picks the opposite turn.
+        const int negate = -cell;           // All ones on a black cell
+        const int nextDr = (dc ^ negate) - negate;
+        dc = (-dr ^ negate) - negate;
+        dr = nextDr;
+
+        if (!Backward)
+            move(dr, dc);
+    }
+
+    row = tileRow * SparseUniverse::kTileSize + r;
+    col = tileCol * SparseUniverse::kTileSize + c;
+    dir = dr < 0 ? UP : dr > 0 ? DOWN : dc > 0 ? RIGHT : LEFT;
+}
+
+void LangtonsAnt::TurnRight()
+{
+    // Change direction clockwise (UP->RIGHT->DOWN->LEFT->UP)
+    dir = static_cast<Direction>((dir + 1) % 4);
+}
+
+void LangtonsAnt::TurnLeft()
+{
+    // Change direction counter-clockwise
+    // Adding 3 modulo 4 is same as -1 modulo 4
+    dir = static_cast<Direction>((dir + 3) % 4);
+}
+
+void LangtonsAnt::MoveForward(int rows, int cols)
+{
+    // Move the ant one cell forward based on current direction
+    // Uses modulo for wrap-around (toroidal grid)
+    switch (dir)
+    {
+    case UP:
+        row = (row - 1 + rows) % rows;
+        break;
+    case DOWN:
+        row = (row + 1) % rows;
+        break;
+    case LEFT:
+        col = (col - 1 + cols) % cols;
+        break;
+    case RIGHT:
+        col = (col + 1) % cols;
+        break;
+    }
+}
+
+// Both cell storages are supported
+template void LangtonsAnt::Step(Grid&);
+template void LangtonsAnt::Step(ByteGrid&);
+template void LangtonsAnt::StepMany(Grid&, uint64_t);
+template void LangtonsAnt::StepMany(ByteGrid&, uint64_t);
+template void LangtonsAnt::StepMany(Grid&, uint64_t, std::vector<CellChange>&);
+template void LangtonsAnt::StepMany(ByteGrid&, uint64_t, std::vector<CellChange>&);
+template void LangtonsAnt::StepBack(Grid&);
+template void LangtonsAnt::StepBack(ByteGrid&);
+template void LangtonsAnt::StepBackMany(Grid&, uint64_t);
+template void LangtonsAnt::StepBackMany(ByteGrid&, uint64_t);
+template void LangtonsAnt::StepBackMany(Grid&, uint64_t, std::vector<CellChange>&);
+template void LangtonsAnt::StepBackMany(ByteGrid&, uint64_t, std::vector<CellChange>&);
\ No newline at end of file
@@ -0,0 +1,80 @@
+// Defines Langton's Ant behavior and movement logic
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Grid.h"
+#include "SparseUniverse.h"
+
+// Row/column offsets for each direction (0 = up, 1 = right, 2 = down, 3 = left),
+// shared by every engine that moves ants
+inline constexpr int kRowDelta[4] = { -1, 0, 1, 0 };
+inline constexpr int kColDelta[4] = { 0, 1, 0, -1 };
+
+// Turn amount added to the direction: white cell turns right (+1), black turns left (+3).
+// Stepping back reads the color the step wrote, the opposite of the one it
+// read, so the same table also undoes the turn.
+inline constexpr int kTurn[2] = { 1, 3 };
+
+// A cell the ant flipped and the value it was flipped to
+struct CellChange
+{
+    int64_t row, col;
+    bool alive;
+};
+
+class LangtonsAnt
+{
+public:
+    // Constructor: sets the ant's starting position on the grid (and its direction, UP by default)
+    LangtonsAnt(int64_t startRow, int64_t startCol, int startDirection = 0);
+
+    // Runs one step of the simulation: moves the ant and flips the cell color
+    template <typename Storage>
+    void Step(BasicGrid<Storage>& grid);
+
+    // Runs n steps in one tight loop (no UI work in between)
+    template <typename Storage>
+    void StepMany(BasicGrid<Storage>& grid, uint64_t n);
+
+    // Runs n steps on the unbounded plane (no wraparound)
+    void StepMany(SparseUniverse& universe, uint64_t n);
+
+    // Same as StepMany, but every flipped cell is also appended to changes
+    template <typename Storage>
+    void StepMany(BasicGrid<Storage>& grid, uint64_t n, std::vector<CellChange>& changes);
+    void StepMany(SparseUniverse& universe, uint64_t n, std::vector<CellChange>& changes);
+
+    // The rule is a bijection, so every step can be undone: the ant moves back
+    // against the direction it faces, flips the cell back and undoes the turn
+    // the restored color called for. StepBackMany(n) after StepMany(n) gives
+    // back the starting universe and ant exactly, at the same speed.
+    template <typename Storage>
+    void StepBack(BasicGrid<Storage>& grid);
+    template <typename Storage>
+    void StepBackMany(BasicGrid<Storage>& grid, uint64_t n);
+    template <typename Storage>
+    void StepBackMany(BasicGrid<Storage>& grid, uint64_t n, std::vector<CellChange>& changes);
+    void StepBackMany(SparseUniverse& universe, uint64_t n);
+    void StepBackMany(SparseUniverse& universe, uint64_t n, std::vector<CellChange>& changes);
+
+    int64_t GetRow() const { return row; }
+    int64_t GetCol() const { return col; }
+    int GetDirection() const { return dir; }  // 0 = up, 1 = right, 2 = down, 3 = left
+
+private:
+    int64_t row, col;  // Current position of the ant on the grid (or plane)
+
+    // Directions the ant can face and move
+    enum Direction { UP, RIGHT, DOWN, LEFT } dir;
+
+    void TurnRight();     // Turn ant 90 degrees right
+    void TurnLeft();      // Turn ant 90 degrees left
+    void MoveForward(int rows, int cols);  // Move ant forward one cell, respecting grid boundaries
+
+    // Shared step loops; Record adds the change list writes and Backward
+    // runs the inverse rule, both at compile time
+    template <bool Record, bool Backward, typename Storage>
+    void RunGrid(BasicGrid<Storage>& grid, uint64_t n, std::vector<CellChange>* changes);
+    template <bool Record, bool Backward>
+    void RunPlane(SparseUniverse& universe, uint64_t n, std::vector<CellChange>* changes);
+};
@@ -0,0 +1,504 @@
+// Implements the memoized quadtree engine
+
+#include "MacroAnt.h"
+#include <algorithm>
+
+namespace
+{
+    // Rough size of one cached walk with its list and hash map bookkeeping
+    const size_t kWalkOverhead = 8 * sizeof(void*);
+
+    uint64_t Mix(uint64_t h)
+    {
+        h *= 0x9E3779B97F4A7C15ull;
+        return h ^ (h >> 29);
+    }
+}
+
+size_t MacroAnt::WalkKeyHash::operator()(const WalkKey& key) const
+{
+    return static_cast<size_t>(Mix(Mix(Mix(key.node | uint64_t(key.dir) << 32) ^ uint64_t(key.row)) ^ uint64_t(key.col)));
+}
+
+MacroAnt::MacroAnt(size_t memoryBudget)
+    : emptyNodes(kMaxLevel + 1, kNone)
+{
+    // Half the budget for nodes, half for cached walks
+    nodeCapacity = std::max<size_t>(4096, memoryBudget / 2 / (sizeof(Node) + 2 * sizeof(uint32_t)));
+    walkCapacity = std::max<size_t>(1024, memoryBudget / 2 / (sizeof(CachedWalk) + kWalkOverhead));
+    Load(SparseUniverse(), LangtonsAnt(0, 0));
+}
+
+void MacroAnt::Load(const SparseUniverse& universe, const LangtonsAnt& ant)
+{
+    // Bounding box of the tiles and the ant, in cells
+    int64_t minRow = ant.GetRow(), maxRow = ant.GetRow();
+    int64_t minCol = ant.GetCol(), maxCol = ant.GetCol();
+    universe.ForEachTile([&](int64_t tileRow, int64_t tileCol, const SparseUniverse::Tile&) {
+        minRow = std::min(minRow, tileRow * SparseUniverse::kTileSize);
+        maxRow = std::max(maxRow, tileRow * SparseUniverse::kTileSize + SparseUniverse::kTileMask);
+        minCol = std::min(minCol, tileCol * SparseUniverse::kTileSize);
+        maxCol = std::max(maxCol, tileCol * SparseUniverse::kTileSize + SparseUniverse::kTileMask);
+    });
+
+    // Tile-aligned with a tile of margin, so each tile becomes one level-6 subtree
+    originRow = ((minRow >> SparseUniverse::kTileShift) - 1) * SparseUniverse::kTileSize;
+    originCol = ((minCol >> SparseUniverse::kTileShift) - 1) * SparseUniverse::kTileSize;
+    const int64_t span = std::max(maxRow - originRow, maxCol - originCol) + SparseUniverse::kTileSize + 1;
+    rootLevel = SparseUniverse::kTileShift + 1;
+    while ((int64_t(1) << rootLevel) < span)
+        ++rootLevel;
+
+    root = Empty(rootLevel);
+    universe.ForEachTile([&](int64_t tileRow, int64_t tileCol, const SparseUniverse::Tile& tile) {
+        const uint32_t sub = BuildTile(tile, SparseUniverse::kTileShift, 0, 0);
+        if (sub != Empty(SparseUniverse::kTileShift))
+        {
+            root = Insert(root, rootLevel, tileRow * SparseUniverse::kTileSize - originRow,
+                tileCol * SparseUniverse::kTileSize - originCol, sub, SparseUniverse::kTileShift);
+        }
+    });
+
+    antRow = ant.GetRow() - originRow;
+    antCol = ant.GetCol() - originCol;
+    antDir = ant.GetDirection();
+}
+
+void MacroAnt::StepMany(uint64_t n)
+{
+    while (n > 0)
+    {
+        const Outcome outcome = Walk(root, antRow, antCol, antDir, n);
+        root = outcome.node;
+        antRow = outcome.row;
+        antCol = outcome.col;
+        antDir = outcome.dir;
+        n -= outcome.steps;
+        if (outcome.exited)
+            Grow();
+    }
+}
+
+void MacroAnt::Store(SparseUniverse& universe) const
+{
+    universe.Clear();
+    Emit(root, 0, 0, universe);
+}
+
+LangtonsAnt MacroAnt::GetAnt() const
+{
+    return LangtonsAnt(originRow + antRow, originCol + antCol, antDir);
+}
+
+bool MacroAnt::Get(int64_t row, int64_t col) const
+{
+    row -= originRow;
+    col -= originCol;
+    int level = rootLevel;
+    if (row < 0 || col < 0 || row >= (int64_t(1) << level) || col >= (int64_t(1) << level))
+        return false;
+
+    uint32_t node = root;
+    for (; level > kLeafLevel; --level)
+    {
+        const int64_t half = int64_t(1) << (level - 1);
+        const int q = int(row >= half) * 2 + int(col >= half);
+        row -= (q >> 1) * half;
+        col -= (q & 1) * half;
+        node = nodes[node].child[q];
+    }
+    return (nodes[node].bits >> (row * 8 + col)) & 1;
+}
+
+uint64_t MacroAnt::CountAlive() const
+{
+    std::unordered_map<uint32_t, uint64_t> counts;  // Shared subtrees are counted once
+    return CountAlive(root, counts);
+}
+
+void MacroAnt::CopyRegion(int64_t row0, int64_t col0, Grid& out) const
+{
+    for (int r = 0; r < out.Rows(); ++r)
+        for (int c = 0; c < out.Cols(); ++c)
+            out.Set(r, c, Get(row0 + r, col0 + c));
+}
+
+size_t MacroAnt::MemoryBytes() const
+{
+    return nodes.capacity() * sizeof(Node) + table.capacity() * sizeof(uint32_t) +
+        freeNodes.capacity() * sizeof(uint32_t) + lru.size() * (sizeof(CachedWalk) + kWalkOverhead) +
+        walks.bucket_count() * sizeof(void*);
+}
+
+// Walks the ant through node until it leaves it or budget steps are done
+MacroAnt::Outcome MacroAnt::Walk(uint32_t node, int64_t row, int64_t col, int dir, uint64_t budget)
+{
+    const WalkKey key{ node, uint32_t(dir), row, col };
+    if (const Outcome* cached = Recall(key))
+    {
+        if (cached->steps <= budget)
+        {
+            ++hits;
+            return *cached;
+        }
+    }
+    ++misses;
+
+    const int level = nodes[node].level;
+    if (level == kLeafLevel)
+    {
+        const Outcome outcome = WalkLeaf(node, row, col, dir, budget);
+        if (outcome.exited)
+            Remember(key, outcome);
+        return outcome;
+    }
+
+    // Walk through the children until the ant leaves this node
+    Frame frame{ node, {} };
+    std::copy(nodes[node].child, nodes[node].child + 4, frame.child);
+    frames.push_back(&frame);
+
+    const int64_t half = int64_t(1) << (level - 1);
+    uint64_t used = 0;
+    bool exited = false;
+    while (used < budget)
+    {
+        if (liveNodes > nodeCapacity)
+            Collect();
+
+        const int q = int(row >= half) * 2 + int(col >= half);
+        const int64_t row0 = (q >> 1) * half;
+        const int64_t col0 = (q & 1) * half;
+        const Outcome inner = Walk(frame.child[q], row - row0, col - col0, dir, budget - used);
+        frame.child[q] = inner.node;
+        used += inner.steps;
+        row = inner.row + row0;
+        col = inner.col + col0;
+        dir = inner.dir;
+
+        if (!inner.exited)
+            break;
+        if (row < 0 || col < 0 || row >= 2 * half || col >= 2 * half)
+        {
+            exited = true;
+            break;
+        }
+    }
+    frames.pop_back();
+
+    // A walk cut short by the budget depends on the budget, so only finished ones are cached
+    const Outcome outcome{ MakeNode(level, frame.child), row, col, dir, exited, used };
+    if (exited)
+        Remember(key, outcome);
+    return outcome;
+}
+
+// Plain steps on the 64 bits of a leaf
+MacroAnt::Outcome MacroAnt::WalkLeaf(uint32_t node, int64_t row, int64_t col, int dir, uint64_t budget)
+{
+    uint64_t bits = nodes[node].bits;
+    uint64_t steps = 0;
+    bool exited = false;
+    while (steps < budget)
+    {
+        const uint64_t bit = uint64_t(1) << (row * 8 + col);
+        const bool cell = (bits & bit) != 0;
+        bits ^= bit;
+        dir = (dir + kTurn[cell]) & 3;
+        row += kRowDelta[dir];
+        col += kColDelta[dir];
+        ++steps;
+        if (uint64_t(row) >= 8 || uint64_t(col) >= 8)
+        {
+            exited = true;
+            break;
+        }
+    }
+    return Outcome{ MakeLeaf(bits), row, col, dir, exited, steps };
+}
+
+const MacroAnt::Outcome* MacroAnt::Recall(const WalkKey& key)
+{
+    auto found = walks.find(key);
+    if (found == walks.end())
+        return nullptr;
+    lru.splice(lru.begin(), lru, found->second);
+    return &found->second->outcome;
+}
+
+void MacroAnt::Remember(const WalkKey& key, const Outcome& outcome)
+{
+    auto found = walks.find(key);
+    if (found != walks.end())
+    {
+        found->second->outcome = outcome;
+        lru.splice(lru.begin(), lru, found->second);
+        return;
+    }
+
+    if (lru.size() >= walkCapacity)
+        EvictTo(walkCapacity - 1);
+    lru.push_front(CachedWalk{ key, outcome });
+    walks.emplace(key, lru.begin());
+}
+
+// Drops the least recently used walks until count are left
+void MacroAnt::EvictTo(size_t count)
+{
+    while (lru.size() > count)
+    {
+        walks.erase(lru.back().key);
+        lru.pop_back();
+        ++evictions;
+    }
+}
+
+uint32_t MacroAnt::MakeLeaf(uint64_t bits)
+{
+    Node node{ { kNone, kNone, kNone, kNone }, bits, uint8_t(kLeafLevel) };
+    return Intern(node);
+}
+
+uint32_t MacroAnt::MakeNode(int level, const uint32_t child[4])
+{
+    Node node{ { child[0], child[1], child[2], child[3] }, 0, uint8_t(level) };
+    return Intern(node);
+}
+
+namespace
+{
+    template <typename Node>
+    uint64_t NodeHash(const Node& node)
+    {
+        const uint64_t low = node.child[0] | uint64_t(node.child[1]) << 32;
+        const uint64_t high = node.child[2] | uint64_t(node.child[3]) << 32;
+        return Mix(Mix(Mix(node.bits ^ node.level) ^ low) ^ high);
+    }
+
+    template <typename Node>
+    bool SameNode(const Node& a, const Node& b)
+    {
+        return a.level == b.level && a.bits == b.bits && a.child[0] == b.child[0] &&
+            a.child[1] == b.child[1] && a.child[2] == b.child[2] && a.child[3] == b.child[3];
+    }
+}
+
+// Returns the id of the node with these contents, adding it if it's new
+uint32_t MacroAnt::Intern(const Node& node)
+{
+    // Keep the load factor under one half so probe chains stay short
+    if ((liveNodes + 1) * 2 > table.size())
+        Rehash(std::max<size_t>(1024, table.size() * 2));
+
+    const size_t mask = table.size() - 1;
+    size_t i = NodeHash(node) & mask;
+    while (table[i] != kNone)
+    {
+        if (SameNode(nodes[table[i]], node))
+            return table[i];
+        i = (i + 1) & mask;
+    }
+
+    uint32_t id;
+    if (!freeNodes.empty())
+    {
+        id = freeNodes.back();
+        freeNodes.pop_back();
+        nodes[id] = node;
+    }
+    else
+    {
+        id = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(node);
+    }
+    table[i] = id;
+    ++liveNodes;
+    return id;
+}
+
+uint32_t MacroAnt::Empty(int level)
+{
+    if (emptyNodes[level] == kNone)
+    {
+        if (level == kLeafLevel)
+        {
+            emptyNodes[level] = MakeLeaf(0);
+        }
+        else
+        {
+            const uint32_t child = Empty(level - 1);
+            const uint32_t children[4] = { child, child, child, child };
+            emptyNodes[level] = MakeNode(level, children);
+        }
+    }
+    return emptyNodes[level];
+}
+
+void MacroAnt::Rehash(size_t capacity)
+{
+    table.assign(capacity, kNone);
+    const size_t mask = capacity - 1;
+    for (uint32_t id = 0; id < nodes.size(); ++id)
+    {
+        if (nodes[id].level == kFree)
+            continue;
+        size_t i = NodeHash(nodes[id]) & mask;
+        while (table[i] != kNone)
+            i = (i + 1) & mask;
+        table[i] = id;
+    }
+}
+
+// Frees the nodes that neither the universe, a walk in progress nor a cached
+// walk still uses. Older cached walks are dropped first so their nodes can go.
+void MacroAnt::Collect()
+{
+    std::vector<uint8_t> marks;
+    size_t kept = 0;
+    for (size_t keep : { lru.size() / 2, size_t(0) })
+    {
+        EvictTo(keep);
+        marks.assign(nodes.size(), 0);
+        Mark(root, marks);
+        for (uint32_t empty : emptyNodes)
+            Mark(empty, marks);
+        for (const Frame* frame : frames)
+        {
+            Mark(frame->node, marks);
+            for (uint32_t child : frame->child)
+                Mark(child, marks);
+        }
+        for (const CachedWalk& walk : lru)
+        {
+            Mark(walk.key.node, marks);
+            Mark(walk.outcome.node, marks);
+        }
+
+        kept = size_t(std::count(marks.begin(), marks.end(), uint8_t(1)));
+        if (kept <= nodeCapacity * 3 / 4)
+            break;
+    }
+
+    for (uint32_t id = 0; id < nodes.size(); ++id)
+    {
+        if (!marks[id] && nodes[id].level != kFree)
+        {
+            nodes[id].level = kFree;
+            freeNodes.push_back(id);
+        }
+    }
+    liveNodes = kept;
+    Rehash(table.size());
+
+    // The universe alone can outgrow the budget; then collecting again soon would free nothing
+    if (liveNodes > nodeCapacity * 3 / 4)
+        nodeCapacity = liveNodes * 2;
+    ++collections;
+}
+
+void MacroAnt::Mark(uint32_t node, std::vector<uint8_t>& marks) const
+{
+    if (node == kNone || marks[node])
+        return;
+    marks[node] = 1;
+    if (nodes[node].level > kLeafLevel)
+    {
+        for (uint32_t child : nodes[node].child)
+            Mark(child, marks);
+    }
+}
+
+// Puts the root in the middle of a root twice its size, so the ant that just left it is back inside
+void MacroAnt::Grow()
+{
+    if (rootLevel >= kMaxLevel)
+        return;
+
+    const uint32_t e = Empty(rootLevel - 1);
+    const Node old = nodes[root];
+    const uint32_t nw[4] = { e, e, e, old.child[0] };
+    const uint32_t ne[4] = { e, e, old.child[1], e };
+    const uint32_t sw[4] = { e, old.child[2], e, e };
+    const uint32_t se[4] = { old.child[3], e, e, e };
+    const uint32_t quads[4] = { MakeNode(rootLevel, nw), MakeNode(rootLevel, ne), MakeNode(rootLevel, sw), MakeNode(rootLevel, se) };
+    root = MakeNode(rootLevel + 1, quads);
+
+    const int64_t half = int64_t(1) << (rootLevel - 1);
+    antRow += half;
+    antCol += half;
+    originRow -= half;
+    originCol -= half;
+    ++rootLevel;
+}
+
+// Returns node with sub (a node of subLevel) placed with its top-left cell at (row, col)
+uint32_t MacroAnt::Insert(uint32_t node, int level, int64_t row, int64_t col, uint32_t sub, int subLevel)
+{
+    if (level == subLevel)
+        return sub;
+
+    const int64_t half = int64_t(1) << (level - 1);
+    const int q = int(row >= half) * 2 + int(col >= half);
+    uint32_t child[4];
+    std::copy(nodes[node].child, nodes[node].child + 4, child);
+    child[q] = Insert(child[q], level - 1, row - (q >> 1) * half, col - (q & 1) * half, sub, subLevel);
+    return MakeNode(level, child);
+}
+
+// The node for the 2^level square of tile cells whose top-left cell is (row0, col0)
+uint32_t MacroAnt::BuildTile(const SparseUniverse::Tile& tile, int level, int row0, int col0)
+{
+    if (level == kLeafLevel)
+    {
+        uint64_t bits = 0;
+        for (int r = 0; r < 8; ++r)
+            bits |= ((tile.rows[row0 + r] >> col0) & 0xFF) << (r * 8);
+        return MakeLeaf(bits);
+    }
+
+    const int half = 1 << (level - 1);
+    const uint32_t child[4] = {
+        BuildTile(tile, level - 1, row0, col0),
+        BuildTile(tile, level - 1, row0, col0 + half),
+        BuildTile(tile, level - 1, row0 + half, col0),
+        BuildTile(tile, level - 1, row0 + half, col0 + half),
+    };
+    return MakeNode(level, child);
+}
+
+// Sets the living cells of node, whose top-left cell is (row0, col0) relative to the origin
+void MacroAnt::Emit(uint32_t node, int64_t row0, int64_t col0, SparseUniverse& universe) const
+{
+    const Node& n = nodes[node];
+    if (n.level == kLeafLevel)
+    {
+        for (uint64_t bits = n.bits; bits; bits &= bits - 1)
+        {
+            const int bit = PopCount64((bits & (~bits + 1)) - 1);  // Index of the lowest set bit
+            universe.Set(originRow + row0 + (bit >> 3), originCol + col0 + (bit & 7), true);
+        }
+        return;
+    }
+    if (node == emptyNodes[n.level])
+        return;
+
+    const int64_t half = int64_t(1) << (n.level - 1);
+    for (int q = 0; q < 4; ++q)
+        Emit(n.child[q], row0 + (q >> 1) * half, col0 + (q & 1) * half, universe);
+}
+
+uint64_t MacroAnt::CountAlive(uint32_t node, std::unordered_map<uint32_t, uint64_t>& counts) const
+{
+    const Node& n = nodes[node];
+    if (n.level == kLeafLevel)
+        return uint64_t(PopCount64(n.bits));
+
+    auto found = counts.find(node);
+    if (found != counts.end())
+        return found->second;
+    uint64_t count = 0;
+    for (uint32_t child : n.child)
+        count += CountAlive(child, counts);
+    counts.emplace(node, count);
+    return count;
+}
@@ -0,0 +1,159 @@
+// Defines MacroAnt, a memoized engine for very long runs of Langton's ant on
+// the unbounded plane (in the spirit of HashLife).
+//
+// The plane is a quadtree whose leaves are 8x8 blocks. Nodes are hash-consed:
+// two regions with the same cells are the same node, so a node id stands for
+// its contents. When the ant enters a node, the engine caches where it leaves
+// it: (node, entry cell, direction) -> (node afterwards, exit cell, direction,
+// steps taken). A walk through a node is made of walks through its four
+// children, so a long highway through empty space turns into a few cache
+// lookups per level instead of steps. A walk that can't finish inside the
+// remaining step budget splits into its children and isn't cached.
+//
+// Cached walks and nodes share a memory budget. The cache drops its least
+// recently used walks when full; when there are too many nodes, the unused
+// ones are collected (after dropping older walks that keep them alive).
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "LangtonsAnt.h"
+#include "SparseUniverse.h"
+
+class MacroAnt
+{
+public:
+    static constexpr size_t kDefaultBudget = size_t(256) << 20;  // Bytes
+
+    explicit MacroAnt(size_t memoryBudget = kDefaultBudget);
+
+    // Takes the cells and the ant to start from. Cached walks are kept, so a
+    // reloaded universe still benefits from earlier runs.
+    void Load(const SparseUniverse& universe, const LangtonsAnt& ant);
+
+    // Same result as ant.StepMany(universe, n) on the loaded state
+    void StepMany(uint64_t n);
+
+    // Writes the current cells into universe (which is cleared first)
+    void Store(SparseUniverse& universe) const;
+
+    LangtonsAnt GetAnt() const;
+    bool Get(int64_t row, int64_t col) const;
+    uint64_t CountAlive() const;
+
+    // Copies the window whose top-left plane cell is (row0, col0) into out, like SparseUniverse::CopyRegion
+    void CopyRegion(int64_t row0, int64_t col0, Grid& out) const;
+
+    // Cache statistics
+    uint64_t Hits() const { return hits; }
+    uint64_t Misses() const { return misses; }
+    uint64_t Evictions() const { return evictions; }
+    uint64_t Collections() const { return collections; }
+    size_t NodeCount() const { return liveNodes; }
+    size_t CachedWalks() const { return lru.size(); }
+    size_t MemoryBytes() const;
+
+private:
+    static constexpr int kLeafLevel = 3;   // Leaves are 8x8 cells, one bit each
+    static constexpr int kMaxLevel = 62;
+    static constexpr uint32_t kNone = 0xFFFFFFFFu;
+    static constexpr uint8_t kFree = 0xFF;  // Level of a collected node
+
+    struct Node
+    {
+        uint32_t child[4];  // NW, NE, SW, SE (kNone for leaves)
+        uint64_t bits;      // Leaves: cell (r, c) is bit r * 8 + c
+        uint8_t level;      // Covers 2^level x 2^level cells
+    };
+
+    // Where a walk through a node ended; exited is false when the step budget ran out first
+    struct Outcome
+    {
+        uint32_t node;      // The node after the walk
+        int64_t row, col;   // The ant, relative to the node (just outside it after an exit)
+        int dir;
+        bool exited;
+        uint64_t steps;
+    };
+
+    struct WalkKey
+    {
+        uint32_t node;
+        uint32_t dir;
+        int64_t row, col;
+        bool operator==(const WalkKey& other) const
+        {
+            return node == other.node && dir == other.dir && row == other.row && col == other.col;
+        }
+    };
+
+    struct WalkKeyHash
+    {
+        size_t operator()(const WalkKey& key) const;
+    };
+
+    struct CachedWalk
+    {
+        WalkKey key;
+        Outcome outcome;
+    };
+
+    // A node being rebuilt by a walk; its ids must survive a collection
+    struct Frame
+    {
+        uint32_t node;
+        uint32_t child[4];
+    };
+
+    Outcome Walk(uint32_t node, int64_t row, int64_t col, int dir, uint64_t budget);
+    Outcome WalkLeaf(uint32_t node, int64_t row, int64_t col, int dir, uint64_t budget);
+
+    const Outcome* Recall(const WalkKey& key);
+    void Remember(const WalkKey& key, const Outcome& outcome);
+    void EvictTo(size_t count);
+
+    uint32_t MakeLeaf(uint64_t bits);
+    uint32_t MakeNode(int level, const uint32_t child[4]);
+    uint32_t Intern(const Node& node);
+    uint32_t Empty(int level);
+    void Rehash(size_t capacity);
+
+    void Collect();
+    void Mark(uint32_t node, std::vector<uint8_t>& marks) const;
+
+    void Grow();
+    uint32_t Insert(uint32_t node, int level, int64_t row, int64_t col, uint32_t sub, int subLevel);
+    uint32_t BuildTile(const SparseUniverse::Tile& tile, int level, int row0, int col0);
+    void Emit(uint32_t node, int64_t row0, int64_t col0, SparseUniverse& universe) const;
+    uint64_t CountAlive(uint32_t node, std::unordered_map<uint32_t, uint64_t>& counts) const;
+
+    // Hash-consed nodes: the pool, its free list and an open-addressing table of ids
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeNodes;
+    std::vector<uint32_t> table;          // Capacity is always a power of two
+    std::vector<uint32_t> emptyNodes;     // Empty node of each level, made on first use
+    size_t liveNodes = 0;
+    size_t nodeCapacity;                  // Collect above this many nodes
+
+    // Walk cache, most recently used first
+    std::list<CachedWalk> lru;
+    std::unordered_map<WalkKey, std::list<CachedWalk>::iterator, WalkKeyHash> walks;
+    size_t walkCapacity;
+
+    std::vector<Frame*> frames;           // Walks in progress, outermost first
+
+    // The universe: the root node covers [originRow, originRow + 2^rootLevel) and the same for columns
+    uint32_t root = kNone;
+    int rootLevel = 0;
+    int64_t originRow = 0, originCol = 0;
+    int64_t antRow = 0, antCol = 0;       // Relative to the origin
+    int antDir = 0;
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t collections = 0;
+};
@@ -0,0 +1,340 @@
+// Implements the file-backed universe and its tile layout
+
+#include "MappedUniverse.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#if defined _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const char kMagic[4] = { 'A', 'N', 'T', 'M' };
+    const uint32_t kVersion = 1;
+
+    // The three bits of a tile coordinate spread out for the Z-order index
+    const int kSpread[8] = { 0, 1, 4, 5, 16, 17, 20, 21 };
+
+    const int kTilesPerBlock = 64;
+
+    // Bytes a universe of rows x cols cells maps, or 0 if the size can't be used
+    size_t MappedSize(int64_t rows, int64_t cols)
+    {
+        if (rows <= 0 || cols <= 0 || rows % 64 != 0 || cols % 64 != 0 || rows > (int64_t(1) << 31) || cols > (int64_t(1) << 31))
+            return 0;
+        const uint64_t blockRows = (uint64_t(rows) + 511) / 512;
+        const uint64_t blockCols = (uint64_t(cols) + 511) / 512;
+        const uint64_t bytes = blockRows * blockCols * kTilesPerBlock * (64 * sizeof(uint64_t));
+        if (bytes > uint64_t(SIZE_MAX) - MappedUniverse::kHeaderBytes)
+            return 0;
+        return MappedUniverse::kHeaderBytes + size_t(bytes);
+    }
+}
+
+MappedUniverse::~MappedUniverse()
+{
+    Close();
+}
+
+bool MappedUniverse::Create(const std::string& path, int64_t newRows, int64_t newCols)
+{
+    Close();
+    if (!Map(path, newRows, newCols, true))
+        return false;
+
+    // New pages read as zero, so only the header needs writing
+    std::memcpy(header->magic, kMagic, 4);
+    header->version = kVersion;
+    header->rows = newRows;
+    header->cols = newCols;
+    header->antRow = newRows / 2;
+    header->antCol = newCols / 2;
+    header->antDirection = 0;
+    header->generation = 0;
+    return true;
+}
+
+bool MappedUniverse::Open(const std::string& path)
+{
+    Close();
+
+    Header saved;
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.read(reinterpret_cast<char*>(&saved), sizeof(saved)))
+            return false;
+    }
+    if (std::memcmp(saved.magic, kMagic, 4) != 0 || saved.version != kVersion)
+        return false;
+
+    if (!Map(path, saved.rows, saved.cols, false))
+        return false;
+
+    // Ants saved outside the universe would index past the mapping
+    if (header->antRow < 0 || header->antRow >= rows || header->antCol < 0 || header->antCol >= cols || header->antDirection > 3)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedUniverse::Map(const std::string& path, int64_t newRows, int64_t newCols, bool create)
+{
+    const size_t bytes = MappedSize(newRows, newCols);
+    if (bytes == 0)
+        return false;
+
+    anonymous = path.empty();
+#if defined _WIN32
+    if (anonymous)
+    {
+        base = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    }
+    else
+    {
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+            create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER length;
+        if (!create && (!GetFileSizeEx(file, &length) || uint64_t(length.QuadPart) < bytes))
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        // Mapping more than the file holds extends it
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, DWORD(uint64_t(bytes) >> 32), DWORD(bytes), nullptr);
+        if (mapping)
+        {
+            base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+            CloseHandle(mapping);  // The view keeps the mapping alive
+        }
+        if (base)
+            fileHandle = file;     // Kept for FlushFileBuffers in Sync
+        else
+            CloseHandle(file);
+    }
+    if (!base)
+        return false;
+#else
+    if (anonymous)
+    {
+        // Nothing is committed until a page is touched
+        void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mapped == MAP_FAILED)
+            return false;
+        base = mapped;
+    }
+    else
+    {
+        const int fd = open(path.c_str(), O_RDWR | (create ? O_CREAT | O_TRUNC : 0), 0644);
+        if (fd < 0)
+            return false;
+
+        // A new file is extended without writing, so its dead cells take no disk space
+        struct stat info;
+        const bool sized = create ? ftruncate(fd, off_t(bytes)) == 0
+            : fstat(fd, &info) == 0 && uint64_t(info.st_size) >= bytes;
+        void* mapped = sized ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        close(fd);  // The mapping keeps the file open
+        if (mapped == MAP_FAILED)
+            return false;
+        base = mapped;
+    }
+
+    // The ant's walk, not the file order, predicts the next pages; Prefetch asks for those
+    madvise(base, bytes, MADV_RANDOM);
+#endif
+
+    mappedBytes = bytes;
+    header = static_cast<Header*>(base);
+    tiles = reinterpret_cast<Tile*>(static_cast<char*>(base) + kHeaderBytes);
+    rows = newRows;
+    cols = newCols;
+    tileRows = rows >> kTileShift;
+    tileCols = cols >> kTileShift;
+    blockRows = (tileRows + 7) >> kBlockShift;
+    blockCols = (tileCols + 7) >> kBlockShift;
+    return true;
+}
+
+void MappedUniverse::Close()
+{
+    if (base)
+    {
+#if defined _WIN32
+        if (anonymous)
+            VirtualFree(base, 0, MEM_RELEASE);
+        else
+            UnmapViewOfFile(base);
+        if (fileHandle)
+            CloseHandle(fileHandle);
+#else
+        munmap(base, mappedBytes);
+#endif
+    }
+    base = nullptr;
+    fileHandle = nullptr;
+    header = nullptr;
+    tiles = nullptr;
+    mappedBytes = 0;
+    rows = cols = 0;
+    tileRows = tileCols = 0;
+    blockRows = blockCols = 0;
+    prefetchRow = prefetchCol = -1;
+}
+
+MappedUniverse::Tile* MappedUniverse::TileAt(int64_t tileRow, int64_t tileCol) const
+{
+    const int64_t block = (tileRow >> kBlockShift) * blockCols + (tileCol >> kBlockShift);
+    return tiles + block * kTilesPerBlock + (kSpread[tileCol & 7] | (kSpread[tileRow & 7] << 1));
+}
+
+bool MappedUniverse::Get(int64_t row, int64_t col) const
+{
+    return (TileAt(row >> kTileShift, col >> kTileShift)->rows[row & kTileMask] >> (col & kTileMask)) & 1;
+}
+
+void MappedUniverse::Set(int64_t row, int64_t col, bool alive)
+{
+    uint64_t& word = TileAt(row >> kTileShift, col >> kTileShift)->rows[row & kTileMask];
+    const uint64_t mask = uint64_t(1) << (col & kTileMask);
+    word = alive ? word | mask : word & ~mask;
+}
+
+bool MappedUniverse::Flip(int64_t row, int64_t col)
+{
+    uint64_t& word = TileAt(row >> kTileShift, col >> kTileShift)->rows[row & kTileMask];
+    const bool old = (word >> (col & kTileMask)) & 1;
+    word ^= uint64_t(1) << (col & kTileMask);
+    return old;
+}
+
+// The plane's tile-local loop (see LangtonsAnt::RunPlane), wrapping at the
+// edges, with the tile found by arithmetic instead of a hash lookup
+void MappedUniverse::StepMany(LangtonsAnt& ant, uint64_t n)
+{
+    int64_t tileRow = ant.GetRow() >> kTileShift;
+    int64_t tileCol = ant.GetCol() >> kTileShift;
+    int r = static_cast<int>(ant.GetRow() & kTileMask);
+    int c = static_cast<int>(ant.GetCol() & kTileMask);
+    int dr = kRowDelta[ant.GetDirection()];
+    int dc = kColDelta[ant.GetDirection()];
+
+    Prefetch(tileRow >> kBlockShift, tileCol >> kBlockShift);
+    Tile* tile = TileAt(tileRow, tileCol);
+
+    for (uint64_t i = 0; i < n; ++i)
+    {
+        uint64_t& word = tile->rows[r];
+        const int cell = static_cast<int>((word >> c) & 1);
+        word ^= uint64_t(1) << c;
+
+        // Right turn maps (dr, dc) to (dc, -dr); a left turn is its negation
+        const int negate = -cell;
+        const int nextDr = (dc ^ negate) - negate;
+        dc = (-dr ^ negate) - negate;
+        dr = nextDr;
+
+        r += dr;
+        c += dc;
+        if (static_cast<unsigned>(r | c) >= static_cast<unsigned>(kTileSize))
+        {
+            tileRow += r >> kTileShift;  // -1, 0 or +1
+            tileCol += c >> kTileShift;
+            r &= kTileMask;
+            c &= kTileMask;
+            tileRow += tileRows & -int64_t(tileRow < 0);
+            tileRow -= tileRows & -int64_t(tileRow >= tileRows);
+            tileCol += tileCols & -int64_t(tileCol < 0);
+            tileCol -= tileCols & -int64_t(tileCol >= tileCols);
+
+            Prefetch(tileRow >> kBlockShift, tileCol >> kBlockShift);
+            tile = TileAt(tileRow, tileCol);
+        }
+    }
+
+    const int direction = dr < 0 ? 0 : dr > 0 ? 2 : dc > 0 ? 1 : 3;
+    ant = LangtonsAnt(tileRow * kTileSize + r, tileCol * kTileSize + c, direction);
+}
+
+// Asks for the 3x3 blocks around the ant once it leaves the ones asked for last
+void MappedUniverse::Prefetch(int64_t blockRow, int64_t blockCol)
+{
+    if (prefetchRow >= 0 && std::abs(blockRow - prefetchRow) <= 1 && std::abs(blockCol - prefetchCol) <= 1)
+        return;
+    prefetchRow = blockRow;
+    prefetchCol = blockCol;
+#if !defined _WIN32
+    const size_t blockBytes = kTilesPerBlock * sizeof(Tile);
+    for (int64_t dr = -1; dr <= 1; ++dr)
+    {
+        for (int64_t dc = -1; dc <= 1; ++dc)
+        {
+            const int64_t br = (blockRow + dr + blockRows) % blockRows;
+            const int64_t bc = (blockCol + dc + blockCols) % blockCols;
+            madvise(tiles + (br * blockCols + bc) * kTilesPerBlock, blockBytes, MADV_WILLNEED);
+        }
+    }
+#endif
+}
+
+void MappedUniverse::CopyRegion(int64_t row0, int64_t col0, Grid& out) const
+{
+    out.Clear();
+    for (int r = 0; r < out.Rows(); ++r)
+    {
+        const int64_t row = ((row0 + r) % rows + rows) % rows;
+        uint64_t* bits = out.Row(r);
+        for (int c = 0; c < out.Cols(); ++c)
+        {
+            const int64_t col = ((col0 + c) % cols + cols) % cols;
+            bits[c >> 6] |= uint64_t(Get(row, col)) << (c & 63);
+        }
+    }
+}
+
+uint64_t MappedUniverse::CountAlive() const
+{
+    uint64_t count = 0;
+    const size_t words = size_t(blockRows * blockCols) * kTilesPerBlock * kTileSize;
+    const uint64_t* bits = tiles->rows;
+    for (size_t i = 0; i < words; ++i)
+        count += PopCount64(bits[i]);
+    return count;
+}
+
+LangtonsAnt MappedUniverse::SavedAnt() const
+{
+    return LangtonsAnt(header->antRow, header->antCol, static_cast<int>(header->antDirection));
+}
+
+uint64_t MappedUniverse::SavedGeneration() const
+{
+    return header->generation;
+}
+
+bool MappedUniverse::Sync(const LangtonsAnt& ant, uint64_t generation)
+{
+    if (!base || anonymous)
+        return false;
+    header->antRow = ant.GetRow();
+    header->antCol = ant.GetCol();
+    header->antDirection = static_cast<uint32_t>(ant.GetDirection());
+    header->generation = generation;
+#if defined _WIN32
+    return FlushViewOfFile(base, 0) && FlushFileBuffers(fileHandle);
+#else
+    return msync(base, mappedBytes, MS_SYNC) == 0;
+#endif
+}
@@ -0,0 +1,110 @@
+// Defines MappedUniverse, a wrapping grid of bit cells that lives in a
+// memory-mapped file instead of the heap, for universes larger than RAM
+// (a 1M x 1M grid is 125 GB). Only the pages the ant touches are resident;
+// the kernel writes the rest back and drops them as memory runs short.
+//
+// Cells are stored in 64x64 tiles (512 bytes, as in SparseUniverse). Tiles
+// are grouped into blocks of 8x8 tiles (512x512 cells, 32 KiB) stored one
+// after the other, and inside a block they follow a Z-order curve, so every
+// 4 KiB page holds a 4x2 patch of tiles and cells near the ant are on pages
+// near each other. When the ant walks into a new block, the blocks around it
+// are requested ahead (madvise WILLNEED).
+//
+// The file starts with a one-page header holding the size, the ant and the
+// generation. Sync writes them and flushes the dirty pages (msync), so a
+// checkpoint costs only the pages written since the previous one.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "Grid.h"
+#include "LangtonsAnt.h"
+
+class MappedUniverse
+{
+public:
+    static constexpr int kTileShift = 6;
+    static constexpr int kTileSize = 1 << kTileShift;  // Cells per tile side
+    static constexpr int kTileMask = kTileSize - 1;
+    static constexpr int kBlockShift = 3;              // Tiles per block side: 8
+    static constexpr size_t kHeaderBytes = 4096;
+
+    MappedUniverse() = default;
+    ~MappedUniverse();  // Unmaps without syncing the header; call Sync first to keep the ant
+
+    MappedUniverse(const MappedUniverse&) = delete;
+    MappedUniverse& operator=(const MappedUniverse&) = delete;
+
+    // Maps a new, dead universe of rows x cols cells (multiples of 64) backed
+    // by path, replacing any file there. An empty path maps anonymous memory
+    // instead, which gets pages only where it's touched (Sync then fails).
+    bool Create(const std::string& path, int64_t rows, int64_t cols);
+
+    // Maps a universe file written by Create and Sync, with its saved ant and generation
+    bool Open(const std::string& path);
+
+    void Close();
+    bool IsOpen() const { return base != nullptr; }
+
+    int64_t Rows() const { return rows; }
+    int64_t Cols() const { return cols; }
+    size_t MappedBytes() const { return mappedBytes; }
+
+    // Cell access; coordinates must be inside the universe
+    bool Get(int64_t row, int64_t col) const;
+    void Set(int64_t row, int64_t col, bool alive);
+    bool Flip(int64_t row, int64_t col);  // Returns the value before the flip
+
+    // Same result as ant.StepMany(grid, n) on a wrapping Grid of the same size
+    void StepMany(LangtonsAnt& ant, uint64_t n);
+
+    // Copies the window whose top-left cell is (row0, col0) into out, which
+    // keeps its size; the window wraps around the edges
+    void CopyRegion(int64_t row0, int64_t col0, Grid& out) const;
+
+    // Reads every page, so only meant for universes that fit in memory
+    uint64_t CountAlive() const;
+
+    // The ant and generation stored by the last Sync (or Create)
+    LangtonsAnt SavedAnt() const;
+    uint64_t SavedGeneration() const;
+
+    // Stores the ant and generation in the header and flushes every dirty
+    // page to the file. Returns false for anonymous memory or on an I/O error.
+    bool Sync(const LangtonsAnt& ant, uint64_t generation);
+
+private:
+    struct Tile
+    {
+        uint64_t rows[kTileSize];
+    };
+
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        int64_t rows, cols;
+        int64_t antRow, antCol;
+        uint32_t antDirection;
+        uint32_t reserved;
+        uint64_t generation;
+    };
+
+    bool Map(const std::string& path, int64_t newRows, int64_t newCols, bool create);
+    Tile* TileAt(int64_t tileRow, int64_t tileCol) const;
+    void Prefetch(int64_t blockRow, int64_t blockCol);
+
+    Header* header = nullptr;
+    Tile* tiles = nullptr;
+    void* base = nullptr;
+    size_t mappedBytes = 0;
+    bool anonymous = false;
+    void* fileHandle = nullptr;  // Windows: the file, kept open for FlushFileBuffers
+    int64_t rows = 0, cols = 0;
+    int64_t tileRows = 0, tileCols = 0;
+    int64_t blockRows = 0, blockCols = 0;
+
+    // The block the last prefetch was centered on (-1 before the first)
+    int64_t prefetchRow = -1, prefetchCol = -1;
+};
@@ -0,0 +1,34 @@
+// Implements the full neighbor count rebuild
+
+#include "NeighborCounts.h"
+
+// Loops through each cell and counts how many living neighbors it has
+void CountNeighbors(const Grid& grid, std::vector<int>& counts)
+{
+    const int rows = grid.Rows();
+    const int cols = grid.Cols();
+    counts.assign(size_t(rows) * cols, 0);
+
+    for (int row = 0; row < rows; ++row)
+    {
+        for (int col = 0; col < cols; ++col)
+        {
+            int count = 0;
+            for (int dr = -1; dr <= 1; ++dr)
+            {
+                for (int dc = -1; dc <= 1; ++dc)
+                {
+                    if (dr == 0 && dc == 0)
+                        continue;
+
+                    int r = row + dr;
+                    int c = col + dc;
+
+                    if (r >= 0 && r < rows && c >= 0 && c < cols && grid.Get(r, c))
+                        count++;
+                }
+            }
+            counts[size_t(row) * cols + col] = count;
+        }
+    }
+}
@@ -0,0 +1,10 @@
+// Declares the neighbor counting used by the neighbor-count overlay
+
+#pragma once
+
+#include <vector>
+#include "Grid.h"
+
+// Fills counts (rows * cols, row-major) with the number of living cells among
+// each cell's 8 neighbors. Cells past the edges count as dead (no wraparound).
+void CountNeighbors(const Grid& grid, std::vector<int>& counts);
@@ -0,0 +1,384 @@
+// Implements the striped, work-stealing colony update
+
+#include "ParallelColony.h"
+#include <algorithm>
+
+namespace
+{
+    // Stripes per thread; more stripes balance better but hand off more ants
+    const int kStripesPerThread = 8;
+
+    // Langton's ant on bit cells. Step is the sequential update; Read, Recolor
+    // and Turn are the three passes of the simultaneous one.
+    struct BitCells
+    {
+        Grid& grid;
+
+        int Step(int r, int c, uint8_t&, std::vector<CellChange>* log)
+        {
+            const bool old = grid.Flip(r, c);
+            if (log)
+                log->push_back(CellChange{ r, c, !old });
+            return kTurn[old];
+        }
+
+        int Read(int r, int c) const { return grid.Get(r, c); }
+
+        void Recolor(int r, int c, uint8_t, std::vector<CellChange>* log)
+        {
+            const bool old = grid.Flip(r, c);
+            if (log)
+                log->push_back(CellChange{ r, c, !old });
+        }
+
+        int Turn(int seen, uint8_t&) const { return kTurn[seen]; }
+
+        void StepColony(AntColony& colony, uint64_t n, std::vector<CellChange>* log)
+        {
+            if (log)
+                colony.StepMany(grid, n, *log);
+            else
+                colony.StepMany(grid, n);
+        }
+    };
+
+    // Any turmite rule on color cells
+    struct ColorCells
+    {
+        ByteGrid& grid;
+        const TurmiteRule& rule;
+
+        int Step(int r, int c, uint8_t& state, std::vector<CellChange>*)
+        {
+            uint8_t& cell = grid.Row(r)[c];
+            const TurmiteTransition& t = rule.table[state][cell];
+            cell = t.write;
+            state = t.next;
+            return t.turn;
+        }
+
+        int Read(int r, int c) const { return grid.Row(r)[c]; }
+
+        void Recolor(int r, int c, uint8_t state, std::vector<CellChange>*)
+        {
+            uint8_t& cell = grid.Row(r)[c];
+            cell = rule.table[state][cell].write;
+        }
+
+        int Turn(int seen, uint8_t& state) const
+        {
+            const TurmiteTransition& t = rule.table[state][seen];
+            state = t.next;
+            return t.turn;
+        }
+
+        void StepColony(AntColony& colony, uint64_t n, std::vector<CellChange>*)
+        {
+            colony.StepMany(grid, rule, n);
+        }
+    };
+}
+
+void ParallelColony::AntList::Clear()
+{
+    ids.clear();
+    rows.clear();
+    cols.clear();
+    dirs.clear();
+    states.clear();
+}
+
+void ParallelColony::AntList::Push(uint32_t id, int row, int col, uint8_t dir, uint8_t state)
+{
+    ids.push_back(id);
+    rows.push_back(row);
+    cols.push_back(col);
+    dirs.push_back(dir);
+    states.push_back(state);
+}
+
+ParallelColony::ParallelColony(int requestedThreads)
+    : threadCount(requestedThreads > 0 ? requestedThreads : int(std::thread::hardware_concurrency()))
+{
+    if (threadCount < 1)
+        threadCount = 1;
+    for (int i = 0; i < 2; ++i)
+        cursors[i].reset(new Cursor[threadCount]);
+    for (int t = 1; t < threadCount; ++t)
+        helpers.emplace_back(&ParallelColony::HelperLoop, this, t);
+}
+
+ParallelColony::~ParallelColony()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for (std::thread& helper : helpers)
+        helper.join();
+}
+
+void ParallelColony::StepMany(AntColony& colony, Grid& grid, uint64_t n)
+{
+    Run(colony, BitCells{ grid }, grid.Rows(), n, nullptr);
+}
+
+void ParallelColony::StepMany(AntColony& colony, Grid& grid, uint64_t n, std::vector<CellChange>& changes)
+{
+    Run(colony, BitCells{ grid }, grid.Rows(), n, &changes);
+}
+
+void ParallelColony::StepMany(AntColony& colony, ByteGrid& colors, const TurmiteRule& rule, uint64_t n)
+{
+    Run(colony, ColorCells{ colors, rule }, colors.Rows(), n, nullptr);
+}
+
+template <typename Cells>
+void ParallelColony::Run(AntColony& colony, Cells cells, int rows, uint64_t n, std::vector<CellChange>* changes)
+{
+    // With one stripe there is nothing to split, so the colony's own loop is just as exact
+    const int stripeCount = std::min(rows, threadCount * kStripesPerThread);
+    if (threadCount == 1 || stripeCount < 2 || colony.Size() < 2 || n == 0)
+    {
+        cells.StepColony(colony, n, changes);
+        return;
+    }
+
+    // Equal stripes, and a contiguous block of them for each thread
+    stripes.resize(stripeCount);
+    std::vector<int> stripeOfRow(rows);
+    for (int s = 0; s < stripeCount; ++s)
+    {
+        Stripe& stripe = stripes[s];
+        stripe.row0 = int(int64_t(s) * rows / stripeCount);
+        stripe.row1 = int(int64_t(s + 1) * rows / stripeCount);
+        std::fill(stripeOfRow.begin() + stripe.row0, stripeOfRow.begin() + stripe.row1, s);
+        stripe.ants.Clear();
+        stripe.up.Clear();
+        stripe.down.Clear();
+        stripe.changes.clear();
+    }
+    blockStart.resize(threadCount + 1);
+    for (int t = 0; t <= threadCount; ++t)
+        blockStart[t] = int(int64_t(t) * stripeCount / threadCount);
+    for (int t = 0; t < threadCount; ++t)
+        cursors[0][t].next.store(blockStart[t], std::memory_order_relaxed);
+
+    // Deal the ants out in index order, so every stripe's list starts sorted
+    const size_t antCount = colony.Size();
+    for (size_t i = 0; i < antCount; ++i)
+    {
+        const int row = static_cast<int>(colony.rows[i]);
+        stripes[stripeOfRow[row]].ants.Push(uint32_t(i), row, static_cast<int>(colony.cols[i]),
+            colony.dirs[i], colony.states[i]);
+    }
+
+    const CollisionPolicy policy = colony.GetPolicy();
+    const bool record = changes != nullptr;
+    const std::function<void(int)> body = [&](int thread) {
+        for (uint64_t generation = 0; generation < n; ++generation)
+        {
+            ForEachStripe(thread, 2 * generation, [&](size_t s) {
+                Cells local = cells;
+                StepStripe(stripes[s], local, policy, rows, record);
+            });
+            Barrier();
+            ForEachStripe(thread, 2 * generation + 1, [&](size_t s) { MergeStripe(s); });
+            Barrier();
+        }
+    };
+    RunOnAllThreads(body);
+
+    // Back into the colony's arrays, each ant at its own index
+    for (Stripe& stripe : stripes)
+    {
+        const AntList& ants = stripe.ants;
+        for (size_t k = 0; k < ants.Size(); ++k)
+        {
+            const uint32_t id = ants.ids[k];
+            colony.rows[id] = ants.rows[k];
+            colony.cols[id] = ants.cols[k];
+            colony.dirs[id] = ants.dirs[k];
+            colony.states[id] = ants.states[k];
+        }
+        if (changes)
+            changes->insert(changes->end(), stripe.changes.begin(), stripe.changes.end());
+    }
+}
+
+// One generation of one stripe. Ants that stay are compacted in place; the
+// others go to the up or down queue for the neighboring stripe to merge.
+template <typename Cells>
+void ParallelColony::StepStripe(Stripe& stripe, Cells& cells, CollisionPolicy policy, int rows, bool record)
+{
+    AntList& ants = stripe.ants;
+    std::vector<CellChange>* log = record ? &stripe.changes : nullptr;
+    const size_t count = ants.Size();
+    stripe.up.Clear();
+    stripe.down.Clear();
+
+    if (policy == CollisionPolicy::Simultaneous)
+    {
+        stripe.seen.resize(count);
+        for (size_t i = 0; i < count; ++i)
+            stripe.seen[i] = uint8_t(cells.Read(ants.rows[i], ants.cols[i]));
+        for (size_t i = 0; i < count; ++i)
+            cells.Recolor(ants.rows[i], ants.cols[i], ants.states[i], log);
+    }
+
+    const int cols = cells.grid.Cols();
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const int turn = policy == CollisionPolicy::Sequential
+            ? cells.Step(ants.rows[i], ants.cols[i], ants.states[i], log)
+            : cells.Turn(stripe.seen[i], ants.states[i]);
+
+        const int d = (ants.dirs[i] + turn) & 3;
+        int r = ants.rows[i] + kRowDelta[d];
+        int c = ants.cols[i] + kColDelta[d];
+        r += rows & -(r < 0);
+        r -= rows & -(r >= rows);
+        c += cols & -(c < 0);
+        c -= cols & -(c >= cols);
+
+        ants.rows[i] = r;
+        ants.cols[i] = c;
+        ants.dirs[i] = uint8_t(d);
+        if (r >= stripe.row0 && r < stripe.row1)
+        {
+            if (kept != i)
+            {
+                ants.ids[kept] = ants.ids[i];
+                ants.rows[kept] = r;
+                ants.cols[kept] = c;
+                ants.dirs[kept] = uint8_t(d);
+                ants.states[kept] = ants.states[i];
+            }
+            ++kept;
+        }
+        else
+        {
+            // Rows only change on vertical moves, so the direction tells which edge was crossed
+            (d == 0 ? stripe.up : stripe.down).PushFrom(ants, i);
+        }
+    }
+
+    ants.ids.resize(kept);
+    ants.rows.resize(kept);
+    ants.cols.resize(kept);
+    ants.dirs.resize(kept);
+    ants.states.resize(kept);
+}
+
+// Takes in the ants that walked over from the stripes above and below,
+// keeping the list in ant index order
+void ParallelColony::MergeStripe(size_t s)
+{
+    const size_t stripeCount = stripes.size();
+    Stripe& stripe = stripes[s];
+    const AntList& fromAbove = stripes[(s + stripeCount - 1) % stripeCount].down;
+    const AntList& fromBelow = stripes[(s + 1) % stripeCount].up;
+    if (fromAbove.Size() == 0 && fromBelow.Size() == 0)
+        return;
+
+    const AntList* lists[3] = { &stripe.ants, &fromAbove, &fromBelow };
+    size_t next[3] = { 0, 0, 0 };
+    AntList& merged = stripe.merged;
+    merged.Clear();
+    for (;;)
+    {
+        int pick = -1;
+        for (int k = 0; k < 3; ++k)
+        {
+            if (next[k] < lists[k]->Size() &&
+                (pick < 0 || lists[k]->ids[next[k]] < lists[pick]->ids[next[pick]]))
+                pick = k;
+        }
+        if (pick < 0)
+            break;
+        merged.PushFrom(*lists[pick], next[pick]++);
+    }
+    std::swap(stripe.ants, merged);
+}
+
+template <typename F>
+void ParallelColony::ForEachStripe(int thread, uint64_t phase, F&& f)
+{
+    // Nobody touches the other set of cursors until the next phase, so set up our block for it now
+    cursors[(phase + 1) & 1][thread].next.store(blockStart[thread], std::memory_order_relaxed);
+
+    Cursor* current = cursors[phase & 1].get();
+    for (int k = 0; k < threadCount; ++k)
+    {
+        const int victim = (thread + k) % threadCount;
+        const int end = blockStart[victim + 1];
+        for (int s = current[victim].next.fetch_add(1, std::memory_order_relaxed); s < end;
+            s = current[victim].next.fetch_add(1, std::memory_order_relaxed))
+        {
+            f(size_t(s));
+        }
+    }
+}
+
+// Sense-reversing barrier; spins briefly, then yields
+void ParallelColony::Barrier()
+{
+    const uint32_t phase = barrierPhase.load(std::memory_order_acquire);
+    if (barrierCount.fetch_add(1, std::memory_order_acq_rel) + 1 == threadCount)
+    {
+        barrierCount.store(0, std::memory_order_relaxed);
+        barrierPhase.store(phase + 1, std::memory_order_release);
+        return;
+    }
+
+    int spins = 0;
+    while (barrierPhase.load(std::memory_order_acquire) == phase)
+    {
+        if (++spins > 1024)
+            std::this_thread::yield();
+    }
+}
+
+void ParallelColony::RunOnAllThreads(const std::function<void(int)>& body)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &body;
+        ++jobNumber;
+        running = threadCount - 1;
+    }
+    wake.notify_all();
+
+    body(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return running == 0; });
+    job = nullptr;
+}
+
+void ParallelColony::HelperLoop(int thread)
+{
+    uint64_t seen = 0;
+    for (;;)
+    {
+        const std::function<void(int)>* current;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return quit || jobNumber != seen; });
+            if (quit)
+                return;
+            seen = jobNumber;
+            current = job;
+        }
+
+        (*current)(thread);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --running;
+        }
+        finished.notify_one();
+    }
+}
@@ -0,0 +1,118 @@
+// Defines ParallelColony, which steps a large AntColony on several threads.
+// The wrapping grid is cut into horizontal stripes, and each stripe keeps the
+// ants standing in it. Within one generation an ant only touches its own
+// cell, so ants in different stripes never interact and the stripes can be
+// stepped in any order on any thread. An ant that walks over a stripe edge is
+// put in that stripe's up or down queue, and the neighboring stripe merges it
+// in (by ant index) before the next generation.
+//
+// There are several stripes per thread. Each thread starts on its own block
+// of stripes and then steals unclaimed stripes from the other blocks, which
+// keeps the cores busy when the ants cluster in a few stripes.
+//
+// Every stripe steps its ants in index order with the colony's collision
+// policy, so the grid and the ants end up exactly as AntColony::StepMany
+// leaves them. Change logs hold the same flips, grouped by stripe: each
+// cell's flips are still in order, so replaying the log is exact.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "AntColony.h"
+#include "Grid.h"
+#include "Turmite.h"
+
+class ParallelColony
+{
+public:
+    // threadCount 0 uses one thread per core; the calling thread is one of them
+    explicit ParallelColony(int threadCount = 0);
+    ~ParallelColony();  // Stops and joins the helper threads
+
+    ParallelColony(const ParallelColony&) = delete;
+    ParallelColony& operator=(const ParallelColony&) = delete;
+
+    int ThreadCount() const { return threadCount; }
+
+    // Same results as the AntColony calls of the same name
+    void StepMany(AntColony& colony, Grid& grid, uint64_t n);
+    void StepMany(AntColony& colony, Grid& grid, uint64_t n, std::vector<CellChange>& changes);
+    void StepMany(AntColony& colony, ByteGrid& colors, const TurmiteRule& rule, uint64_t n);
+
+private:
+    // The ants of one stripe, in increasing ant index
+    struct AntList
+    {
+        std::vector<uint32_t> ids;   // Index of the ant in the colony
+        std::vector<int> rows;
+        std::vector<int> cols;
+        std::vector<uint8_t> dirs;
+        std::vector<uint8_t> states;
+
+        size_t Size() const { return ids.size(); }
+        void Clear();
+        void Push(uint32_t id, int row, int col, uint8_t dir, uint8_t state);
+        void PushFrom(const AntList& other, size_t i)
+        {
+            Push(other.ids[i], other.rows[i], other.cols[i], other.dirs[i], other.states[i]);
+        }
+    };
+
+    struct Stripe
+    {
+        int row0 = 0, row1 = 0;         // Rows [row0, row1)
+        AntList ants;
+        AntList merged;                 // Scratch for the merge
+        AntList up, down;               // Ants that left over the top or bottom edge this generation
+        std::vector<uint8_t> seen;      // Simultaneous policy: the cell each ant read
+        std::vector<CellChange> changes;
+    };
+
+    // A thread's block of stripes; other threads steal from it through the same cursor
+    struct alignas(64) Cursor
+    {
+        std::atomic<int> next{ 0 };
+    };
+
+    template <typename Cells>
+    void Run(AntColony& colony, Cells cells, int rows, uint64_t n, std::vector<CellChange>* changes);
+
+    template <typename Cells>
+    void StepStripe(Stripe& stripe, Cells& cells, CollisionPolicy policy, int rows, bool record);
+    void MergeStripe(size_t s);
+
+    // Runs f(stripe) for every stripe once: own block first, then stolen ones
+    template <typename F>
+    void ForEachStripe(int thread, uint64_t phase, F&& f);
+
+    // Every thread (the caller as thread 0) runs job(thread) once; returns when all are done
+    void RunOnAllThreads(const std::function<void(int)>& job);
+    void HelperLoop(int thread);
+    void Barrier();
+
+    int threadCount;
+    std::vector<Stripe> stripes;
+    std::vector<int> blockStart;                    // First stripe of each thread's block (threadCount + 1 entries)
+    std::unique_ptr<Cursor[]> cursors[2];           // Alternate between phases so they can be reset early
+
+    // Phase barrier
+    std::atomic<int> barrierCount{ 0 };
+    std::atomic<uint32_t> barrierPhase{ 0 };
+
+    // Helper threads
+    std::vector<std::thread> helpers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(int)>* job = nullptr;
+    uint64_t jobNumber = 0;
+    int running = 0;
+    bool quit = false;
+};
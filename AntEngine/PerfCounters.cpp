@@ -0,0 +1,125 @@
+// Implements the HUD's performance counters (only built with ANT_PERF)
+
+#include "PerfCounters.h"
+
+#if ANT_PERF
+
+#include <algorithm>
+
+int PerfHistogram::BucketOf(uint64_t nanoseconds)
+{
+    if (nanoseconds < kSubBuckets)
+        return static_cast<int>(nanoseconds);
+
+    // The top kSubBits + 1 bits of the value: the power of two, then the sub-bucket
+    int top = 63;
+    while ((nanoseconds >> top) == 0)
+        --top;
+    const int shift = top - kSubBits;
+    return (shift + 1) * kSubBuckets + static_cast<int>((nanoseconds >> shift) & (kSubBuckets - 1));
+}
+
+double PerfHistogram::BucketMiddle(int bucket)
+{
+    if (bucket < kSubBuckets)
+        return double(bucket);
+    const int shift = bucket / kSubBuckets - 1;
+    const double low = double(uint64_t(kSubBuckets + bucket % kSubBuckets) << shift);
+    return low + double(uint64_t(1) << shift) / 2.0;
+}
+
+void PerfHistogram::Read(Counts& out) const
+{
+    for (int i = 0; i < kBuckets; ++i)
+        out[i] = counts[i].load(std::memory_order_relaxed);
+}
+
+void PerfCounters::MarkFrame()
+{
+    const auto now = std::chrono::steady_clock::now();
+    const auto gap = now - lastFrame;
+    if (lastFrame.time_since_epoch().count() != 0 && gap < std::chrono::seconds(2))
+        Record(PerfPhase::Frame, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(gap).count()));
+    lastFrame = now;
+    Add(PerfCounter::Frames, 1);
+}
+
+uint64_t PerfCounters::MemoryBytes() const
+{
+    uint64_t bytes = 0;
+    for (const std::atomic<uint64_t>& gauge : memory)
+        bytes += gauge.load(std::memory_order_relaxed);
+    return bytes;
+}
+
+PerfCounters& Perf()
+{
+    static PerfCounters counters;
+    return counters;
+}
+
+PerfSampler::PerfSampler()
+    : lastTime(std::chrono::steady_clock::now())
+{
+}
+
+// Duration (in ms) below which a fraction of the interval's samples fall
+static double Percentile(const PerfHistogram::Counts& counts, uint64_t samples, double fraction)
+{
+    const uint64_t rank = std::max<uint64_t>(1, uint64_t(double(samples) * fraction + 0.5));
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < PerfHistogram::kBuckets; ++bucket)
+    {
+        seen += counts[bucket];
+        if (seen >= rank)
+            return PerfHistogram::BucketMiddle(bucket) / 1e6;
+    }
+    return 0.0;
+}
+
+PerfReport PerfSampler::Sample()
+{
+    const PerfCounters& perf = Perf();
+    const auto now = std::chrono::steady_clock::now();
+    PerfReport report;
+    report.seconds = std::chrono::duration<double>(now - lastTime).count();
+    lastTime = now;
+
+    // The histograms only grow, so the interval's samples are the difference
+    PerfHistogram::Counts counts;
+    for (size_t phase = 0; phase < size_t(PerfPhase::Count); ++phase)
+    {
+        perf.Histogram(PerfPhase(phase)).Read(counts);
+        uint64_t samples = 0;
+        for (int bucket = 0; bucket < PerfHistogram::kBuckets; ++bucket)
+        {
+            const uint64_t total = counts[bucket];
+            counts[bucket] -= lastCounts[phase][bucket];
+            lastCounts[phase][bucket] = total;
+            samples += counts[bucket];
+        }
+        report.samples[phase] = samples;
+        if (samples > 0)
+        {
+            report.p50[phase] = Percentile(counts, samples, 0.50);
+            report.p99[phase] = Percentile(counts, samples, 0.99);
+        }
+    }
+
+    std::array<uint64_t, size_t(PerfCounter::Count)> delta;
+    for (size_t counter = 0; counter < delta.size(); ++counter)
+    {
+        const uint64_t total = perf.Total(PerfCounter(counter));
+        delta[counter] = total - lastTotals[counter];
+        lastTotals[counter] = total;
+    }
+    if (report.seconds > 0.0)
+        report.stepsPerSecond = double(delta[size_t(PerfCounter::Steps)]) / report.seconds;
+    if (delta[size_t(PerfCounter::Frames)] > 0)
+        report.cellsPerFrame = double(delta[size_t(PerfCounter::PaintedCells)]) / double(delta[size_t(PerfCounter::Frames)]);
+
+    report.memoryBytes = perf.MemoryBytes();
+    return report;
+}
+
+#endif
@@ -0,0 +1,175 @@
+// Defines the performance counters behind the HUD. Scoped timers around the
+// simulation step, the neighbor count updates, painting and file I/O record
+// their durations into lock-free histograms. Simple totals count steps,
+// frames and painted cells, and gauges hold the memory in use. Any thread can
+// record with relaxed atomic adds. The HUD samples everything about once a
+// second and reports the rates and percentiles of the interval since the
+// sample before.
+//
+// The counters only exist when ANT_PERF is 1. That is the default without
+// NDEBUG, i.e. in Debug builds; in Release every ANT_PERF_ macro expands to
+// nothing and none of this is compiled. Define ANT_PERF=1 (or 0) for the
+// engine and the app alike to override the default.
+
+#pragma once
+
+#if !defined(ANT_PERF)
+#if defined(NDEBUG)
+#define ANT_PERF 0
+#else
+#define ANT_PERF 1
+#endif
+#endif
+
+#if ANT_PERF
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Timed phases
+enum class PerfPhase
+{
+    Step,       // A batch of simulation steps on the worker thread
+    Neighbors,  // Neighbor counts and the rest of the view updated from a snapshot
+    Paint,      // One OnPaint
+    Io,         // Reading or writing a pattern or universe file
+    Frame,      // Time between two frames shown (snapshots taken by the UI)
+    Count
+};
+
+// Counted totals
+enum class PerfCounter
+{
+    Steps,         // Ant generations run
+    PaintedCells,  // Cells drawn (or shaded by the pixel renderer)
+    Frames,        // Frames shown
+    Count
+};
+
+// Memory gauges; the HUD shows their sum
+enum class PerfMemory
+{
+    Universe,  // The worker's grid, plane or colors
+    View,      // The panel's copy of the view, counts, pyramid and bitmaps
+    Count
+};
+
+// Durations in nanoseconds, in log-linear buckets: 8 per power of two, so a
+// percentile read from a bucket is within 1/16 of the true value
+class PerfHistogram
+{
+public:
+    static constexpr int kSubBits = 3;
+    static constexpr int kSubBuckets = 1 << kSubBits;
+    static constexpr int kBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+    using Counts = std::array<uint64_t, kBuckets>;
+
+    void Record(uint64_t nanoseconds)
+    {
+        counts[BucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Copies the counts recorded so far (each bucket read atomically)
+    void Read(Counts& out) const;
+
+    static int BucketOf(uint64_t nanoseconds);
+
+    // Middle of the durations a bucket holds
+    static double BucketMiddle(int bucket);
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> counts{};
+};
+
+class PerfCounters
+{
+public:
+    void Record(PerfPhase phase, uint64_t nanoseconds) { phases[size_t(phase)].Record(nanoseconds); }
+    void Add(PerfCounter counter, uint64_t n) { totals[size_t(counter)].fetch_add(n, std::memory_order_relaxed); }
+    void SetMemory(PerfMemory gauge, uint64_t bytes) { memory[size_t(gauge)].store(bytes, std::memory_order_relaxed); }
+
+    // Records the time since the last frame as a Frame sample and counts the
+    // frame. Call from the UI thread only. Gaps over two seconds (the
+    // simulation was paused) only count the frame.
+    void MarkFrame();
+
+    const PerfHistogram& Histogram(PerfPhase phase) const { return phases[size_t(phase)]; }
+    uint64_t Total(PerfCounter counter) const { return totals[size_t(counter)].load(std::memory_order_relaxed); }
+    uint64_t MemoryBytes() const;
+
+private:
+    std::array<PerfHistogram, size_t(PerfPhase::Count)> phases;
+    std::array<std::atomic<uint64_t>, size_t(PerfCounter::Count)> totals{};
+    std::array<std::atomic<uint64_t>, size_t(PerfMemory::Count)> memory{};
+    std::chrono::steady_clock::time_point lastFrame;
+};
+
+// The process-wide counters
+PerfCounters& Perf();
+
+// Records the time from construction to the end of the scope
+class PerfTimer
+{
+public:
+    explicit PerfTimer(PerfPhase phase) : phase(phase), start(std::chrono::steady_clock::now()) {}
+    ~PerfTimer()
+    {
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        Perf().Record(phase, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    PerfTimer(const PerfTimer&) = delete;
+    PerfTimer& operator=(const PerfTimer&) = delete;
+
+private:
+    PerfPhase phase;
+    std::chrono::steady_clock::time_point start;
+};
+
+// What the HUD shows: the interval between two samples
+struct PerfReport
+{
+    double seconds = 0.0;  // Length of the interval
+    double stepsPerSecond = 0.0;
+    double cellsPerFrame = 0.0;
+    double p50[size_t(PerfPhase::Count)] = {};  // Milliseconds
+    double p99[size_t(PerfPhase::Count)] = {};
+    uint64_t samples[size_t(PerfPhase::Count)] = {};
+    uint64_t memoryBytes = 0;
+};
+
+// Turns the running totals into per-interval numbers by keeping the previous
+// sample. One sampler per reader; it only reads the counters.
+class PerfSampler
+{
+public:
+    PerfSampler();
+
+    // Reports the interval since the last call (or since construction)
+    PerfReport Sample();
+
+private:
+    std::array<PerfHistogram::Counts, size_t(PerfPhase::Count)> lastCounts{};
+    std::array<uint64_t, size_t(PerfCounter::Count)> lastTotals{};
+    std::chrono::steady_clock::time_point lastTime;
+};
+
+#define ANT_PERF_CONCAT_(a, b) a##b
+#define ANT_PERF_CONCAT(a, b) ANT_PERF_CONCAT_(a, b)
+#define ANT_PERF_SCOPE(phase) const PerfTimer ANT_PERF_CONCAT(perfTimer, __LINE__)(PerfPhase::phase)
+#define ANT_PERF_ADD(counter, n) Perf().Add(PerfCounter::counter, (n))
+#define ANT_PERF_MEMORY(gauge, bytes) Perf().SetMemory(PerfMemory::gauge, (bytes))
+#define ANT_PERF_FRAME() Perf().MarkFrame()
+
+#else
+
+#define ANT_PERF_SCOPE(phase) ((void)0)
+#define ANT_PERF_ADD(counter, n) ((void)0)
+#define ANT_PERF_MEMORY(gauge, bytes) ((void)0)
+#define ANT_PERF_FRAME() ((void)0)
+
+#endif
@@ -0,0 +1,467 @@
+// Implements the grid-to-pixels renderer used for large universes
+
+#include "PixelRenderer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Counts the set bits in columns [c0, c1) of a bit-packed row
+static uint32_t CountRange(const uint64_t* words, int c0, int c1)
+{
+    const int first = c0 >> 6;
+    const int last = (c1 - 1) >> 6;
+    const int shift = c0 & 63;
+
+    if (first == last)
+    {
+        const int span = c1 - c0;
+        const uint64_t mask = span == 64 ? ~uint64_t(0) : ((uint64_t(1) << span) - 1);
+        return PopCount64((words[first] >> shift) & mask);
+    }
+
+    uint32_t count = PopCount64(words[first] >> shift);
+    for (int w = first + 1; w < last; ++w)
+        count += PopCount64(words[w]);
+    const int top = c1 & 63;
+    count += PopCount64(top ? words[last] & ~(~uint64_t(0) << top) : words[last]);
+    return count;
+}
+
+PixelRenderer::PixelRenderer()
+{
+    std::memset(palette, 0, sizeof(palette));
+    SetColors(128, 128, 128, 255, 255, 255);
+}
+
+void PixelRenderer::SetColors(uint8_t livingRed, uint8_t livingGreen, uint8_t livingBlue,
+    uint8_t deadRed, uint8_t deadGreen, uint8_t deadBlue)
+{
+    living[0] = livingRed;
+    living[1] = livingGreen;
+    living[2] = livingBlue;
+    dead[0] = deadRed;
+    dead[1] = deadGreen;
+    dead[2] = deadBlue;
+
+    // Color indices 0 and 1 of a color grid are the dead and living colors
+    std::memcpy(palette[0], dead, 3);
+    std::memcpy(palette[1], living, 3);
+    for (int i = 0; i < 3; ++i)
+        outside[i] = uint8_t(dead[i] * 3 / 4);
+
+    // Bit i of the byte is the cell 8 * k + i of the word, so its color goes to slot i
+    for (int value = 0; value < 256; ++value)
+    {
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            const uint8_t* color = ((value >> bit) & 1) ? living : dead;
+            std::memcpy(&expandTable[value][bit * 3], color, 3);
+        }
+    }
+}
+
+void PixelRenderer::ExpandRow(const uint64_t* words, int cols, uint8_t* out) const
+{
+    // 8 cells become 24 bytes with one table copy; the tail may overrun into
+    // the padding that rowColors reserves for it
+    const int wordCount = (cols + 63) >> 6;
+    for (int w = 0; w < wordCount; ++w)
+    {
+        uint64_t word = words[w];
+        for (int b = 0; b < 8; ++b, word >>= 8, out += 24)
+            std::memcpy(out, expandTable[word & 0xFF], 24);
+    }
+}
+
+void PixelRenderer::Render(const Grid& grid, int width, int height, uint8_t* pixels, Downsample mode)
+{
+    const int rows = grid.Rows();
+    const int cols = grid.Cols();
+    if (width <= 0 || height <= 0)
+        return;
+    if (rows == 0 || cols == 0)
+    {
+        for (size_t i = 0; i < size_t(width) * height; ++i)
+            std::memcpy(pixels + i * 3, dead, 3);
+        return;
+    }
+
+    // Column spans: output pixel x covers cells [colStart[x], colEnd) where
+    // colEnd is at least one past colStart so zoomed-in pixels repeat a cell
+    colStart.resize(width + 1);
+    for (int x = 0; x <= width; ++x)
+        colStart[x] = static_cast<int>(int64_t(x) * cols / width);
+
+    const bool zoomedInX = width >= cols;
+    const size_t rowBytes = size_t(width) * 3;
+
+    if (zoomedInX)
+        rowColors.resize((size_t(cols + 63) & ~size_t(63)) * 3);
+
+    int previousRow = -1;
+    for (int y = 0; y < height; ++y)
+    {
+        const int r0 = static_cast<int>(int64_t(y) * rows / height);
+        const int r1 = std::max(r0 + 1, static_cast<int>(int64_t(y + 1) * rows / height));
+        uint8_t* out = pixels + size_t(y) * rowBytes;
+
+        if (zoomedInX && r1 - r0 == 1)
+        {
+            // Nearest neighbor: consecutive pixel rows on the same cell row are identical
+            if (r0 == previousRow)
+            {
+                std::memcpy(out, out - rowBytes, rowBytes);
+                continue;
+            }
+
+            ExpandRow(grid.Row(r0), cols, rowColors.data());
+            if (width == cols)
+            {
+                std::memcpy(out, rowColors.data(), rowBytes);
+            }
+            else
+            {
+                for (int x = 0; x < width; ++x)
+                    std::memcpy(out + x * 3, &rowColors[size_t(colStart[x]) * 3], 3);
+            }
+            previousRow = r0;
+            continue;
+        }
+
+        // Downsampling: add the cell rows under this pixel row into bit-sliced
+        // counters (plane p holds bit p of each column's count). That costs a
+        // few word operations per row; each pixel then needs one masked popcount per plane.
+        previousRow = -1;
+        const int wordCount = (cols + 63) >> 6;
+        int planeCount = 1;
+        while ((1 << planeCount) <= r1 - r0)
+            ++planeCount;
+        planes.assign(size_t(planeCount) * wordCount, 0);
+
+        for (int r = r0; r < r1; ++r)
+        {
+            const uint64_t* words = grid.Row(r);
+            for (int w = 0; w < wordCount; ++w)
+            {
+                uint64_t carry = words[w];
+                for (int p = 0; p < planeCount && carry; ++p)
+                {
+                    uint64_t& plane = planes[size_t(p) * wordCount + w];
+                    const uint64_t next = plane & carry;
+                    plane ^= carry;
+                    carry = next;
+                }
+            }
+        }
+
+        counts.resize(width);
+        for (int x = 0; x < width; ++x)
+        {
+            const int c0 = colStart[x];
+            const int c1 = std::max(c0 + 1, colStart[x + 1]);
+            uint32_t count = 0;
+            for (int p = 0; p < planeCount; ++p)
+                count += CountRange(&planes[size_t(p) * wordCount], c0, c1) << p;
+            counts[x] = count;
+        }
+
+        for (int x = 0; x < width; ++x)
+        {
+            uint8_t* pixel = out + x * 3;
+            if (mode == Downsample::AnyAlive)
+            {
+                std::memcpy(pixel, counts[x] ? living : dead, 3);
+                continue;
+            }
+
+            // Blend from the dead color to the living color by the fraction alive
+            const int c0 = colStart[x];
+            const uint32_t area = uint32_t(r1 - r0) * uint32_t(std::max(c0 + 1, colStart[x + 1]) - c0);
+            const uint32_t t = counts[x] * 256 / area;
+            for (int i = 0; i < 3; ++i)
+                pixel[i] = static_cast<uint8_t>(dead[i] + ((int(living[i]) - int(dead[i])) * int(t) >> 8));
+        }
+    }
+}
+
+void PixelRenderer::SetPaletteColor(int color, uint8_t red, uint8_t green, uint8_t blue)
+{
+    palette[color & 0xFF][0] = red;
+    palette[color & 0xFF][1] = green;
+    palette[color & 0xFF][2] = blue;
+}
+
+void PixelRenderer::Render(const ByteGrid& colors, int width, int height, uint8_t* pixels)
+{
+    const int rows = colors.Rows();
+    const int cols = colors.Cols();
+    if (width <= 0 || height <= 0)
+        return;
+    if (rows == 0 || cols == 0)
+    {
+        for (size_t i = 0; i < size_t(width) * height; ++i)
+            std::memcpy(pixels + i * 3, palette[0], 3);
+        return;
+    }
+
+    colStart.resize(width + 1);
+    for (int x = 0; x <= width; ++x)
+        colStart[x] = static_cast<int>(int64_t(x) * cols / width);
+
+    const size_t rowBytes = size_t(width) * 3;
+    int previousRow = -1;
+    for (int y = 0; y < height; ++y)
+    {
+        const int r = static_cast<int>(int64_t(y) * rows / height);
+        uint8_t* out = pixels + size_t(y) * rowBytes;
+
+        // Consecutive pixel rows on the same cell row are identical
+        if (r == previousRow)
+        {
+            std::memcpy(out, out - rowBytes, rowBytes);
+            continue;
+        }
+
+        const uint8_t* cells = colors.Row(r);
+        for (int x = 0; x < width; ++x)
+            std::memcpy(out + x * 3, palette[cells[colStart[x]]], 3);
+        previousRow = r;
+    }
+}
+
+void PixelRenderer::Spans(double start, double cellsPerPixel, int count, int64_t size, std::vector<int>& edges)
+{
+    edges.resize(count + 1);
+    for (int i = 0; i <= count; ++i)
+    {
+        const double edge = std::floor(start + i * cellsPerPixel);
+        edges[i] = static_cast<int>(std::clamp(edge, -1.0, double(size)));
+    }
+}
+
+void PixelRenderer::Shade(uint8_t* pixel, uint32_t count, uint32_t area, Downsample mode) const
+{
+    if (mode == Downsample::AnyAlive)
+    {
+        std::memcpy(pixel, count ? living : dead, 3);
+        return;
+    }
+
+    // Blend from the dead color to the living color by the fraction alive
+    const uint32_t t = uint32_t(uint64_t(count) * 256 / area);
+    for (int i = 0; i < 3; ++i)
+        pixel[i] = static_cast<uint8_t>(dead[i] + ((int(living[i]) - int(dead[i])) * int(t) >> 8));
+}
+
+void PixelRenderer::Render(const Grid& grid, const Camera& camera, int width, int height, uint8_t* pixels,
+    const DensityPyramid* pyramid, Downsample mode)
+{
+    if (width <= 0 || height <= 0)
+        return;
+
+    const int rows = grid.Rows();
+    const int cols = grid.Cols();
+    const double cellsPerPixel = 1.0 / camera.Scale();
+    if (pyramid && pyramid->Levels() > 0 && pyramid->Rows() == rows && pyramid->Cols() == cols
+        && cellsPerPixel >= kPyramidCellsPerPixel)
+    {
+        RenderPyramid(*pyramid, camera, width, height, pixels, mode);
+        return;
+    }
+
+    // Pixel x covers cells [c0, c1) with c1 at least one past c0, so zoomed-in pixels repeat a cell
+    Spans(camera.Left(), cellsPerPixel, width, cols, colStart);
+    Spans(camera.Top(), cellsPerPixel, height, rows, rowStart);
+    auto span = [](const std::vector<int>& edges, int i, int size, int& first, int& last)
+    {
+        first = edges[i];
+        last = std::min(std::max(first + 1, edges[i + 1]), size);
+        first = std::max(first, 0);
+        return first < last;
+    };
+
+    // The words holding the visible columns; nothing left or right of them is read
+    int firstCol = cols, lastCol = 0;
+    for (int x = 0; x < width; ++x)
+    {
+        int c0, c1;
+        if (span(colStart, x, cols, c0, c1))
+        {
+            firstCol = std::min(firstCol, c0);
+            lastCol = std::max(lastCol, c1);
+        }
+    }
+    const int firstWord = firstCol >> 6;
+    const int wordCount = firstCol < lastCol ? ((lastCol - 1) >> 6) - firstWord + 1 : 0;
+    const int bitOffset = firstWord << 6;
+
+    const size_t rowBytes = size_t(width) * 3;
+    int previousRow = -1;
+    for (int y = 0; y < height; ++y)
+    {
+        uint8_t* out = pixels + size_t(y) * rowBytes;
+        int r0, r1;
+        if (wordCount == 0 || !span(rowStart, y, rows, r0, r1))
+        {
+            for (int x = 0; x < width; ++x)
+                std::memcpy(out + x * 3, outside, 3);
+            previousRow = -1;
+            continue;
+        }
+
+        if (cellsPerPixel <= 1.0 && r1 - r0 == 1)
+        {
+            // Nearest neighbor: consecutive pixel rows on the same cell row are identical
+            if (r0 == previousRow)
+            {
+                std::memcpy(out, out - rowBytes, rowBytes);
+                continue;
+            }
+
+            const uint64_t* words = grid.Row(r0);
+            for (int x = 0; x < width; ++x)
+            {
+                int c0, c1;
+                const uint8_t* color = outside;
+                if (span(colStart, x, cols, c0, c1))
+                    color = ((words[c0 >> 6] >> (c0 & 63)) & 1) ? living : dead;
+                std::memcpy(out + x * 3, color, 3);
+            }
+            previousRow = r0;
+            continue;
+        }
+
+        // Downsampling, as in the whole-grid Render, over the visible words only
+        previousRow = -1;
+        int planeCount = 1;
+        while ((1 << planeCount) <= r1 - r0)
+            ++planeCount;
+        planes.assign(size_t(planeCount) * wordCount, 0);
+
+        for (int r = r0; r < r1; ++r)
+        {
+            const uint64_t* words = grid.Row(r) + firstWord;
+            for (int w = 0; w < wordCount; ++w)
+            {
+                uint64_t carry = words[w];
+                for (int p = 0; p < planeCount && carry; ++p)
+                {
+                    uint64_t& plane = planes[size_t(p) * wordCount + w];
+                    const uint64_t next = plane & carry;
+                    plane ^= carry;
+                    carry = next;
+                }
+            }
+        }
+
+        for (int x = 0; x < width; ++x)
+        {
+            int c0, c1;
+            if (!span(colStart, x, cols, c0, c1))
+            {
+                std::memcpy(out + x * 3, outside, 3);
+                continue;
+            }
+            uint32_t count = 0;
+            for (int p = 0; p < planeCount; ++p)
+                count += CountRange(&planes[size_t(p) * wordCount], c0 - bitOffset, c1 - bitOffset) << p;
+            Shade(out + x * 3, count, uint32_t(r1 - r0) * uint32_t(c1 - c0), mode);
+        }
+    }
+}
+
+void PixelRenderer::RenderPyramid(const DensityPyramid& pyramid, const Camera& camera, int width, int height,
+    uint8_t* pixels, Downsample mode)
+{
+    // The smallest blocks that still cover a whole pixel (level 0 from kPyramidCellsPerPixel on)
+    const double cellsPerPixel = 1.0 / camera.Scale();
+    int level = 0;
+    while (level + 1 < pyramid.Levels() && double(DensityPyramid::BlockSize(level)) < cellsPerPixel)
+        ++level;
+    const int shift = DensityPyramid::kBaseShift + level;
+    const int64_t blockSize = DensityPyramid::BlockSize(level);
+    const int64_t rows = pyramid.Rows();
+    const int64_t cols = pyramid.Cols();
+
+    // Each pixel reads the block under its center; -1 marks pixels past the edge
+    auto blockAt = [shift](double cell, int64_t size)
+    {
+        const double floored = std::floor(cell);
+        return floored < 0.0 || floored >= double(size) ? -1 : static_cast<int>(static_cast<int64_t>(floored) >> shift);
+    };
+    colStart.resize(width);
+    for (int x = 0; x < width; ++x)
+        colStart[x] = blockAt(camera.ColAt(x + 0.5), cols);
+
+    const size_t rowBytes = size_t(width) * 3;
+    int previousBlock = -2;
+    for (int y = 0; y < height; ++y)
+    {
+        uint8_t* out = pixels + size_t(y) * rowBytes;
+        const int blockRow = blockAt(camera.RowAt(y + 0.5), rows);
+        if (blockRow == previousBlock)
+        {
+            std::memcpy(out, out - rowBytes, rowBytes);
+            continue;
+        }
+        previousBlock = blockRow;
+
+        if (blockRow < 0)
+        {
+            for (int x = 0; x < width; ++x)
+                std::memcpy(out + x * 3, outside, 3);
+            continue;
+        }
+
+        // Blocks on the last row or column may hang over the universe's edge
+        const uint32_t blockRows = uint32_t(std::min(blockSize, rows - (int64_t(blockRow) << shift)));
+        for (int x = 0; x < width; ++x)
+        {
+            const int blockCol = colStart[x];
+            if (blockCol < 0)
+            {
+                std::memcpy(out + x * 3, outside, 3);
+                continue;
+            }
+            const uint32_t blockCols = uint32_t(std::min(blockSize, cols - (int64_t(blockCol) << shift)));
+            Shade(out + x * 3, pyramid.Count(level, blockRow, blockCol), blockRows * blockCols, mode);
+        }
+    }
+}
+
+void PixelRenderer::Render(const ByteGrid& colors, const Camera& camera, int width, int height, uint8_t* pixels)
+{
+    if (width <= 0 || height <= 0)
+        return;
+
+    const int rows = colors.Rows();
+    const int cols = colors.Cols();
+    auto cellAt = [](double cell, int size)
+    {
+        const double floored = std::floor(cell);
+        return floored < 0.0 || floored >= double(size) ? -1 : static_cast<int>(floored);
+    };
+    colStart.resize(width);
+    for (int x = 0; x < width; ++x)
+        colStart[x] = cellAt(camera.ColAt(x + 0.5), cols);
+
+    const size_t rowBytes = size_t(width) * 3;
+    int previousRow = -2;
+    for (int y = 0; y < height; ++y)
+    {
+        uint8_t* out = pixels + size_t(y) * rowBytes;
+        const int r = cellAt(camera.RowAt(y + 0.5), rows);
+
+        // Consecutive pixel rows on the same cell row are identical
+        if (r == previousRow)
+        {
+            std::memcpy(out, out - rowBytes, rowBytes);
+            continue;
+        }
+        previousRow = r;
+
+        const uint8_t* cells = r >= 0 ? colors.Row(r) : nullptr;
+        for (int x = 0; x < width; ++x)
+            std::memcpy(out + x * 3, cells && colStart[x] >= 0 ? palette[cells[colStart[x]]] : outside, 3);
+    }
+}
@@ -0,0 +1,82 @@
+// Defines PixelRenderer, which turns a bit-packed Grid straight into a
+// 24-bit RGB pixel buffer. This is much faster than drawing one rectangle
+// per cell. Zoomed in, it scales with nearest-neighbor. Zoomed out (cells
+// smaller than a pixel), each pixel shows the cells it covers, as
+// "any alive" or as a density shade between the dead and living colors.
+//
+// The Camera overloads draw only the part of the universe in view. Zoomed
+// far out, they shade each pixel from a DensityPyramid instead of reading
+// the cells, so a frame costs about the same at any universe size.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Camera.h"
+#include "DensityPyramid.h"
+#include "Grid.h"
+
+class PixelRenderer
+{
+public:
+    // How a pixel that covers several cells is colored
+    enum class Downsample { AnyAlive, Density };
+
+    // From here on, a pixel's share of a level-0 block is big enough to shade from the pyramid
+    static constexpr double kPyramidCellsPerPixel = 4.0;
+
+    PixelRenderer();
+
+    // Colors as 8-bit RGB (also palette colors 0 and 1); rebuilds the bit-to-color expansion table
+    void SetColors(uint8_t livingRed, uint8_t livingGreen, uint8_t livingBlue,
+        uint8_t deadRed, uint8_t deadGreen, uint8_t deadBlue);
+
+    // Renders the whole grid scaled to width x height pixels.
+    // pixels must hold width * height * 3 bytes (RGB, rows packed with no padding).
+    void Render(const Grid& grid, int width, int height, uint8_t* pixels,
+        Downsample mode = Downsample::Density);
+
+    // Color of one cell color index, for grids of turmite colors
+    void SetPaletteColor(int color, uint8_t red, uint8_t green, uint8_t blue);
+
+    // Renders a grid of color indices the same way. Zoomed out, each pixel
+    // takes the color of the first cell it covers (colors don't blend).
+    void Render(const ByteGrid& colors, int width, int height, uint8_t* pixels);
+
+    // Renders what camera shows of the grid. Only visible cells are read;
+    // pixels past the universe's edge get a shade darker than dead cells.
+    // When pyramid was built from this grid, pixels that cover
+    // kPyramidCellsPerPixel cells or more take their shade from it.
+    void Render(const Grid& grid, const Camera& camera, int width, int height, uint8_t* pixels,
+        const DensityPyramid* pyramid = nullptr, Downsample mode = Downsample::Density);
+
+    // Renders what camera shows of a color grid; each pixel shows the cell under its center
+    void Render(const ByteGrid& colors, const Camera& camera, int width, int height, uint8_t* pixels);
+
+private:
+    // Cells [*first, *last) spanned by each of count pixels starting at edge
+    // position start, clipped to [-1, size]; a span that ends up empty is outside
+    static void Spans(double start, double cellsPerPixel, int count, int64_t size, std::vector<int>& edges);
+
+    // Shades pixels from the pyramid level whose blocks are at least as big as a pixel
+    void RenderPyramid(const DensityPyramid& pyramid, const Camera& camera, int width, int height,
+        uint8_t* pixels, Downsample mode);
+
+    void Shade(uint8_t* pixel, uint32_t count, uint32_t area, Downsample mode) const;
+
+    // Writes one RGB triple per cell of a row using the 8-cells-at-a-time table
+    void ExpandRow(const uint64_t* words, int cols, uint8_t* out) const;
+
+    uint8_t living[3];
+    uint8_t dead[3];
+    uint8_t outside[3];             // Past the edge of the universe
+    uint8_t expandTable[256][24];   // Colors for the 8 cells in each possible byte
+    uint8_t palette[256][3];        // RGB of each cell color index
+
+    // Scratch buffers reused between frames
+    std::vector<uint8_t> rowColors;   // Expanded colors of one cell row
+    std::vector<int> colStart;        // First cell column of each output pixel column (width + 1 entries)
+    std::vector<int> rowStart;        // Same for pixel rows, in the camera views
+    std::vector<uint32_t> counts;     // Living cells under each output pixel of the current row
+    std::vector<uint64_t> planes;     // Bit-sliced per-column counts for the rows under one pixel row
+};
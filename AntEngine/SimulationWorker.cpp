@@ -0,0 +1,786 @@
+// Implements the background simulation thread and its command queue
+
+#include "SimulationWorker.h"
+#include <algorithm>
+#include <cstring>
+
+// Below this many ants the per-generation hand-off costs more than the threads save
+static const size_t kParallelAnts = 1024;
+
+SimulationWorker::SimulationWorker(const SimulationConfig& initialConfig)
+    : config(initialConfig),
+    grid(initialConfig.gridSize, initialConfig.gridSize),
+    ants(initialConfig.collisionPolicy)
+{
+    if (UsesTurmite())
+    {
+        config.infinitePlane = false;  // Turmites only run on the wrapping grid
+        colors = ByteGrid(config.gridSize, config.gridSize);
+    }
+    ResetAnt();
+    ResetTimeline();
+    ConfigureCheckpoints();
+    thread = std::thread(&SimulationWorker::Run, this);
+}
+
+SimulationWorker::~SimulationWorker()
+{
+    Command quit;
+    quit.type = Command::Quit;
+    Post(std::move(quit));
+    thread.join();
+}
+
+void SimulationWorker::Post(Command command)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        commands.push_back(std::move(command));
+        hasCommands.store(true, std::memory_order_release);
+    }
+    wake.notify_one();
+}
+
+void SimulationWorker::Play()
+{
+    Command command;
+    command.type = Command::Play;
+    Post(std::move(command));
+}
+
+void SimulationWorker::Pause()
+{
+    Command command;
+    command.type = Command::Pause;
+    Post(std::move(command));
+}
+
+void SimulationWorker::Step(uint64_t steps)
+{
+    Command command;
+    command.type = Command::Step;
+    command.steps = steps;
+    Post(std::move(command));
+}
+
+void SimulationWorker::StepBack(uint64_t steps)
+{
+    Command command;
+    command.type = Command::StepBack;
+    command.steps = steps;
+    Post(std::move(command));
+}
+
+void SimulationWorker::Seek(uint64_t target)
+{
+    Command command;
+    command.type = Command::Seek;
+    command.target = target;
+    Post(std::move(command));
+}
+
+void SimulationWorker::Clear()
+{
+    Command command;
+    command.type = Command::Clear;
+    Post(std::move(command));
+}
+
+void SimulationWorker::Configure(const SimulationConfig& newConfig, bool resetAnt)
+{
+    Command command;
+    command.type = Command::Configure;
+    command.payload = std::make_unique<Payload>();
+    command.payload->config = newConfig;
+    command.resetAnt = resetAnt;
+    Post(std::move(command));
+}
+
+void SimulationWorker::FlipCell(int64_t row, int64_t col)
+{
+    Command command;
+    command.type = Command::FlipCell;
+    command.row = row;
+    command.col = col;
+    Post(std::move(command));
+}
+
+void SimulationWorker::Stamp(const Grid& pattern, int64_t row0, int64_t col0)
+{
+    Stamp(pattern, std::vector<AntPlacement>(), row0, col0);
+}
+
+void SimulationWorker::Stamp(const Grid& pattern, const std::vector<AntPlacement>& patternAnts, int64_t row0, int64_t col0)
+{
+    Command command;
+    command.type = Command::Stamp;
+    command.payload = std::make_unique<Payload>();
+    command.payload->pattern = pattern;
+    command.payload->ants = patternAnts;
+    command.row = row0;
+    command.col = col0;
+    Post(std::move(command));
+}
+
+void SimulationWorker::ToggleAnt(int64_t row, int64_t col)
+{
+    Command command;
+    command.type = Command::ToggleAnt;
+    command.row = row;
+    command.col = col;
+    Post(std::move(command));
+}
+
+void SimulationWorker::Save(const std::string& path, std::function<void(bool)> done)
+{
+    Command command;
+    command.type = Command::Save;
+    command.payload = std::make_unique<Payload>();
+    command.payload->path = path;
+    command.payload->saved = std::move(done);
+    Post(std::move(command));
+}
+
+void SimulationWorker::Load(const SimulationConfig& newConfig, UniverseState universe)
+{
+    Command command;
+    command.type = Command::Load;
+    command.payload = std::make_unique<Payload>();
+    command.payload->config = newConfig;
+    command.payload->universe = std::move(universe);
+    Post(std::move(command));
+}
+
+// Thread body: run queued commands, advance if playing, publish, then sleep
+void SimulationWorker::Run()
+{
+    Trace().NameThread("Simulation");
+    std::vector<Command> batch;
+    for (;;)
+    {
+        // Free-running batches skip the lock unless a command is waiting
+        const bool freeRunning = running.load(std::memory_order_relaxed) && config.intervalMs == 0;
+        if (!freeRunning || hasCommands.load(std::memory_order_acquire))
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto hasWork = [this] { return !commands.empty(); };
+
+            if (!running.load(std::memory_order_relaxed))
+            {
+                // Paused: sleep until a command arrives, but keep retrying an
+                // unpublished snapshot until the UI has taken the previous one
+                if (dirty)
+                    wake.wait_for(lock, std::chrono::milliseconds(2), hasWork);
+                else
+                    wake.wait(lock, hasWork);
+            }
+            else if (config.intervalMs > 0)
+            {
+                wake.wait_until(lock, nextTick, hasWork);
+            }
+
+            batch.swap(commands);
+            hasCommands.store(false, std::memory_order_relaxed);
+        }
+
+        for (Command& command : batch)
+        {
+            if (command.type == Command::Quit)
+                return;
+            Execute(command);
+        }
+        batch.clear();
+
+        if (running.load(std::memory_order_relaxed))
+        {
+            const auto now = std::chrono::steady_clock::now();
+            if (config.intervalMs == 0 || now >= nextTick)
+            {
+                Advance(config.stepsPerBatch);
+
+                // Fall back to "now" if we are behind instead of running a burst of catch-up ticks
+                nextTick += std::chrono::milliseconds(config.intervalMs);
+                if (nextTick < now)
+                    nextTick = now + std::chrono::milliseconds(config.intervalMs);
+            }
+        }
+
+        TryPublish();
+    }
+}
+
+void SimulationWorker::Execute(Command& command)
+{
+    // Anything but play, pause and save edits the universe or the ants, which breaks the highway history
+    if (command.type != Command::Play && command.type != Command::Pause && command.type != Command::Step &&
+        command.type != Command::Save)
+        highway.Reset();
+
+    // Edits also start a new timeline; moving along it doesn't
+    const bool edits = command.type != Command::Play && command.type != Command::Pause &&
+        command.type != Command::Step && command.type != Command::StepBack && command.type != Command::Seek &&
+        command.type != Command::Save && command.type != Command::Configure;
+
+    switch (command.type)
+    {
+    case Command::Play:
+        running.store(true, std::memory_order_relaxed);
+        nextTick = std::chrono::steady_clock::now();
+        break;
+
+    case Command::Pause:
+        running.store(false, std::memory_order_relaxed);
+        break;
+
+    case Command::Step:
+        Advance(command.steps);
+        break;
+
+    case Command::StepBack:
+    {
+        const uint64_t now = generation.load(std::memory_order_relaxed);
+        SeekGeneration(now - std::min(command.steps, now));
+        break;
+    }
+
+    case Command::Seek:
+        SeekGeneration(command.target);
+        break;
+
+    case Command::Clear:
+        grid.Clear();
+        plane.Clear();
+        colors.Clear();
+        ResetAnt();
+        generation.store(0, std::memory_order_relaxed);
+        if (checkpointer)
+            checkpointer->Restart(0);
+        MarkFull();
+        break;
+
+    case Command::Configure:
+    {
+        // A new rule gives the colors new meanings, so it starts over from an empty universe
+        const SimulationConfig& newConfig = command.payload->config;
+        const bool ruleChanged = newConfig.rule != config.rule;
+        const bool universeChanged = ruleChanged || command.resetAnt ||
+            newConfig.gridSize != config.gridSize || newConfig.infinitePlane != config.infinitePlane;
+        config = newConfig;
+        ants.SetPolicy(config.collisionPolicy);
+        if (ruleChanged)
+        {
+            grid.Clear();
+            plane.Clear();
+            colors = ByteGrid();
+            generation.store(0, std::memory_order_relaxed);
+        }
+
+        // A new size keeps the universe, moved with its ants so it stays centered
+        // (or anchored at the top-left); the plane's cells never move
+        if (UsesTurmite())
+            config.infinitePlane = false;  // Turmites only run on the wrapping grid
+        const int64_t oldSize = std::max(grid.Rows(), colors.Rows());
+        const int64_t offset = config.resizeCentered && !config.infinitePlane && !ruleChanged && oldSize > 0
+            ? (config.gridSize - oldSize) / 2 : 0;
+        grid.Resize(config.gridSize, config.gridSize, offset, offset);
+        if (UsesTurmite())
+            colors.Resize(config.gridSize, config.gridSize, offset, offset);
+        if (command.resetAnt || ruleChanged)
+        {
+            ResetAnt();
+        }
+        else if (!config.infinitePlane)
+        {
+            ants.Shift(offset, offset);
+            ants.Wrap(config.gridSize, config.gridSize);  // Keep every ant on a shrunk grid
+        }
+        ConfigureCheckpoints();
+        if (ruleChanged && checkpointer)
+            checkpointer->Restart(0);
+        if (universeChanged)
+            ResetTimeline();
+        MarkFull();
+        break;
+    }
+
+    case Command::FlipCell:
+    {
+        if (UsesTurmite())
+        {
+            // Cycles the cell through the rule's colors
+            if (command.row >= 0 && command.row < colors.Rows() && command.col >= 0 && command.col < colors.Cols())
+            {
+                uint8_t& cell = colors.Row(static_cast<int>(command.row))[command.col];
+                cell = uint8_t((cell + 1) % config.rule.colors);
+                MarkFull();
+            }
+            break;
+        }
+
+        bool alive;
+        if (config.infinitePlane)
+            alive = !plane.Flip(command.row, command.col);
+        else if (InView(command.row, command.col))
+            alive = !grid.Flip(static_cast<int>(command.row), static_cast<int>(command.col));
+        else
+            break;
+
+        if (!pendingFull)
+            pendingChanges.push_back(CellChange{ command.row, command.col, alive });
+        dirty = true;
+        break;
+    }
+
+    case Command::Stamp:
+    {
+        const Grid& pattern = command.payload->pattern;
+        if (config.infinitePlane)
+            plane.Paste(pattern, command.row, command.col);
+        else if (!UsesTurmite())
+            grid.Paste(pattern, command.row, command.col);
+        else
+        {
+            // Living cells become color 1
+            for (int r = 0; r < pattern.Rows(); ++r)
+            {
+                for (int c = 0; c < pattern.Cols(); ++c)
+                {
+                    const int64_t row = command.row + r;
+                    const int64_t col = command.col + c;
+                    if (InView(row, col))
+                        colors.Row(static_cast<int>(row))[col] = pattern.Get(r, c) ? 1 : 0;
+                }
+            }
+        }
+
+        // Pattern ants join after the existing ones (so they step last), clipped like the cells
+        for (const AntPlacement& placement : command.payload->ants)
+        {
+            const int64_t row = command.row + placement.row;
+            const int64_t col = command.col + placement.col;
+            if (config.infinitePlane || InView(row, col))
+                ants.Add(row, col, placement.direction);
+        }
+        MarkFull();
+        break;
+    }
+
+    case Command::ToggleAnt:
+        if (config.infinitePlane || InView(command.row, command.col))
+        {
+            if (!ants.RemoveAt(command.row, command.col))
+                ants.Add(command.row, command.col);
+            dirty = true;
+        }
+        break;
+
+    case Command::Save:
+    {
+        const bool saved = SaveUniverse(command.payload->path);
+        if (command.payload->saved)
+            command.payload->saved(saved);
+        break;
+    }
+
+    case Command::Load:
+        config = command.payload->config;
+        LoadUniverse(command.payload->universe);
+        ConfigureCheckpoints();
+        if (checkpointer)
+            checkpointer->Restart(generation.load(std::memory_order_relaxed));
+        MarkFull();
+        break;
+
+    case Command::Quit:
+        break;
+    }
+
+    if (edits)
+        ResetTimeline();
+}
+
+void SimulationWorker::Advance(uint64_t steps)
+{
+    ANT_PERF_SCOPE(Step);
+    ANT_PERF_ADD(Steps, steps);
+    ANT_TRACE_SCOPE("Simulation batch");
+    if (UsesTurmite())
+    {
+        // Color cells are sent as whole views; there is no change log for them
+        if (UsesParallel())
+            parallel->StepMany(ants, colors, config.rule, steps);
+        else
+            ants.StepMany(colors, config.rule, steps);
+        MarkFull();
+        generation.store(generation.load(std::memory_order_relaxed) + steps, std::memory_order_relaxed);
+        Checkpoint();
+        return;
+    }
+
+    // With a timeline, stop at each keyframe boundary so it can take the keyframe
+    uint64_t now = generation.load(std::memory_order_relaxed);
+    while (steps > 0)
+    {
+        const uint64_t slice = timeline.Empty() ? steps : std::min(steps, timeline.NextKeyframe(now) - now);
+        StepCells(slice);
+        steps -= slice;
+        now += slice;
+        generation.store(now, std::memory_order_relaxed);
+        if (!timeline.Empty())
+        {
+            if (config.infinitePlane)
+                timeline.Record(LoneAnt(), plane, now);
+            else
+                timeline.Record(LoneAnt(), grid, now);
+            timelineEnd.store(timeline.End(), std::memory_order_relaxed);
+        }
+    }
+
+    dirty = true;
+    Checkpoint();
+}
+
+// Steps the bit cells, logging the flips when that's cheaper than sending the whole view
+void SimulationWorker::StepCells(uint64_t steps)
+{
+    // Keep logging flips only while the log stays smaller than a full copy of the view
+    const uint64_t viewCells = uint64_t(config.gridSize) * config.gridSize;
+    // Every ant flips one cell per generation (capped so a huge step count can't overflow)
+    const uint64_t flips = steps <= viewCells ? steps * ants.Size() : viewCells + 1;
+    if (config.trackChanges && !pendingFull && pendingChanges.size() + flips <= viewCells)
+    {
+        highway.Reset();  // These steps aren't recorded
+        if (config.infinitePlane)
+            ants.StepMany(plane, steps, pendingChanges);
+        else if (UsesParallel())
+            parallel->StepMany(ants, grid, steps, pendingChanges);
+        else
+            ants.StepMany(grid, steps, pendingChanges);
+    }
+    else
+    {
+        // Skipped highway periods leave no change log, so they only run here
+        if (!FastForward(steps))
+        {
+            if (config.infinitePlane)
+                ants.StepMany(plane, steps);
+            else if (UsesParallel())
+                parallel->StepMany(ants, grid, steps);
+            else
+                ants.StepMany(grid, steps);
+        }
+        MarkFull();
+    }
+}
+
+// Steps a lone Langton's ant through the highway detector; false if it doesn't apply
+bool SimulationWorker::FastForward(uint64_t steps)
+{
+    if (!config.fastForward || ants.Size() != 1)
+    {
+        highway.Reset();
+        return false;
+    }
+
+    LangtonsAnt ant = LoneAnt();
+    if (config.infinitePlane)
+        highway.StepMany(ant, plane, steps);
+    else
+        highway.StepMany(ant, grid, steps);
+    SetLoneAnt(ant);
+    return true;
+}
+
+// Runs the lone ant forward or backward along the timeline to target
+void SimulationWorker::SeekGeneration(uint64_t target)
+{
+    if (timeline.Empty())
+        return;
+    const uint64_t now = generation.load(std::memory_order_relaxed);
+    target = std::min(std::max(target, timeline.Start()), timeline.End());
+    if (target == now)
+        return;
+    ANT_TRACE_SCOPE("Seek");
+
+    // A short hop logs its flips like a small forward batch; a long one goes
+    // through the keyframes and sends the whole view
+    LangtonsAnt ant = LoneAnt();
+    const uint64_t distance = target > now ? target - now : now - target;
+    const uint64_t viewCells = uint64_t(config.gridSize) * config.gridSize;
+    if (config.trackChanges && !pendingFull && pendingChanges.size() + distance <= viewCells)
+    {
+        if (target > now && config.infinitePlane)
+            ant.StepMany(plane, distance, pendingChanges);
+        else if (target > now)
+            ant.StepMany(grid, distance, pendingChanges);
+        else if (config.infinitePlane)
+            ant.StepBackMany(plane, distance, pendingChanges);
+        else
+            ant.StepBackMany(grid, distance, pendingChanges);
+    }
+    else
+    {
+        if (config.infinitePlane)
+            timeline.Seek(ant, plane, now, target);
+        else
+            timeline.Seek(ant, grid, now, target);
+        MarkFull();
+    }
+
+    SetLoneAnt(ant);
+    generation.store(target, std::memory_order_relaxed);
+    if (checkpointer)
+        checkpointer->Restart(target);
+    dirty = true;
+}
+
+// Starts a new timeline from the current state, if a lone Langton's ant can be rewound
+void SimulationWorker::ResetTimeline()
+{
+    const uint64_t now = generation.load(std::memory_order_relaxed);
+    if (UsesTurmite() || ants.Size() != 1)
+        timeline.Clear();
+    else if (config.infinitePlane)
+        timeline.Reset(LoneAnt(), plane, now);
+    else
+        timeline.Reset(LoneAnt(), grid, now);
+
+    canRewind.store(!timeline.Empty(), std::memory_order_relaxed);
+    timelineStart.store(timeline.Empty() ? now : timeline.Start(), std::memory_order_relaxed);
+    timelineEnd.store(timeline.Empty() ? now : timeline.End(), std::memory_order_relaxed);
+}
+
+LangtonsAnt SimulationWorker::LoneAnt() const
+{
+    return LangtonsAnt(ants.GetRow(0), ants.GetCol(0), ants.GetDirection(0));
+}
+
+void SimulationWorker::SetLoneAnt(const LangtonsAnt& ant)
+{
+    ants.Clear();
+    ants.Add(ant.GetRow(), ant.GetCol(), ant.GetDirection());
+}
+
+// Back to a single ant in the center
+void SimulationWorker::ResetAnt()
+{
+    ants.Clear();
+    ants.Add(config.gridSize / 2, config.gridSize / 2);
+}
+
+bool SimulationWorker::SaveUniverse(const std::string& path) const
+{
+    ANT_TRACE_SCOPE("Write universe");
+    UniverseInfo info;
+    info.rule = config.rule;
+    info.generation = generation.load(std::memory_order_relaxed);
+    info.infinitePlane = config.infinitePlane;
+    if (UsesTurmite())
+        return WriteUniverse(path, colors, ants, info);
+    if (!config.infinitePlane)
+        return WriteUniverse(path, grid, ants, info);
+
+    // The plane is saved as the bounding box of its tiles and the view, or as its tiles
+    UniverseState window;
+    CaptureUniverse(window);
+    return WriteUniverse(path, window);
+}
+
+// Copies what SaveUniverse writes into universe, reusing its grids
+void SimulationWorker::CaptureUniverse(UniverseState& universe) const
+{
+    universe.info.rule = config.rule;
+    universe.info.generation = generation.load(std::memory_order_relaxed);
+    universe.ants = ants;
+    if (UsesTurmite())
+        CaptureColors(colors, universe);
+    else if (!config.infinitePlane)
+        CaptureCells(grid, universe);
+    else
+        CapturePlane(plane, config.gridSize, universe);
+}
+
+// Starts, stops or retimes the checkpoint writer to match the config
+void SimulationWorker::ConfigureCheckpoints()
+{
+    if (config.checkpointSteps == 0 && config.checkpointSeconds <= 0)
+    {
+        checkpointer.reset();
+        return;
+    }
+
+    CheckpointConfig checkpoints;
+    checkpoints.directory = config.checkpointDirectory;
+    checkpoints.everySteps = config.checkpointSteps;
+    checkpoints.everySeconds = config.checkpointSeconds;
+    if (checkpointer && checkpointer->Config().directory == checkpoints.directory &&
+        checkpointer->Config().everySteps == checkpoints.everySteps &&
+        checkpointer->Config().everySeconds == checkpoints.everySeconds)
+        return;
+    checkpointer = std::make_unique<Checkpointer>(checkpoints);
+    checkpointer->Restart(generation.load(std::memory_order_relaxed));
+}
+
+// Hands a copy of the universe to the checkpoint writer when one is due; the writing happens on its thread
+void SimulationWorker::Checkpoint()
+{
+    if (!checkpointer || !checkpointer->Due(generation.load(std::memory_order_relaxed)))
+        return;
+    CaptureUniverse(checkpointer->Buffer());
+    checkpointer->Submit();
+}
+
+// Takes the cells the file had, converted to what the rule runs on, and the ants as they were saved
+void SimulationWorker::LoadUniverse(UniverseState& universe)
+{
+    const int n = config.gridSize;
+    grid = Grid(n, n);
+    plane.Clear();
+    colors = ByteGrid();
+
+    // A plane stored as tiles runs as it is on the plane; the grid gets its view
+    if (universe.plane.TileCount() > 0 && (UsesTurmite() || !config.infinitePlane))
+    {
+        universe.cells = Grid(n, n);
+        universe.plane.CopyRegion(0, 0, universe.cells);
+        universe.plane.Clear();
+        universe.info.originRow = 0;
+        universe.info.originCol = 0;
+    }
+
+    if (UsesTurmite())
+    {
+        config.infinitePlane = false;  // Turmites only run on the wrapping grid
+        colors = universe.colors.Rows() > 0 ? std::move(universe.colors) : CellsToColors(universe.cells);
+        colors.Resize(n, n);
+
+        // Colors the rule doesn't have would index past its table
+        for (int r = 0; r < n; ++r)
+            for (int c = 0; c < n; ++c)
+                if (colors.Row(r)[c] >= config.rule.colors)
+                    colors.Row(r)[c] = 0;
+    }
+    else
+    {
+        Grid cells = universe.cells.Rows() > 0 ? std::move(universe.cells) : ColorsToCells(universe.colors);
+        if (config.infinitePlane && universe.plane.TileCount() > 0)
+        {
+            plane = std::move(universe.plane);
+        }
+        else if (config.infinitePlane)
+        {
+            // Tile rows at a time; tiles only appear where the file has living cells
+            plane.Paste(cells, universe.info.originRow, universe.info.originCol);
+        }
+        else if (universe.info.originRow == 0 && universe.info.originCol == 0)
+        {
+            cells.Resize(n, n);
+            grid = std::move(cells);
+        }
+        else
+        {
+            // A saved plane: the grid gets the window at plane cell (0, 0)
+            for (int r = 0; r < cells.Rows(); ++r)
+            {
+                const int64_t row = universe.info.originRow + r;
+                for (int c = 0; c < cells.Cols(); ++c)
+                {
+                    const int64_t col = universe.info.originCol + c;
+                    if (InView(row, col) && cells.Get(r, c))
+                        grid.Set(static_cast<int>(row), static_cast<int>(col), true);
+                }
+            }
+        }
+    }
+
+    ants = std::move(universe.ants);
+    ants.SetPolicy(config.collisionPolicy);
+    if (!config.infinitePlane)
+        ants.Wrap(n, n);
+    generation.store(universe.info.generation, std::memory_order_relaxed);
+}
+
+// Large colonies on the wrapping grid are split across threads (the plane's tile map isn't thread-safe)
+bool SimulationWorker::UsesParallel()
+{
+    if (config.infinitePlane || config.threadCount == 1 || ants.Size() < kParallelAnts)
+        return false;
+    if (!parallel || (config.threadCount > 0 && parallel->ThreadCount() != config.threadCount))
+        parallel = std::make_unique<ParallelColony>(config.threadCount);
+    return parallel->ThreadCount() > 1;
+}
+
+// True for a cell of the wrapping grid (or of the view in plane mode)
+bool SimulationWorker::InView(int64_t row, int64_t col) const
+{
+    return row >= 0 && row < config.gridSize && col >= 0 && col < config.gridSize;
+}
+
+// The next snapshot will carry the whole view, so the change log is no longer needed
+void SimulationWorker::MarkFull()
+{
+    pendingFull = true;
+    pendingChanges.clear();
+    dirty = true;
+}
+
+// Publishes when there is news and the UI has taken the previous snapshot
+void SimulationWorker::TryPublish()
+{
+    if (!dirty || snapshots.Pending())
+        return;
+    ANT_TRACE_SCOPE("Publish snapshot");
+
+    SimulationSnapshot& snapshot = snapshots.Back();
+    snapshot.full = pendingFull;
+    snapshot.changes.swap(pendingChanges);
+    pendingChanges.clear();
+
+    if (pendingFull)
+    {
+        const int n = config.gridSize;
+        if (snapshot.cells.Rows() != n || snapshot.cells.Cols() != n)
+            snapshot.cells = Grid(n, n);
+
+        if (UsesTurmite())
+        {
+            // The colors, plus the living (nonzero) cells as bits for the neighbor counts
+            if (snapshot.colors.Rows() != n || snapshot.colors.Cols() != n)
+                snapshot.colors = ByteGrid(n, n);
+            std::memcpy(snapshot.colors.Data(), colors.Data(), colors.SizeBytes());
+
+            snapshot.cells.Clear();
+            for (int r = 0; r < n; ++r)
+            {
+                const uint8_t* source = colors.Row(r);
+                uint64_t* bits = snapshot.cells.Row(r);
+                for (int c = 0; c < n; ++c)
+                    bits[c >> 6] |= uint64_t(source[c] != 0) << (c & 63);
+            }
+        }
+        else
+        {
+            if (snapshot.colors.Rows() != 0)
+                snapshot.colors = ByteGrid();
+
+            if (config.infinitePlane)
+                plane.CopyRegion(0, 0, snapshot.cells);
+            else
+                std::memcpy(snapshot.cells.Data(), grid.Data(), grid.SizeBytes());
+        }
+    }
+
+    const bool hasAnt = !ants.Empty();
+    snapshot.antRow = hasAnt ? ants.GetRow(0) : 0;
+    snapshot.antCol = hasAnt ? ants.GetCol(0) : 0;
+    snapshot.antDirection = hasAnt ? ants.GetDirection(0) : 0;
+    snapshot.antState = hasAnt ? ants.GetState(0) : 0;
+    snapshot.antCount = ants.Size();
+    snapshot.generation = generation.load(std::memory_order_relaxed);
+    snapshot.checkpointFailing = checkpointer && checkpointer->Failing();
+    snapshots.Publish();
+    ANT_PERF_MEMORY(Universe, grid.SizeBytes() + colors.SizeBytes() + plane.MemoryBytes() + timeline.MemoryBytes());
+
+    pendingFull = false;
+    dirty = false;
+}
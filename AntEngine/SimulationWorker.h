@@ -0,0 +1,197 @@
+// Defines SimulationWorker, which runs the ant on its own thread so a long
+// step batch never freezes the window. The UI posts commands (play, pause,
+// step, clear, edits). The worker publishes snapshots through a lock-free
+// triple buffer, and the panel picks them up at display rate.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "AntColony.h"
+#include "Checkpoint.h"
+#include "Grid.h"
+#include "Highway.h"
+#include "SparseUniverse.h"
+#include "LangtonsAnt.h"
+#include "ParallelColony.h"
+#include "PerfCounters.h"
+#include "Timeline.h"
+#include "Trace.h"
+#include "Turmite.h"
+#include "TripleBuffer.h"
+#include "UniverseIO.h"
+
+// The part of Settings the worker needs (kept free of wx types)
+struct SimulationConfig
+{
+    int gridSize = 15;           // Grid size, or view size in plane mode
+    bool resizeCentered = true;  // A new grid size keeps the universe centered (false: at the top-left)
+    bool infinitePlane = false;
+    int stepsPerBatch = 1;       // Steps per tick
+    int intervalMs = 50;         // Time between ticks; 0 runs batches back to back
+    bool trackChanges = true;    // Log flipped cells for incremental display updates
+
+    // Langton's ant (RL) runs on bit cells and supports the plane; any other
+    // rule runs the turmite engine on color cells of the wrapping grid
+    TurmiteRule rule;
+
+    // What ants sharing a cell see when several of them are placed
+    CollisionPolicy collisionPolicy = CollisionPolicy::Sequential;
+
+    // Threads for stepping large colonies on the wrapping grid (0 = one per core, 1 = never split)
+    int threadCount = 0;
+
+    // A lone Langton's ant that settled into a highway skips whole periods in big batches
+    bool fastForward = true;
+
+    // While it runs, the universe is saved in the background every
+    // checkpointSteps generations or checkpointSeconds seconds (0 = off)
+    std::string checkpointDirectory = "checkpoints";
+    uint64_t checkpointSteps = 0;
+    int checkpointSeconds = 0;
+};
+
+// What the UI gets from the worker. Snapshots are never skipped, so the change
+// logs chain: applying each one in turn rebuilds the view exactly.
+struct SimulationSnapshot
+{
+    bool full = true;                  // cells holds the whole view; changes is empty
+    Grid cells;                        // The view (gridSize x gridSize), only when full
+    ByteGrid colors;                   // Cell colors of the view, only for turmite rules
+    std::vector<CellChange> changes;   // Cells flipped since the previous snapshot, in order
+    int64_t antRow = 0;                // First ant (all zero when every ant was removed)
+    int64_t antCol = 0;
+    int antDirection = 0;
+    int antState = 0;
+    size_t antCount = 0;
+    uint64_t generation = 0;
+    bool checkpointFailing = false;    // Checkpoints are on and the last one couldn't be written
+};
+
+class SimulationWorker
+{
+public:
+    explicit SimulationWorker(const SimulationConfig& config);
+    ~SimulationWorker();  // Stops and joins the thread
+
+    // Commands; they are queued and run on the worker thread in order
+    void Play();
+    void Pause();
+    void Step(uint64_t steps);
+    void Clear();
+    void Configure(const SimulationConfig& config, bool resetAnt);
+    void FlipCell(int64_t row, int64_t col);
+    void Stamp(const Grid& pattern, int64_t row0, int64_t col0);  // Copies pattern (dead cells too)
+    void Stamp(const Grid& pattern, const std::vector<AntPlacement>& ants, int64_t row0, int64_t col0);  // Also adds the pattern's ants
+    void ToggleAnt(int64_t row, int64_t col);  // Removes the ant on the cell, or adds one facing up
+
+    // Time travel for a lone Langton's ant: its history since the last edit
+    // is kept as a timeline, and these move along it (clamped to its ends).
+    // They do nothing while CanRewind is false.
+    void Seek(uint64_t generation);
+    void StepBack(uint64_t steps);
+
+    // Writes the universe, ants and generation as the worker has them (the
+    // whole visited area in plane mode), then calls done on the worker
+    // thread with whether it worked
+    void Save(const std::string& path, std::function<void(bool)> done);
+
+    // Replaces the universe, ants and generation. config must already have
+    // the loaded universe's size and rule.
+    void Load(const SimulationConfig& config, UniverseState universe);
+
+    bool IsRunning() const { return running.load(std::memory_order_relaxed); }
+    uint64_t Generation() const { return generation.load(std::memory_order_relaxed); }
+
+    // The timeline's ends: the generation of the last edit and the furthest one reached since
+    bool CanRewind() const { return canRewind.load(std::memory_order_relaxed); }
+    uint64_t TimelineStart() const { return timelineStart.load(std::memory_order_relaxed); }
+    uint64_t TimelineEnd() const { return timelineEnd.load(std::memory_order_relaxed); }
+
+    // UI thread: takes the newest snapshot, if one was published since the last call
+    bool ConsumeSnapshot() { return snapshots.Consume(); }
+    const SimulationSnapshot& Snapshot() const { return snapshots.Front(); }
+
+private:
+    // What configure, stamp, save and load carry; kept out of Command so
+    // the frequent small commands don't build and destroy it
+    struct Payload
+    {
+        SimulationConfig config;             // Configure, Load
+        Grid pattern;                        // Stamp
+        std::vector<AntPlacement> ants;      // Stamp
+        std::string path;                    // Save
+        std::function<void(bool)> saved;     // Save
+        UniverseState universe;              // Load
+    };
+
+    struct Command
+    {
+        enum Type { Play, Pause, Step, StepBack, Seek, Clear, Configure, FlipCell, Stamp, ToggleAnt, Save, Load, Quit } type;
+        uint64_t steps = 0;
+        uint64_t target = 0;  // Generation to seek to
+        int64_t row = 0;
+        int64_t col = 0;
+        bool resetAnt = false;
+        std::unique_ptr<Payload> payload;  // Configure, Stamp, Save and Load only
+    };
+
+    void Post(Command command);
+    void Run();
+    void Execute(Command& command);
+    void Advance(uint64_t steps);
+    void StepCells(uint64_t steps);
+    bool FastForward(uint64_t steps);
+    void SeekGeneration(uint64_t target);
+    void ResetTimeline();
+    LangtonsAnt LoneAnt() const;
+    void SetLoneAnt(const LangtonsAnt& ant);
+    void ResetAnt();
+    bool SaveUniverse(const std::string& path) const;
+    void CaptureUniverse(UniverseState& universe) const;
+    void ConfigureCheckpoints();
+    void Checkpoint();
+    void LoadUniverse(UniverseState& universe);
+    bool InView(int64_t row, int64_t col) const;
+    bool UsesParallel();
+    void MarkFull();
+    void TryPublish();
+    bool UsesTurmite() const { return !config.rule.IsLangtonsAnt(); }
+
+    // Worker thread state (never touched by the UI thread once running)
+    SimulationConfig config;
+    Grid grid;
+    SparseUniverse plane;
+    AntColony ants;                          // Every ant; one ant takes the single-ant kernels
+    std::unique_ptr<ParallelColony> parallel;  // Created once a colony is large enough to split
+    HighwayDetector highway;                 // History of the lone ant; reset whenever anything else moves it
+    Timeline timeline;                       // Keyframes of the lone ant's run since the last edit (empty otherwise)
+    ByteGrid colors;                         // Cells for turmite rules (empty otherwise)
+    std::unique_ptr<Checkpointer> checkpointer;  // Only while checkpoints are on
+    std::vector<CellChange> pendingChanges;  // Flips not yet published
+    bool pendingFull = true;                 // Next snapshot must carry the whole view
+    bool dirty = true;                       // Something changed since the last snapshot
+    std::chrono::steady_clock::time_point nextTick;
+
+    // Shared with the UI thread
+    std::atomic<bool> running{ false };
+    std::atomic<uint64_t> generation{ 0 };
+    std::atomic<bool> canRewind{ false };
+    std::atomic<uint64_t> timelineStart{ 0 };
+    std::atomic<uint64_t> timelineEnd{ 0 };
+    TripleBuffer<SimulationSnapshot> snapshots;
+
+    std::mutex mutex;                 // Guards commands
+    std::condition_variable wake;
+    std::vector<Command> commands;
+    std::atomic<bool> hasCommands{ false };
+    std::thread thread;
+};
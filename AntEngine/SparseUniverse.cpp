@@ -0,0 +1,220 @@
+// Implements the tiled hash map behind the infinite plane mode
+
+#include "SparseUniverse.h"
+#include <algorithm>
+#include <cstring>
+
+SparseUniverse::SparseUniverse()
+{
+    Clear();
+}
+
+void SparseUniverse::Clear()
+{
+    slots.assign(64, Slot{ 0, kEmptySlot });
+    blocks.clear();
+    tileKeys.clear();
+    cachedTile = nullptr;
+}
+
+void SparseUniverse::Reset()
+{
+    // Only the tiles handed out can hold living cells; the rest of the pool is still zero
+    for (size_t first = 0; first < tileKeys.size(); first += kTilesPerBlock)
+    {
+        const size_t count = std::min<size_t>(kTilesPerBlock, tileKeys.size() - first);
+        std::memset(blocks[first / kTilesPerBlock].get(), 0, sizeof(Tile) * count);
+    }
+    std::fill(slots.begin(), slots.end(), Slot{ 0, kEmptySlot });
+    tileKeys.clear();
+    cachedTile = nullptr;
+}
+
+SparseUniverse::Tile* SparseUniverse::Lookup(uint64_t key) const
+{
+    if (cachedTile && cachedKey == key)
+        return cachedTile;
+
+    // Linear probing until the key or an empty slot is found
+    const size_t mask = slots.size() - 1;
+    for (size_t i = Hash(key) & mask;; i = (i + 1) & mask)
+    {
+        const Slot& slot = slots[i];
+        if (slot.tile == kEmptySlot)
+            return nullptr;
+        if (slot.key == key)
+        {
+            cachedKey = key;
+            cachedTile = TileAt(slot.tile);
+            return cachedTile;
+        }
+    }
+}
+
+uint32_t SparseUniverse::AllocateTile(uint64_t key)
+{
+    const uint32_t index = static_cast<uint32_t>(tileKeys.size());
+    if (index % kTilesPerBlock == 0 && index / kTilesPerBlock == blocks.size())  // Blocks kept by Reset come first
+    {
+        blocks.emplace_back(new Tile[kTilesPerBlock]);
+        std::memset(blocks.back().get(), 0, sizeof(Tile) * kTilesPerBlock);
+    }
+    tileKeys.push_back(key);
+    return index;
+}
+
+void SparseUniverse::Rehash(size_t newCapacity)
+{
+    slots.assign(newCapacity, Slot{ 0, kEmptySlot });
+    const size_t mask = newCapacity - 1;
+    for (uint32_t t = 0; t < tileKeys.size(); ++t)
+    {
+        size_t i = Hash(tileKeys[t]) & mask;
+        while (slots[i].tile != kEmptySlot)
+            i = (i + 1) & mask;
+        slots[i] = Slot{ tileKeys[t], t };
+    }
+}
+
+const SparseUniverse::Tile* SparseUniverse::FindTile(int64_t tileRow, int64_t tileCol) const
+{
+    return Lookup(MakeKey(tileRow, tileCol));
+}
+
+SparseUniverse::Tile* SparseUniverse::GetOrCreateTile(int64_t tileRow, int64_t tileCol)
+{
+    const uint64_t key = MakeKey(tileRow, tileCol);
+    if (Tile* tile = Lookup(key))
+        return tile;
+
+    // Keep the load factor under one half so probe chains stay short
+    if ((tileKeys.size() + 1) * 2 > slots.size())
+        Rehash(slots.size() * 2);
+
+    const size_t mask = slots.size() - 1;
+    size_t i = Hash(key) & mask;
+    while (slots[i].tile != kEmptySlot)
+        i = (i + 1) & mask;
+
+    slots[i] = Slot{ key, AllocateTile(key) };
+    cachedKey = key;
+    cachedTile = TileAt(slots[i].tile);
+    return cachedTile;
+}
+
+bool SparseUniverse::Get(int64_t row, int64_t col) const
+{
+    const Tile* tile = Lookup(MakeKey(row >> kTileShift, col >> kTileShift));
+    if (!tile)
+        return false;  // Never-visited tiles are all dead
+    return (tile->rows[row & kTileMask] >> (col & kTileMask)) & 1;
+}
+
+void SparseUniverse::Set(int64_t row, int64_t col, bool alive)
+{
+    if (!alive && !Lookup(MakeKey(row >> kTileShift, col >> kTileShift)))
+        return;  // Killing a cell in an empty tile needs no allocation
+
+    uint64_t& word = GetOrCreateTile(row >> kTileShift, col >> kTileShift)->rows[row & kTileMask];
+    const uint64_t mask = uint64_t(1) << (col & kTileMask);
+    word = alive ? (word | mask) : (word & ~mask);
+}
+
+bool SparseUniverse::Flip(int64_t row, int64_t col)
+{
+    uint64_t& word = GetOrCreateTile(row >> kTileShift, col >> kTileShift)->rows[row & kTileMask];
+    const int bit = static_cast<int>(col & kTileMask);
+    const bool old = (word >> bit) & 1;
+    word ^= uint64_t(1) << bit;
+    return old;
+}
+
+void SparseUniverse::CopyRegion(int64_t row0, int64_t col0, Grid& out) const
+{
+    const int words = (out.Cols() + 63) >> 6;
+    const int offset = static_cast<int>(col0 & kTileMask);
+
+    for (int r = 0; r < out.Rows(); ++r)
+    {
+        const int64_t row = row0 + r;
+        const int64_t tileRow = row >> kTileShift;
+        const int localRow = static_cast<int>(row & kTileMask);
+        uint64_t* dest = out.Row(r);
+
+        // Each output word straddles at most two tiles along the row
+        for (int w = 0; w < words; ++w)
+        {
+            const int64_t tileCol = (col0 + int64_t(w) * 64) >> kTileShift;
+            const Tile* low = Lookup(MakeKey(tileRow, tileCol));
+            uint64_t word = low ? low->rows[localRow] >> offset : 0;
+            if (offset)
+            {
+                const Tile* high = Lookup(MakeKey(tileRow, tileCol + 1));
+                if (high)
+                    word |= high->rows[localRow] << (64 - offset);
+            }
+            dest[w] = word;
+        }
+
+        // Keep the cells past the last column dead
+        if (out.Cols() & 63)
+            dest[words - 1] &= ~(~uint64_t(0) << (out.Cols() & 63));
+    }
+}
+
+void SparseUniverse::Paste(const Grid& source, int64_t row0, int64_t col0)
+{
+    if (source.Rows() == 0 || source.Cols() == 0)
+        return;
+
+    const int64_t lastTileRow = (row0 + source.Rows() - 1) >> kTileShift;
+    const int64_t lastTileCol = (col0 + source.Cols() - 1) >> kTileShift;
+    for (int64_t tileRow = row0 >> kTileShift; tileRow <= lastTileRow; ++tileRow)
+    {
+        // The source rows this tile row covers
+        const int64_t top = std::max(tileRow << kTileShift, row0);
+        const int64_t bottom = std::min((tileRow + 1) << kTileShift, row0 + source.Rows());
+        for (int64_t tileCol = col0 >> kTileShift; tileCol <= lastTileCol; ++tileCol)
+        {
+            const int64_t left = std::max(tileCol << kTileShift, col0);
+            const int64_t right = std::min((tileCol + 1) << kTileShift, col0 + source.Cols());
+            const int count = static_cast<int>(right - left);
+            const int shift = static_cast<int>(left & kTileMask);
+
+            // Dead cells only need writing where a tile already exists
+            Tile* tile = Lookup(MakeKey(tileRow, tileCol));
+            for (int64_t row = top; row < bottom && !tile; ++row)
+            {
+                if (ReadBits(source.Row(static_cast<int>(row - row0)), left - col0, count) != 0)
+                    tile = GetOrCreateTile(tileRow, tileCol);
+            }
+            if (!tile)
+                continue;
+
+            for (int64_t row = top; row < bottom; ++row)
+            {
+                const uint64_t bits = ReadBits(source.Row(static_cast<int>(row - row0)), left - col0, count);
+                WriteBits(&tile->rows[row & kTileMask], shift, count, bits);
+            }
+        }
+    }
+}
+
+size_t SparseUniverse::MemoryBytes() const
+{
+    return blocks.size() * kTilesPerBlock * sizeof(Tile)
+        + slots.capacity() * sizeof(Slot)
+        + tileKeys.capacity() * sizeof(uint64_t);
+}
+
+uint64_t SparseUniverse::CountAlive() const
+{
+    uint64_t count = 0;
+    ForEachTile([&count](int64_t, int64_t, const Tile& tile)
+        {
+            for (uint64_t word : tile.rows)
+                for (; word; word &= word - 1)
+                    ++count;
+        });
+    return count;
+}
@@ -0,0 +1,106 @@
+// Defines SparseUniverse, an unbounded plane of cells used by the
+// "infinite plane" mode. The plane is cut into 64x64 bit-packed tiles
+// that are allocated from a pool only when the ant first writes to them,
+// so memory grows with the area visited rather than the bounding box.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Grid.h"
+
+class SparseUniverse
+{
+public:
+    static constexpr int kTileShift = 6;
+    static constexpr int kTileSize = 1 << kTileShift;  // Cells per tile side
+    static constexpr int kTileMask = kTileSize - 1;
+
+    // One 64x64 block of cells, one 64-bit word per row
+    struct alignas(64) Tile
+    {
+        uint64_t rows[kTileSize];
+    };
+
+    SparseUniverse();
+
+    // Cell access in plane coordinates (any 64-bit value within the tile range)
+    bool Get(int64_t row, int64_t col) const;
+    void Set(int64_t row, int64_t col, bool alive);
+    bool Flip(int64_t row, int64_t col);  // Returns the value before the flip
+
+    // Tile access in tile coordinates (cell coordinate >> kTileShift)
+    const Tile* FindTile(int64_t tileRow, int64_t tileCol) const;  // nullptr if never written
+    Tile* GetOrCreateTile(int64_t tileRow, int64_t tileCol);
+
+    // Copies the window whose top-left plane cell is (row0, col0) into out,
+    // which keeps its size. Used to render or save part of the plane.
+    void CopyRegion(int64_t row0, int64_t col0, Grid& out) const;
+
+    // Copies every cell of source, dead ones too, so that its top-left cell
+    // lands on plane cell (row0, col0). Works a tile row at a time and only
+    // creates tiles that get living cells.
+    void Paste(const Grid& source, int64_t row0, int64_t col0);
+
+    // Drops every tile
+    void Clear();
+
+    // Kills every cell but keeps the tile pool and the table at their size, so
+    // a universe refilled to about the same extent allocates nothing
+    void Reset();
+
+    size_t TileCount() const { return tileKeys.size(); }
+    size_t MemoryBytes() const;
+    uint64_t CountAlive() const;
+
+    // Calls f(tileRow, tileCol, tile) for every allocated tile
+    template <typename F>
+    void ForEachTile(F f) const
+    {
+        for (size_t i = 0; i < tileKeys.size(); ++i)
+            f(KeyRow(tileKeys[i]), KeyCol(tileKeys[i]), *TileAt(static_cast<uint32_t>(i)));
+    }
+
+private:
+    static constexpr uint32_t kEmptySlot = 0xFFFFFFFFu;
+    static constexpr int kTilesPerBlock = 256;
+
+    // Open-addressing slot: packed tile coordinates and an index into the tile pool
+    struct Slot
+    {
+        uint64_t key;
+        uint32_t tile;
+    };
+
+    static uint64_t MakeKey(int64_t tileRow, int64_t tileCol)
+    {
+        return (uint64_t(uint32_t(tileRow)) << 32) | uint32_t(tileCol);
+    }
+    static int64_t KeyRow(uint64_t key) { return int32_t(uint32_t(key >> 32)); }
+    static int64_t KeyCol(uint64_t key) { return int32_t(uint32_t(key)); }
+
+    static size_t Hash(uint64_t key)
+    {
+        // Fibonacci hashing mixes both coordinates into the high bits
+        key *= 0x9E3779B97F4A7C15ull;
+        return static_cast<size_t>(key ^ (key >> 29));
+    }
+
+    Tile* TileAt(uint32_t index) const
+    {
+        return &blocks[index / kTilesPerBlock][index % kTilesPerBlock];
+    }
+
+    Tile* Lookup(uint64_t key) const;
+    uint32_t AllocateTile(uint64_t key);
+    void Rehash(size_t newCapacity);
+
+    std::vector<Slot> slots;                  // Capacity is always a power of two
+    std::vector<std::unique_ptr<Tile[]>> blocks;  // Tile pool; tiles never move once allocated
+    std::vector<uint64_t> tileKeys;           // Key of each pool tile, in allocation order
+
+    // One-entry cache: most accesses hit the tile touched last
+    mutable uint64_t cachedKey = 0;
+    mutable Tile* cachedTile = nullptr;
+};
@@ -0,0 +1,259 @@
+// Implements the keyframed timeline used to scrub a lone ant's history
+
+#include "Timeline.h"
+#include <algorithm>
+#include <cstring>
+
+Timeline::Timeline(uint64_t interval)
+    : interval(std::max<uint64_t>(interval, 1))
+{
+}
+
+void Timeline::Reset(const LangtonsAnt& ant, const Grid& cells, uint64_t generation)
+{
+    ResetAt(ant, cells, generation);
+}
+
+void Timeline::Reset(const LangtonsAnt& ant, const SparseUniverse& plane, uint64_t generation)
+{
+    ResetAt(ant, plane, generation);
+}
+
+void Timeline::Record(const LangtonsAnt& ant, const Grid& cells, uint64_t generation)
+{
+    RecordAt(ant, cells, generation);
+}
+
+void Timeline::Record(const LangtonsAnt& ant, const SparseUniverse& plane, uint64_t generation)
+{
+    RecordAt(ant, plane, generation);
+}
+
+void Timeline::Seek(LangtonsAnt& ant, Grid& cells, uint64_t generation, uint64_t target)
+{
+    SeekTo(ant, cells, generation, target);
+}
+
+void Timeline::Seek(LangtonsAnt& ant, SparseUniverse& plane, uint64_t generation, uint64_t target)
+{
+    SeekTo(ant, plane, generation, target);
+}
+
+void Timeline::Clear()
+{
+    keyframes.clear();
+    shadow.clear();
+    carry.clear();
+    tiles.clear();
+    end = 0;
+    shadowGeneration = 0;
+}
+
+uint64_t Timeline::NextKeyframe(uint64_t generation) const
+{
+    return (generation / interval + 1) * interval;
+}
+
+size_t Timeline::MemoryBytes() const
+{
+    size_t bytes = (carry.capacity() + changed.capacity() + merged.capacity()) * sizeof(Word) +
+        shadow.capacity() * sizeof(uint64_t) + keyframes.capacity() * sizeof(Keyframe) + tiles.capacity() * sizeof(tiles[0]);
+    for (const Keyframe& keyframe : keyframes)
+        bytes += keyframe.delta.capacity() * sizeof(Word);
+    return bytes;
+}
+
+template <typename Universe>
+void Timeline::ResetAt(const LangtonsAnt& ant, const Universe& universe, uint64_t generation)
+{
+    Clear();
+    shadowGeneration = generation;
+    end = generation;
+    keyframes.push_back(Keyframe{ generation, ant.GetRow(), ant.GetCol(), ant.GetDirection(), Words() });
+    Diff(universe, keyframes.back().delta);  // Against an empty shadow: every living word
+}
+
+template <typename Universe>
+void Timeline::RecordAt(const LangtonsAnt& ant, const Universe& universe, uint64_t generation)
+{
+    if (keyframes.empty())
+        return;
+    end = std::max(end, generation);
+
+    // Going forward again after a seek passes keyframes the timeline already has
+    if (generation % interval != 0 || generation <= shadowGeneration)
+        return;
+
+    changed.clear();
+    Diff(universe, changed);
+    shadowGeneration = generation;
+
+    keyframes.push_back(Keyframe{ generation, ant.GetRow(), ant.GetCol(), ant.GetDirection(), Words() });
+    Xor(carry, changed, keyframes.back().delta);
+    carry.clear();
+    // Comparing a word costs a fraction of a step, so an interval of at
+    // least the shadow's words keeps keyframes well under the stepping time
+    if (keyframes.size() > kMaxKeyframes || shadow.size() > interval)
+        Thin();
+}
+
+// Doubles the interval and folds every keyframe off the new boundaries into the next one kept
+void Timeline::Thin()
+{
+    interval *= 2;
+    Words pending;
+    size_t kept = 1;  // The first keyframe always stays: it holds the cells the deltas start from
+    for (size_t i = 1; i < keyframes.size(); ++i)
+    {
+        Xor(pending, keyframes[i].delta, merged);
+        pending.swap(merged);
+        if (keyframes[i].generation % interval == 0)
+        {
+            keyframes[i].delta.swap(pending);
+            pending.clear();
+            keyframes[kept++] = std::move(keyframes[i]);
+        }
+    }
+    keyframes.resize(kept);
+    carry.swap(pending);  // What the dropped newest keyframes changed since the last one kept
+}
+
+template <typename Universe>
+void Timeline::SeekTo(LangtonsAnt& ant, Universe& universe, uint64_t generation, uint64_t target)
+{
+    // Both directions step at the same speed
+    auto run = [&](uint64_t from, uint64_t to)
+    {
+        if (to > from)
+            ant.StepMany(universe, to - from);
+        else if (from > to)
+            ant.StepBackMany(universe, from - to);
+    };
+
+    if (keyframes.empty() || target == generation)
+    {
+        run(generation, target);
+        return;
+    }
+
+    // The keyframe the current state steps back to, and the one closest to the target
+    const size_t from = KeyframeAtOrBefore(generation);
+    size_t to = KeyframeAtOrBefore(target);
+    if (to + 1 < keyframes.size() && keyframes[to + 1].generation - target < target - keyframes[to].generation)
+        ++to;
+
+    // Applying a word of delta costs about as much as a step
+    const uint64_t toGeneration = keyframes[to].generation;
+    uint64_t viaKeyframes = (generation - keyframes[from].generation) +
+        (std::max(target, toGeneration) - std::min(target, toGeneration));
+    for (size_t i = std::min(from, to) + 1; i <= std::max(from, to); ++i)
+        viaKeyframes += keyframes[i].delta.size();
+    if (std::max(target, generation) - std::min(target, generation) <= viaKeyframes)
+    {
+        run(generation, target);
+        return;
+    }
+
+    run(generation, keyframes[from].generation);
+    for (size_t i = std::min(from, to) + 1; i <= std::max(from, to); ++i)
+        Apply(universe, keyframes[i].delta);
+    ant = LangtonsAnt(keyframes[to].row, keyframes[to].col, keyframes[to].direction);
+    run(toGeneration, target);
+}
+
+size_t Timeline::KeyframeAtOrBefore(uint64_t generation) const
+{
+    const auto after = std::upper_bound(keyframes.begin(), keyframes.end(), generation,
+        [](uint64_t g, const Keyframe& keyframe) { return g < keyframe.generation; });
+    return after == keyframes.begin() ? 0 : size_t(after - keyframes.begin()) - 1;
+}
+
+void Timeline::Diff(const Grid& cells, Words& out)
+{
+    const size_t stride = cells.StrideWords();
+    shadow.resize(size_t(cells.Rows()) * stride);
+    const size_t wordsPerRow = (size_t(cells.Cols()) + 63) / 64;
+    for (int r = 0; r < cells.Rows(); ++r)
+        DiffRun(cells.Row(r), size_t(r) * stride, wordsPerRow, out);
+}
+
+void Timeline::Diff(const SparseUniverse& plane, Words& out)
+{
+    // Tiles are visited in pool order, so the keys come out sorted; the pool
+    // only grows, so an index keeps naming the same tile until Reset
+    size_t index = 0;
+    plane.ForEachTile([&](int64_t tileRow, int64_t tileCol, const SparseUniverse::Tile& tile)
+    {
+        if (index == tiles.size())
+        {
+            tiles.emplace_back(tileRow, tileCol);
+            shadow.resize(tiles.size() * SparseUniverse::kTileSize);
+        }
+        DiffRun(tile.rows, index * SparseUniverse::kTileSize, SparseUniverse::kTileSize, out);
+        ++index;
+    });
+}
+
+// Compares a run of words with the shadow, which is equal most of the time
+void Timeline::DiffRun(const uint64_t* words, size_t key, size_t count, Words& out)
+{
+    uint64_t* old = shadow.data() + key;
+    if (std::memcmp(words, old, count * sizeof(uint64_t)) == 0)
+        return;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (words[i] != old[i])
+        {
+            out.push_back(Word{ key + i, words[i] ^ old[i] });
+            old[i] = words[i];
+        }
+    }
+}
+
+void Timeline::Apply(Grid& cells, const Words& delta) const
+{
+    uint64_t* data = cells.Data();
+    for (const Word& word : delta)
+        data[word.key] ^= word.bits;
+}
+
+void Timeline::Apply(SparseUniverse& plane, const Words& delta) const
+{
+    // Consecutive words mostly share a tile, so look each tile up once
+    uint64_t tileIndex = ~uint64_t(0);
+    SparseUniverse::Tile* tile = nullptr;
+    for (const Word& word : delta)
+    {
+        const uint64_t index = word.key >> SparseUniverse::kTileShift;
+        if (index != tileIndex)
+        {
+            tileIndex = index;
+            tile = plane.GetOrCreateTile(tiles[index].first, tiles[index].second);
+        }
+        tile->rows[word.key & SparseUniverse::kTileMask] ^= word.bits;
+    }
+}
+
+// Merges two sorted word lists, leaving out words that cancel
+void Timeline::Xor(const Words& a, const Words& b, Words& out)
+{
+    out.clear();
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size())
+    {
+        if (a[i].key < b[j].key)
+            out.push_back(a[i++]);
+        else if (b[j].key < a[i].key)
+            out.push_back(b[j++]);
+        else
+        {
+            const uint64_t bits = a[i].bits ^ b[j].bits;
+            if (bits)
+                out.push_back(Word{ a[i].key, bits });
+            ++i;
+            ++j;
+        }
+    }
+    out.insert(out.end(), a.begin() + i, a.end());
+    out.insert(out.end(), b.begin() + j, b.end());
+}
@@ -0,0 +1,111 @@
+// Defines Timeline, which lets a lone Langton's ant be scrubbed back and
+// forth through its history. The ant's rule can be run backwards, so any
+// generation can be reached from any other by stepping, but seeking across
+// millions of steps that way is slow. The timeline also keeps keyframes
+// every interval generations: the ant, plus the cells as the XOR of the
+// keyframe before it, so a keyframe only costs the words that changed in
+// between. A seek steps back to the keyframe below the current generation,
+// XORs the deltas up or down to the keyframe closest to the target, and
+// steps the rest of the way in either direction.
+//
+// Keyframes are taken while the ant runs forward past interval boundaries,
+// by comparing the universe with a shadow copy of it at the keyframe before.
+// Past kMaxKeyframes, or once that comparison would cost more than a small
+// share of the steps in between, the interval doubles and every other
+// keyframe is folded into the next one. Memory and overhead thus stay
+// bounded however long the run gets.
+// Anything that edits the universe or the ants invalidates the history, and
+// the owner calls Reset to start a new one from the edited state.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Grid.h"
+#include "LangtonsAnt.h"
+#include "SparseUniverse.h"
+
+class Timeline
+{
+public:
+    static constexpr uint64_t kDefaultInterval = uint64_t(1) << 16;  // Generations between keyframes at first
+    static constexpr size_t kMaxKeyframes = 256;
+
+    explicit Timeline(uint64_t interval = kDefaultInterval);
+
+    // Forgets the history and makes the given state its first keyframe
+    void Reset(const LangtonsAnt& ant, const Grid& cells, uint64_t generation);
+    void Reset(const LangtonsAnt& ant, const SparseUniverse& plane, uint64_t generation);
+
+    // Forgets the history without starting a new one (the universe can't be rewound)
+    void Clear();
+
+    bool Empty() const { return keyframes.empty(); }
+    uint64_t Start() const { return keyframes.empty() ? 0 : keyframes.front().generation; }
+    uint64_t End() const { return end; }  // Furthest generation reached since Reset
+
+    // The generation of the next keyframe after generation; stepping forward
+    // should stop there and call Record so the keyframe gets taken
+    uint64_t NextKeyframe(uint64_t generation) const;
+
+    // Call after stepping forward to generation. Takes a keyframe when
+    // generation is on an interval boundary the timeline doesn't have yet.
+    void Record(const LangtonsAnt& ant, const Grid& cells, uint64_t generation);
+    void Record(const LangtonsAnt& ant, const SparseUniverse& plane, uint64_t generation);
+
+    // Takes the ant and universe from generation to target; both must lie
+    // between Start and End
+    void Seek(LangtonsAnt& ant, Grid& cells, uint64_t generation, uint64_t target);
+    void Seek(LangtonsAnt& ant, SparseUniverse& plane, uint64_t generation, uint64_t target);
+
+    size_t KeyframeCount() const { return keyframes.size(); }
+    size_t MemoryBytes() const;
+
+private:
+    // One changed word of cells: a word index of the grid, or a plane tile's
+    // pool index times 64 plus the row within it. Kept sorted by key.
+    struct Word
+    {
+        uint64_t key;
+        uint64_t bits;
+    };
+    using Words = std::vector<Word>;
+
+    struct Keyframe
+    {
+        uint64_t generation;
+        int64_t row, col;
+        int direction;
+        Words delta;  // Cells XOR those of the keyframe before (the first holds its cells)
+    };
+
+    // Appends the words that differ from the shadow, XOR the shadow, and updates it
+    void Diff(const Grid& cells, Words& out);
+    void Diff(const SparseUniverse& plane, Words& out);
+    void DiffRun(const uint64_t* words, size_t key, size_t count, Words& out);
+    void Apply(Grid& cells, const Words& delta) const;
+    void Apply(SparseUniverse& plane, const Words& delta) const;
+    static void Xor(const Words& a, const Words& b, Words& out);
+
+    template <typename Universe>
+    void ResetAt(const LangtonsAnt& ant, const Universe& universe, uint64_t generation);
+    template <typename Universe>
+    void RecordAt(const LangtonsAnt& ant, const Universe& universe, uint64_t generation);
+    template <typename Universe>
+    void SeekTo(LangtonsAnt& ant, Universe& universe, uint64_t generation, uint64_t target);
+    void Thin();
+
+    size_t KeyframeAtOrBefore(uint64_t generation) const;
+
+    uint64_t interval;
+    uint64_t end = 0;
+    std::vector<Keyframe> keyframes;
+    std::vector<uint64_t> shadow;  // Cell words at the newest keyframe taken, by key
+    uint64_t shadowGeneration = 0;
+    Words carry;                   // shadow XOR the newest keyframe kept (nonempty once thinning dropped it)
+    Words changed;
+    Words merged;
+    std::vector<std::pair<int64_t, int64_t>> tiles;  // Tile coordinates by pool index, in plane mode
+};
@@ -0,0 +1,125 @@
+// Implements the event tracer and its Chrome trace writer
+
+#include "Trace.h"
+#include <algorithm>
+#include <cstdio>
+
+thread_local Tracer::Ring* Tracer::threadRing = nullptr;
+thread_local const char* Tracer::threadName = nullptr;
+
+namespace
+{
+    void WriteString(std::FILE* file, const char* text)
+    {
+        std::fputc('"', file);
+        for (const char* c = text; *c; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+                std::fputc('\\', file);
+            if (static_cast<unsigned char>(*c) >= 0x20)
+                std::fputc(*c, file);
+        }
+        std::fputc('"', file);
+    }
+}
+
+Tracer::Tracer()
+    : epoch(std::chrono::steady_clock::now())
+{
+}
+
+void Tracer::Start()
+{
+    recordingStart.store(Now(), std::memory_order_relaxed);
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::Stop()
+{
+    enabled.store(false, std::memory_order_relaxed);
+}
+
+void Tracer::NameThread(const char* name)
+{
+    threadName = name;
+    if (threadRing)
+        threadRing->threadName.store(name, std::memory_order_relaxed);
+}
+
+Tracer::Ring& Tracer::ThreadRing()
+{
+    if (!threadRing)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        rings.push_back(std::make_unique<Ring>());
+        rings.back()->id = static_cast<int>(rings.size());
+        rings.back()->threadName.store(threadName, std::memory_order_relaxed);
+        threadRing = rings.back().get();
+    }
+    return *threadRing;
+}
+
+void Tracer::Record(const char* name, int64_t start, int64_t end)
+{
+    Ring& ring = ThreadRing();
+    const uint64_t at = ring.head.load(std::memory_order_relaxed);
+    ring.events[at & (kRingEvents - 1)] = Event{ name, start, end - start };
+    ring.head.store(at + 1, std::memory_order_release);
+}
+
+bool Tracer::WriteJson(const std::string& path) const
+{
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file)
+        return false;
+
+    const int64_t from = recordingStart.load(std::memory_order_relaxed);
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Event> events;
+    for (const std::unique_ptr<Ring>& ring : rings)
+    {
+        // Copy what the ring holds, then drop whatever its thread overwrote
+        // while we copied, including the slot it may be writing right now
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        const uint64_t oldest = head > kRingEvents ? head - kRingEvents : 0;
+        events.clear();
+        for (uint64_t i = oldest; i < head; ++i)
+            events.push_back(ring->events[i & (kRingEvents - 1)]);
+        const uint64_t after = ring->head.load(std::memory_order_acquire) + 1;
+        const uint64_t overwritten = after > kRingEvents + oldest ? after - kRingEvents - oldest : 0;
+
+        const char* threadName = ring->threadName.load(std::memory_order_relaxed);
+        if (threadName)
+        {
+            std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+                first ? "" : ",\n", ring->id);
+            WriteString(file, threadName);
+            std::fprintf(file, "}}");
+            first = false;
+        }
+        for (size_t i = size_t(std::min<uint64_t>(overwritten, events.size())); i < events.size(); ++i)
+        {
+            const Event& event = events[i];
+            if (event.start < from)
+                continue;
+            std::fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+            WriteString(file, event.name);
+            std::fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                ring->id, double(event.start - from) / 1000.0, double(event.duration) / 1000.0);
+            first = false;
+        }
+    }
+
+    std::fprintf(file, "\n]}\n");
+    const bool written = std::ferror(file) == 0;
+    return std::fclose(file) == 0 && written;
+}
+
+Tracer& Trace()
+{
+    static Tracer tracer;
+    return tracer;
+}
@@ -0,0 +1,108 @@
+// Defines the event tracer behind the app's timeline export. Scopes marked
+// with ANT_TRACE_SCOPE record their start and duration into a ring buffer
+// owned by the recording thread. A ring is allocated the first time its
+// thread records, and after that a scope costs two clock reads and a store.
+// When tracing is off, a scope is a single relaxed load. WriteJson turns
+// what the rings still hold into a Chrome trace file, which chrome://tracing
+// and ui.perfetto.dev open as one timeline row per thread. It can be called
+// while recording.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Tracer
+{
+public:
+    static constexpr size_t kRingEvents = size_t(1) << 15;  // Newest events kept per thread (power of two)
+
+    Tracer();
+
+    // Starts a new recording; events from before it are left out of the file
+    void Start();
+    void Stop();
+    bool Enabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // Names the calling thread's row in the timeline; name must outlive the
+    // tracer. Allocates nothing until the thread records.
+    void NameThread(const char* name);
+
+    // Nanoseconds since the tracer was created
+    int64_t Now() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    // Records a finished scope on the calling thread's ring; name must be a
+    // string literal (or otherwise outlive the tracer)
+    void Record(const char* name, int64_t start, int64_t end);
+
+    // Writes the current recording as Chrome trace JSON; false if the file can't be written
+    bool WriteJson(const std::string& path) const;
+
+private:
+    struct Event
+    {
+        const char* name;
+        int64_t start;
+        int64_t duration;
+    };
+
+    // Written only by its thread; head counts every event ever recorded
+    struct Ring
+    {
+        std::array<Event, kRingEvents> events;
+        std::atomic<uint64_t> head{ 0 };
+        std::atomic<const char*> threadName{ nullptr };
+        int id = 0;
+    };
+
+    Ring& ThreadRing();
+    static thread_local Ring* threadRing;  // The calling thread's, once it has recorded
+    static thread_local const char* threadName;  // Set by NameThread before then
+
+    const std::chrono::steady_clock::time_point epoch;
+    std::atomic<bool> enabled{ false };
+    std::atomic<int64_t> recordingStart{ 0 };
+
+    mutable std::mutex mutex;                  // Guards rings (not their contents)
+    std::vector<std::unique_ptr<Ring>> rings;  // Kept until exit so finished threads still show
+};
+
+// The process-wide tracer
+Tracer& Trace();
+
+// Records the time from construction to the end of the scope, if tracing was on at the start
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name)
+        : name(Trace().Enabled() ? name : nullptr), start(this->name ? Trace().Now() : 0)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (name)
+            Trace().Record(name, start, Trace().Now());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    int64_t start;
+};
+
+#define ANT_TRACE_CONCAT_(a, b) a##b
+#define ANT_TRACE_CONCAT(a, b) ANT_TRACE_CONCAT_(a, b)
+#define ANT_TRACE_SCOPE(name) const TraceScope ANT_TRACE_CONCAT(traceScope, __LINE__)(name)
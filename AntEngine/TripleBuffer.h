@@ -0,0 +1,49 @@
+// Defines TripleBuffer, a lock-free single-producer/single-consumer handoff.
+// The producer fills Back() and publishes it; the consumer picks up the
+// newest published value with Consume() and reads it through Front().
+// Neither side ever waits on the other.
+
+#pragma once
+
+#include <atomic>
+
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Producer side: the buffer to fill before calling Publish
+    T& Back() { return buffers[back]; }
+
+    // Producer side: hands the back buffer over and takes the spare one
+    void Publish()
+    {
+        back = middle.exchange(back | kFresh, std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    // Producer side: true while the last published value has not been consumed
+    bool Pending() const
+    {
+        return (middle.load(std::memory_order_acquire) & kFresh) != 0;
+    }
+
+    // Consumer side: swaps in the newest published value, if there is one
+    bool Consume()
+    {
+        if (!(middle.load(std::memory_order_acquire) & kFresh))
+            return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & kIndexMask;
+        return true;
+    }
+
+    // Consumer side: the value taken by the last successful Consume
+    const T& Front() const { return buffers[front]; }
+
+private:
+    static constexpr int kIndexMask = 3;
+    static constexpr int kFresh = 4;  // Set in middle when it holds an unconsumed value
+
+    T buffers[3];
+    int back = 0;                 // Owned by the producer
+    int front = 2;                // Owned by the consumer
+    std::atomic<int> middle{ 1 }; // Shared: index of the spare buffer plus the fresh flag
+};
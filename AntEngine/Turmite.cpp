@@ -0,0 +1,184 @@
+// Implements the turmite step loops and the table of compiled-in rules
+
+#include "Turmite.h"
+#include "LangtonsAnt.h"
+
+// The well-known rules, parsed at compile time
+#define TURMITE_RULE(name, text) \
+    constexpr TurmiteParseResult name##Parsed = ParseTurmiteRule(text, sizeof(text) - 1); \
+    static_assert(name##Parsed.ok, "Malformed built-in rule: " text); \
+    constexpr TurmiteRule name = name##Parsed.rule;
+
+TURMITE_RULE(kRuleRL, "RL")
+TURMITE_RULE(kRuleRLR, "RLR")
+TURMITE_RULE(kRuleLLRR, "LLRR")
+TURMITE_RULE(kRuleLRRRRRLLR, "LRRRRRLLR")
+TURMITE_RULE(kRuleLLRRRLRLRLLR, "LLRRRLRLRLLR")
+TURMITE_RULE(kRuleRRLLLRLLLRRR, "RRLLLRLLLRRR")
+TURMITE_RULE(kRuleFibonacci, "{{{1,8,1},{1,8,1}},{{1,2,1},{0,1,0}}}")  // Fibonacci spiral
+
+#undef TURMITE_RULE
+
+namespace
+{
+    // A transition packed into one 16-bit entry: write in bits 0-7, turn in
+    // bits 8-9, next state in bits 10-13
+    constexpr uint16_t Pack(const TurmiteTransition& t)
+    {
+        return uint16_t(t.write | (t.turn << 8) | (t.next << 10));
+    }
+
+    // Table for a rule known at compile time. The sizes are constants, and
+    // one-state rules never read or write the state at all.
+    template <const TurmiteRule& Rule>
+    struct FixedTable
+    {
+        static constexpr int kColors = Rule.colors;
+        static constexpr bool kSingleState = Rule.states == 1;
+
+        struct Entries
+        {
+            uint16_t packed[kMaxTurmiteStates * kMaxTurmiteColors] = {};
+
+            constexpr Entries()
+            {
+                for (int s = 0; s < Rule.states; ++s)
+                    for (int c = 0; c < Rule.colors; ++c)
+                        packed[s * kColors + c] = Pack(Rule.table[s][c]);
+            }
+        };
+        static constexpr Entries kEntries{};
+
+        explicit FixedTable(const TurmiteRule&) {}
+        uint16_t At(int state, int color) const { return kEntries.packed[state * kColors + color]; }
+    };
+
+    // Table for any other rule, flattened on entry
+    struct RuntimeTable
+    {
+        static constexpr bool kSingleState = false;
+
+        uint16_t packed[kMaxTurmiteStates * kMaxTurmiteColors] = {};
+
+        explicit RuntimeTable(const TurmiteRule& rule)
+        {
+            for (int s = 0; s < rule.states; ++s)
+                for (int c = 0; c < rule.colors; ++c)
+                    packed[s * kMaxTurmiteColors + c] = Pack(rule.table[s][c]);
+        }
+        uint16_t At(int state, int color) const { return packed[state * kMaxTurmiteColors + color]; }
+    };
+
+    // The step loop shared by every kernel; the position lives in locals
+    // and the edges wrap without modulo, like LangtonsAnt::RunGrid
+    template <typename Table>
+    void Run(const TurmiteRule& rule, ByteGrid& grid, Turmite::Position& position, uint64_t n)
+    {
+        const Table table(rule);
+        const int rows = grid.Rows();
+        const int cols = grid.Cols();
+        uint8_t* cells = grid.Data();
+        const size_t stride = grid.StrideWords();
+        int r = static_cast<int>(position.row);
+        int c = static_cast<int>(position.col);
+        int d = position.dir;
+        int state = position.state;
+
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            uint8_t& cell = cells[size_t(r) * stride + c];
+            const uint16_t t = table.At(Table::kSingleState ? 0 : state, cell);
+            cell = uint8_t(t);
+            d = (d + (t >> 8)) & 3;
+            if (!Table::kSingleState)
+                state = t >> 10;
+
+            r += kRowDelta[d];
+            c += kColDelta[d];
+            r += rows & -(r < 0);
+            r -= rows & -(r >= rows);
+            c += cols & -(c < 0);
+            c -= cols & -(c >= cols);
+        }
+
+        position.row = r;
+        position.col = c;
+        position.dir = d;
+        position.state = state;
+    }
+
+    struct CompiledRule
+    {
+        const TurmiteRule* rule;
+        Turmite::Kernel kernel;
+    };
+
+    const CompiledRule kCompiledRules[] = {
+        { &kRuleRL, &Run<FixedTable<kRuleRL>> },
+        { &kRuleRLR, &Run<FixedTable<kRuleRLR>> },
+        { &kRuleLLRR, &Run<FixedTable<kRuleLLRR>> },
+        { &kRuleLRRRRRLLR, &Run<FixedTable<kRuleLRRRRRLLR>> },
+        { &kRuleLLRRRLRLRLLR, &Run<FixedTable<kRuleLLRRRLRLRLLR>> },
+        { &kRuleRRLLLRLLLRRR, &Run<FixedTable<kRuleRRLLLRLLLRRR>> },
+        { &kRuleFibonacci, &Run<FixedTable<kRuleFibonacci>> },
+    };
+}
+
+std::string TurmiteRule::ToString() const
+{
+    // Turn string when the rule is a single state that cycles the colors
+    bool relative = states == 1;
+    for (int c = 0; relative && c < colors; ++c)
+        relative = table[0][c].write == (c + 1) % colors && table[0][c].next == 0;
+
+    if (relative)
+    {
+        static const char kLetters[4] = { 'N', 'R', 'U', 'L' };
+        std::string text;
+        for (int c = 0; c < colors; ++c)
+            text += kLetters[table[0][c].turn & 3];
+        return text;
+    }
+
+    static const int kTurnCodes[4] = { 1, 2, 4, 8 };
+    std::string text = "{";
+    for (int s = 0; s < states; ++s)
+    {
+        text += s ? ",{" : "{";
+        for (int c = 0; c < colors; ++c)
+        {
+            const TurmiteTransition& t = table[s][c];
+            text += c ? ",{" : "{";
+            text += std::to_string(t.write) + "," + std::to_string(kTurnCodes[t.turn & 3]) + "," + std::to_string(t.next) + "}";
+        }
+        text += "}";
+    }
+    return text + "}";
+}
+
+Turmite::Turmite(const TurmiteRule& rule, int64_t startRow, int64_t startCol, bool specialize)
+    : rule(rule),
+    position{ startRow, startCol, 0, 0 },
+    kernel(&Run<RuntimeTable>),
+    specialized(false)
+{
+    if (!specialize)
+        return;
+
+    for (const CompiledRule& compiled : kCompiledRules)
+    {
+        if (*compiled.rule == rule)
+        {
+            kernel = compiled.kernel;
+            specialized = true;
+            break;
+        }
+    }
+}
+
+void Turmite::StepMany(ByteGrid& grid, uint64_t n)
+{
+    if (grid.Rows() == 0 || grid.Cols() == 0)
+        return;
+    kernel(rule, grid, position, n);
+}
@@ -0,0 +1,300 @@
+// Defines Turmite, the generalization of Langton's ant to more colors and to
+// internal states. A rule gives, for every (state, cell color) pair, the color
+// to write, how to turn and the next state. Cells are uint8_t color indices.
+//
+// Rules are written either as a turn string ("RL" is Langton's ant; "LLRR",
+// "RLR", ... one letter per color) or as a state table in the
+// {{{write, turn, next}, ...}, ...} notation. The parser is constexpr, so the
+// well-known rules are parsed at compile time and get their own step loop
+// (see Turmite.cpp); any other rule runs a generic table-driven loop.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Grid.h"
+
+constexpr int kMaxTurmiteStates = 16;
+constexpr int kMaxTurmiteColors = 16;
+
+// Turns in quarter turns clockwise, so a direction update is (dir + turn) & 3
+enum TurmiteTurn : uint8_t
+{
+    kNoTurn = 0,
+    kTurnRight = 1,
+    kUTurn = 2,
+    kTurnLeft = 3
+};
+
+struct TurmiteTransition
+{
+    uint8_t write = 0;  // Color left in the cell
+    uint8_t turn = 0;   // TurmiteTurn
+    uint8_t next = 0;   // State after the step
+};
+
+struct TurmiteRule
+{
+    int states = 1;
+    int colors = 2;
+
+    // table[state][color]; defaults to Langton's ant (RL)
+    TurmiteTransition table[kMaxTurmiteStates][kMaxTurmiteColors] = {
+        { { 1, kTurnRight, 0 }, { 0, kTurnLeft, 0 } }
+    };
+
+    constexpr bool operator==(const TurmiteRule& other) const
+    {
+        if (states != other.states || colors != other.colors)
+            return false;
+        for (int s = 0; s < states; ++s)
+        {
+            for (int c = 0; c < colors; ++c)
+            {
+                const TurmiteTransition& a = table[s][c];
+                const TurmiteTransition& b = other.table[s][c];
+                if (a.write != b.write || a.turn != b.turn || a.next != b.next)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr bool operator!=(const TurmiteRule& other) const { return !(*this == other); }
+
+    // True for the plain two-color RL rule that LangtonsAnt runs on bit-packed cells
+    constexpr bool IsLangtonsAnt() const { return *this == TurmiteRule(); }
+
+    // Shortest text that parses back to this rule
+    std::string ToString() const;
+};
+
+struct TurmiteParseResult
+{
+    bool ok = false;
+    TurmiteRule rule;
+};
+
+namespace TurmiteParsing
+{
+    constexpr bool IsSpace(char ch)
+    {
+        return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+    }
+
+    // One state; color i turns by letter i and becomes color i + 1 (wrapping)
+    constexpr TurmiteParseResult ParseTurns(const char* text, size_t length)
+    {
+        TurmiteParseResult result;
+        uint8_t turns[kMaxTurmiteColors] = {};
+        int colors = 0;
+
+        for (size_t i = 0; i < length; ++i)
+        {
+            uint8_t turn = kNoTurn;
+            switch (text[i])
+            {
+            case 'L': case 'l': turn = kTurnLeft; break;
+            case 'R': case 'r': turn = kTurnRight; break;
+            case 'N': case 'n': turn = kNoTurn; break;
+            case 'U': case 'u': turn = kUTurn; break;
+            default:
+                if (IsSpace(text[i]))
+                    continue;
+                return result;
+            }
+            if (colors == kMaxTurmiteColors)
+                return result;
+            turns[colors++] = turn;
+        }
+        if (colors < 2)
+            return result;
+
+        result.rule.states = 1;
+        result.rule.colors = colors;
+        for (int c = 0; c < kMaxTurmiteColors; ++c)
+            result.rule.table[0][c] = TurmiteTransition();
+        for (int c = 0; c < colors; ++c)
+            result.rule.table[0][c] = TurmiteTransition{ uint8_t((c + 1) % colors), turns[c], 0 };
+        result.ok = true;
+        return result;
+    }
+
+    // Turn codes of the state table notation: 1 = none, 2 = right, 4 = U-turn, 8 = left
+    constexpr int TurnFromCode(int code)
+    {
+        return code == 1 ? kNoTurn : code == 2 ? kTurnRight : code == 4 ? kUTurn : code == 8 ? kTurnLeft : -1;
+    }
+
+    // {{{write, turn, next}, ... one per color}, ... one per state}
+    constexpr TurmiteParseResult ParseTable(const char* text, size_t length)
+    {
+        TurmiteParseResult result;
+        TurmiteRule rule;
+        for (int s = 0; s < kMaxTurmiteStates; ++s)
+            for (int c = 0; c < kMaxTurmiteColors; ++c)
+                rule.table[s][c] = TurmiteTransition();
+
+        int depth = 0;
+        int state = -1;
+        int color = -1;
+        int colors = -1;      // Colors per state, which must be the same for every state
+        int fields[3] = {};
+        int field = 0;
+        int value = -1;       // Number being read, or -1 between numbers
+        bool closed = false;  // The outermost brace has been closed
+
+        for (size_t i = 0; i < length; ++i)
+        {
+            const char ch = text[i];
+            if (IsSpace(ch))
+                continue;
+            if (closed)
+                return result;
+
+            if (ch == '{')
+            {
+                if (++depth == 2)
+                {
+                    if (++state == kMaxTurmiteStates)
+                        return result;
+                    color = -1;
+                }
+                else if (depth == 3)
+                {
+                    if (++color == kMaxTurmiteColors)
+                        return result;
+                    field = 0;
+                    value = -1;
+                }
+                else if (depth > 3)
+                {
+                    return result;
+                }
+            }
+            else if (ch >= '0' && ch <= '9')
+            {
+                if (depth != 3)
+                    return result;
+                value = (value < 0 ? 0 : value * 10) + (ch - '0');
+                if (value > 255)
+                    return result;
+            }
+            else if (ch == ',')
+            {
+                if (depth == 3)
+                {
+                    if (value < 0 || field == 2)
+                        return result;
+                    fields[field++] = value;
+                    value = -1;
+                }
+            }
+            else if (ch == '}')
+            {
+                if (depth == 3)
+                {
+                    if (value < 0 || field != 2)
+                        return result;
+                    fields[2] = value;
+                    const int turn = TurnFromCode(fields[1]);
+                    if (turn < 0)
+                        return result;
+                    rule.table[state][color] = TurmiteTransition{ uint8_t(fields[0]), uint8_t(turn), uint8_t(fields[2]) };
+                }
+                else if (depth == 2)
+                {
+                    if (colors < 0)
+                        colors = color + 1;
+                    else if (colors != color + 1)
+                        return result;
+                }
+                else if (depth == 1)
+                {
+                    closed = true;
+                }
+                else
+                {
+                    return result;
+                }
+                --depth;
+            }
+            else
+            {
+                return result;
+            }
+        }
+
+        if (!closed || state < 0 || colors < 2)
+            return result;
+
+        rule.states = state + 1;
+        rule.colors = colors;
+        for (int s = 0; s < rule.states; ++s)
+            for (int c = 0; c < rule.colors; ++c)
+                if (rule.table[s][c].write >= rule.colors || rule.table[s][c].next >= rule.states)
+                    return result;
+
+        result.rule = rule;
+        result.ok = true;
+        return result;
+    }
+}
+
+// Parses either notation; usable in constant expressions
+constexpr TurmiteParseResult ParseTurmiteRule(const char* text, size_t length)
+{
+    size_t first = 0;
+    while (first < length && TurmiteParsing::IsSpace(text[first]))
+        ++first;
+    if (first < length && text[first] == '{')
+        return TurmiteParsing::ParseTable(text + first, length - first);
+    return TurmiteParsing::ParseTurns(text, length);
+}
+
+inline bool ParseTurmiteRule(const std::string& text, TurmiteRule& rule)
+{
+    const TurmiteParseResult result = ParseTurmiteRule(text.data(), text.size());
+    if (result.ok)
+        rule = result.rule;
+    return result.ok;
+}
+
+class Turmite
+{
+public:
+    // specialize = false always uses the generic loop (for comparing the two)
+    Turmite(const TurmiteRule& rule, int64_t startRow, int64_t startCol, bool specialize = true);
+
+    // Runs n steps on a wrapping grid of colors. Every cell must hold a color
+    // below the rule's color count.
+    void StepMany(ByteGrid& grid, uint64_t n);
+
+    int64_t GetRow() const { return position.row; }
+    int64_t GetCol() const { return position.col; }
+    int GetDirection() const { return position.dir; }  // 0 = up, 1 = right, 2 = down, 3 = left
+    int GetState() const { return position.state; }
+    const TurmiteRule& GetRule() const { return rule; }
+
+    // True when the rule matched one of the compiled-in kernels
+    bool IsSpecialized() const { return specialized; }
+
+    struct Position
+    {
+        int64_t row, col;
+        int dir;
+        int state;
+    };
+
+    using Kernel = void (*)(const TurmiteRule& rule, ByteGrid& grid, Position& position, uint64_t n);
+
+    const Position& GetPosition() const { return position; }
+    void SetPosition(const Position& newPosition) { position = newPosition; }
+
+private:
+    TurmiteRule rule;
+    Position position;
+    Kernel kernel;
+    bool specialized;
+};
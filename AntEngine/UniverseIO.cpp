@@ -0,0 +1,991 @@
+// Implements the pattern and universe file formats
+
+#include "UniverseIO.h"
+#include "PerfCounters.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#if defined _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const char kMagic[4] = { 'A', 'N', 'T', 'U' };
+    const uint16_t kVersion = 1;
+    const uint16_t kFlagPlane = 1;    // UniverseInfo::infinitePlane
+    const uint16_t kFlagColors = 2;   // One byte per cell instead of one bit
+    const uint16_t kFlagTiles = 4;    // A plane stored as tiles instead of rows
+
+    const size_t kTileBytes = sizeof(SparseUniverse::Tile);
+    const size_t kTileKeyBytes = 16;  // Tile row and column before each tile's rows
+
+    const size_t kChunkBytes = size_t(1) << 20;   // Raw row bytes per chunk, roughly
+    const size_t kFlushBytes = size_t(4) << 20;   // The writer hands the stream blocks this large
+
+    // Run-length code: a control byte c < 128 is followed by c + 1 literal
+    // bytes; c >= 128 is followed by one byte repeated c - 128 + kMinRun times
+    const size_t kMinRun = 3;
+    const size_t kMaxRun = 127 + kMinRun;
+    const size_t kMaxLiteral = 128;
+
+    void Put(std::vector<uint8_t>& out, uint64_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; ++i)
+            out.push_back(uint8_t(value >> (8 * i)));
+    }
+
+    void PutLiterals(const uint8_t* bytes, size_t n, std::vector<uint8_t>& out)
+    {
+        while (n > 0)
+        {
+            const size_t count = std::min(n, kMaxLiteral);
+            out.push_back(uint8_t(count - 1));
+            out.insert(out.end(), bytes, bytes + count);
+            bytes += count;
+            n -= count;
+        }
+    }
+
+    void EncodeRow(const uint8_t* row, size_t n, std::vector<uint8_t>& out)
+    {
+        size_t literal = 0;  // Start of the bytes not written yet
+        size_t i = 0;
+        while (i < n)
+        {
+            size_t run = 1;
+            while (i + run < n && run < kMaxRun && row[i + run] == row[i])
+                ++run;
+            if (run >= kMinRun)
+            {
+                PutLiterals(row + literal, i - literal, out);
+                out.push_back(uint8_t(128 + run - kMinRun));
+                out.push_back(row[i]);
+                literal = i + run;
+            }
+            i += run;
+        }
+        PutLiterals(row + literal, n - literal, out);
+    }
+
+    bool DecodeRow(const uint8_t*& in, const uint8_t* end, uint8_t* row, size_t n)
+    {
+        size_t i = 0;
+        while (i < n)
+        {
+            if (in == end)
+                return false;
+            const uint8_t control = *in++;
+            if (control < 128)
+            {
+                const size_t count = size_t(control) + 1;
+                if (count > n - i || count > size_t(end - in))
+                    return false;
+                std::memcpy(row + i, in, count);
+                in += count;
+                i += count;
+            }
+            else
+            {
+                const size_t count = size_t(control) - 128 + kMinRun;
+                if (count > n - i || in == end)
+                    return false;
+                std::memset(row + i, *in++, count);
+                i += count;
+            }
+        }
+        return true;
+    }
+
+    // Checksum of the row bytes as stored (before run-length coding)
+    uint64_t HashRow(uint64_t hash, const uint8_t* row, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, row + i, 8);
+            hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+            hash ^= hash >> 32;
+        }
+        uint64_t tail = 0;
+        for (size_t shift = 0; i < n; ++i, shift += 8)
+            tail |= uint64_t(row[i]) << shift;
+        hash = (hash ^ tail ^ n) * 0x9E3779B97F4A7C15ull;
+        return hash ^ (hash >> 32);
+    }
+
+    // Bytes a row takes in the file. Bit rows are the grid's words as bytes,
+    // which matches the file order on little-endian machines.
+    size_t RowBytes(const Grid& grid) { return (size_t(grid.Cols()) + 7) / 8; }
+    size_t RowBytes(const ByteGrid& grid) { return size_t(grid.Cols()); }
+
+    // Everything before the chunks
+    void PutHeader(std::vector<uint8_t>& out, uint16_t flags, int rows, int cols, uint64_t checksum,
+        const AntColony& ants, const UniverseInfo& info)
+    {
+        out.insert(out.end(), kMagic, kMagic + 4);
+        Put(out, kVersion, 2);
+        Put(out, flags, 2);
+        Put(out, uint32_t(rows), 4);
+        Put(out, uint32_t(cols), 4);
+        Put(out, info.generation, 8);
+        Put(out, uint64_t(info.originRow), 8);
+        Put(out, uint64_t(info.originCol), 8);
+        Put(out, checksum, 8);
+
+        const std::string rule = info.rule.ToString();
+        Put(out, rule.size(), 2);
+        out.insert(out.end(), rule.begin(), rule.end());
+
+        Put(out, ants.Size(), 4);
+        for (size_t i = 0; i < ants.Size(); ++i)
+        {
+            Put(out, uint64_t(ants.GetRow(i)), 8);
+            Put(out, uint64_t(ants.GetCol(i)), 8);
+            Put(out, uint8_t(ants.GetDirection(i)), 1);
+            Put(out, uint8_t(ants.GetState(i)), 1);
+        }
+    }
+
+    // Fills in the encoded size of the chunk whose size field is at sizeAt,
+    // and hands the stream what has piled up once it's a block
+    void EndChunk(std::vector<uint8_t>& out, size_t sizeAt, std::ofstream& file)
+    {
+        const uint64_t encoded = out.size() - sizeAt - 4;
+        for (int i = 0; i < 4; ++i)
+            out[sizeAt + i] = uint8_t(encoded >> (8 * i));
+
+        if (out.size() >= kFlushBytes)
+        {
+            file.write(reinterpret_cast<const char*>(out.data()), out.size());
+            out.clear();
+        }
+    }
+
+    template <typename Cells>
+    bool WriteCells(const std::string& path, const Cells& cells, uint16_t flags, const AntColony& ants, const UniverseInfo& info)
+    {
+        const int rows = cells.Rows();
+        const size_t rowBytes = RowBytes(cells);
+        if (rows > kMaxUniverseSide || cells.Cols() > kMaxUniverseSide)
+            return false;
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        uint64_t checksum = 0;
+        for (int r = 0; r < rows; ++r)
+            checksum = HashRow(checksum, reinterpret_cast<const uint8_t*>(cells.Row(r)), rowBytes);
+
+        std::vector<uint8_t> out;
+        out.reserve(kFlushBytes + kChunkBytes + kChunkBytes / 64 + 64);
+        PutHeader(out, flags, rows, cells.Cols(), checksum, ants, info);
+
+        // Chunks: row count, encoded size, then the rows
+        const int chunkRows = static_cast<int>(std::max<size_t>(1, kChunkBytes / std::max<size_t>(rowBytes, 1)));
+        for (int r0 = 0; r0 < rows; r0 += chunkRows)
+        {
+            const int count = std::min(chunkRows, rows - r0);
+            Put(out, uint32_t(count), 4);
+            const size_t sizeAt = out.size();
+            Put(out, 0, 4);
+            for (int r = r0; r < r0 + count; ++r)
+                EncodeRow(reinterpret_cast<const uint8_t*>(cells.Row(r)), rowBytes, out);
+            EndChunk(out, sizeAt, file);
+        }
+        file.write(reinterpret_cast<const char*>(out.data()), out.size());
+        return file.good();
+    }
+
+    bool HasLife(const SparseUniverse::Tile& tile)
+    {
+        uint64_t any = 0;
+        for (uint64_t bits : tile.rows)
+            any |= bits;
+        return any != 0;
+    }
+
+    // Checksum of a tile as stored: its coordinates, then its rows
+    uint64_t HashTile(uint64_t hash, int64_t tileRow, int64_t tileCol, const SparseUniverse::Tile& tile)
+    {
+        uint8_t key[kTileKeyBytes];
+        for (int i = 0; i < 8; ++i)
+        {
+            key[i] = uint8_t(uint64_t(tileRow) >> (8 * i));
+            key[8 + i] = uint8_t(uint64_t(tileCol) >> (8 * i));
+        }
+        hash = HashRow(hash, key, kTileKeyBytes);
+        return HashRow(hash, reinterpret_cast<const uint8_t*>(tile.rows), kTileBytes);
+    }
+
+    // The plane's living tiles; dead ones are left out, as a missing tile reads as dead
+    bool WriteTiles(const std::string& path, const SparseUniverse& plane, const AntColony& ants, const UniverseInfo& info)
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        uint64_t checksum = 0;
+        uint64_t tiles = 0;
+        plane.ForEachTile([&](int64_t tileRow, int64_t tileCol, const SparseUniverse::Tile& tile)
+        {
+            if (!HasLife(tile))
+                return;
+            checksum = HashTile(checksum, tileRow, tileCol, tile);
+            ++tiles;
+        });
+
+        std::vector<uint8_t> out;
+        out.reserve(kFlushBytes + kChunkBytes + kChunkBytes / 64 + 64);
+        UniverseInfo origin = info;
+        origin.originRow = 0;
+        origin.originCol = 0;
+        PutHeader(out, uint16_t(kFlagPlane | kFlagTiles), 0, 0, checksum, ants, origin);
+        Put(out, tiles, 8);
+
+        // Chunks: tile count, encoded size, then each tile's coordinates and rows
+        const uint32_t chunkTiles = uint32_t(kChunkBytes / (kTileKeyBytes + kTileBytes));
+        uint32_t count = 0;
+        size_t sizeAt = 0;
+        plane.ForEachTile([&](int64_t tileRow, int64_t tileCol, const SparseUniverse::Tile& tile)
+        {
+            if (!HasLife(tile))
+                return;
+            if (count == 0)
+            {
+                Put(out, std::min<uint64_t>(chunkTiles, tiles), 4);
+                sizeAt = out.size();
+                Put(out, 0, 4);
+            }
+            Put(out, uint64_t(tileRow), 8);
+            Put(out, uint64_t(tileCol), 8);
+            EncodeRow(reinterpret_cast<const uint8_t*>(tile.rows), kTileBytes, out);
+            --tiles;
+            if (++count == chunkTiles || tiles == 0)
+            {
+                EndChunk(out, sizeAt, file);
+                count = 0;
+            }
+        });
+        file.write(reinterpret_cast<const char*>(out.data()), out.size());
+        return file.good();
+    }
+
+    // A read-only view of a whole file, mapped so the decoder reads the page cache directly
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::string& path)
+        {
+#if defined _WIN32
+            HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+                return;
+            LARGE_INTEGER length;
+            if (GetFileSizeEx(file, &length) && length.QuadPart > 0)
+            {
+                HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (mapping)
+                {
+                    view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                    if (view)
+                        size = static_cast<size_t>(length.QuadPart);
+                    CloseHandle(mapping);  // The view keeps the mapping alive
+                }
+            }
+            CloseHandle(file);
+#else
+            const int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return;
+            struct stat info;
+            if (fstat(fd, &info) == 0 && info.st_size > 0)
+            {
+                void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED)
+                {
+                    view = mapped;
+                    size = static_cast<size_t>(info.st_size);
+                    madvise(view, size, MADV_SEQUENTIAL);
+                }
+            }
+            close(fd);  // The mapping keeps the file open
+#endif
+        }
+
+        ~MappedFile()
+        {
+            if (!view)
+                return;
+#if defined _WIN32
+            UnmapViewOfFile(view);
+#else
+            munmap(view, size);
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const uint8_t* Data() const { return static_cast<const uint8_t*>(view); }
+        size_t Size() const { return size; }
+
+    private:
+        void* view = nullptr;
+        size_t size = 0;
+    };
+
+    // Bounds-checked little-endian reads; ok turns false on the first read past the end
+    struct Cursor
+    {
+        const uint8_t* at;
+        const uint8_t* end;
+        bool ok = true;
+
+        uint64_t Take(int bytes)
+        {
+            if (end - at < bytes)
+            {
+                ok = false;
+                return 0;
+            }
+            uint64_t value = 0;
+            for (int i = 0; i < bytes; ++i)
+                value |= uint64_t(at[i]) << (8 * i);
+            at += bytes;
+            return value;
+        }
+    };
+
+    template <typename Cells>
+    bool ReadChunks(Cursor& in, Cells& cells, uint64_t checksum)
+    {
+        const size_t rowBytes = RowBytes(cells);
+        const int rows = cells.Rows();
+        const int spare = static_cast<int>(rowBytes * 8) - cells.Cols();  // Padding bits of a bit row
+        uint64_t hash = 0;
+        for (int r = 0; r < rows;)
+        {
+            const uint64_t count = in.Take(4);
+            const uint64_t encoded = in.Take(4);
+            if (!in.ok || count == 0 || count > uint64_t(rows - r) || encoded > uint64_t(in.end - in.at))
+                return false;
+
+            const uint8_t* chunk = in.at;
+            const uint8_t* chunkEnd = in.at + encoded;
+            for (uint64_t i = 0; i < count; ++i, ++r)
+            {
+                uint8_t* row = reinterpret_cast<uint8_t*>(cells.Row(r));
+                if (!DecodeRow(chunk, chunkEnd, row, rowBytes))
+                    return false;
+                if (sizeof(typename Cells::Word) > 1 && spare > 0)
+                    row[rowBytes - 1] &= uint8_t(0xFF >> spare);
+                hash = HashRow(hash, row, rowBytes);
+            }
+            if (chunk != chunkEnd)
+                return false;
+            in.at = chunkEnd;
+        }
+        return hash == checksum;
+    }
+
+    // Decodes each tile straight into a new tile of the plane
+    bool ReadTiles(Cursor& in, uint64_t tiles, SparseUniverse& plane, uint64_t checksum)
+    {
+        uint64_t hash = 0;
+        while (tiles > 0)
+        {
+            const uint64_t count = in.Take(4);
+            const uint64_t encoded = in.Take(4);
+            if (!in.ok || count == 0 || count > tiles || encoded > uint64_t(in.end - in.at))
+                return false;
+
+            Cursor chunk{ in.at, in.at + encoded };
+            for (uint64_t i = 0; i < count; ++i)
+            {
+                const int64_t tileRow = int64_t(chunk.Take(8));
+                const int64_t tileCol = int64_t(chunk.Take(8));
+                if (!chunk.ok || tileRow != int32_t(tileRow) || tileCol != int32_t(tileCol)
+                    || plane.FindTile(tileRow, tileCol))
+                    return false;  // Off the plane's tile range, or a tile stored twice
+                SparseUniverse::Tile& tile = *plane.GetOrCreateTile(tileRow, tileCol);
+                if (!DecodeRow(chunk.at, chunk.end, reinterpret_cast<uint8_t*>(tile.rows), kTileBytes))
+                    return false;
+                hash = HashTile(hash, tileRow, tileCol, tile);
+            }
+            if (chunk.at != chunk.end)
+                return false;
+            in.at = chunk.end;
+            tiles -= count;
+        }
+        return hash == checksum;
+    }
+
+    bool ReadCurrent(Cursor in, UniverseState& state)
+    {
+        const uint64_t version = in.Take(2);
+        const uint64_t flags = in.Take(2);
+        const uint64_t rows = in.Take(4);
+        const uint64_t cols = in.Take(4);
+        UniverseInfo info;
+        info.generation = in.Take(8);
+        info.originRow = int64_t(in.Take(8));
+        info.originCol = int64_t(in.Take(8));
+        info.infinitePlane = (flags & kFlagPlane) != 0;
+        const uint64_t checksum = in.Take(8);
+        if (!in.ok || version != kVersion || rows > uint64_t(kMaxUniverseSide) || cols > uint64_t(kMaxUniverseSide))
+            return false;
+
+        const uint64_t ruleLength = in.Take(2);
+        if (!in.ok || ruleLength > uint64_t(in.end - in.at))
+            return false;
+        const std::string ruleText(reinterpret_cast<const char*>(in.at), ruleLength);
+        in.at += ruleLength;
+        if (!ParseTurmiteRule(ruleText, info.rule))
+            return false;
+
+        AntColony ants;
+        const uint64_t antCount = in.Take(4);
+        if (!in.ok || antCount > uint64_t(in.end - in.at) / 18)
+            return false;
+        for (uint64_t i = 0; i < antCount; ++i)
+        {
+            const int64_t row = int64_t(in.Take(8));
+            const int64_t col = int64_t(in.Take(8));
+            const int direction = static_cast<int>(in.Take(1));
+            const int antState = static_cast<int>(in.Take(1));
+            if (direction > 3 || antState >= info.rule.states)
+                return false;
+            ants.Add(row, col, direction, antState);
+        }
+
+        // Rows are decoded into the final buffers, which replace the state only on success
+        Grid cells;
+        ByteGrid colors;
+        SparseUniverse plane;
+        if (flags & kFlagTiles)
+        {
+            const uint64_t tiles = in.Take(8);
+            if (!in.ok || !(flags & kFlagPlane) || (flags & kFlagColors) || rows != 0 || cols != 0
+                || tiles == 0 || tiles > uint64_t(in.end - in.at) / kTileKeyBytes)
+                return false;
+            if (!ReadTiles(in, tiles, plane, checksum))
+                return false;
+        }
+        else if (flags & kFlagColors)
+        {
+            colors = ByteGrid(static_cast<int>(rows), static_cast<int>(cols));
+            if (!ReadChunks(in, colors, checksum))
+                return false;
+        }
+        else
+        {
+            cells = Grid(static_cast<int>(rows), static_cast<int>(cols));
+            if (!ReadChunks(in, cells, checksum))
+                return false;
+        }
+
+        state.cells = std::move(cells);
+        state.colors = std::move(colors);
+        state.plane = std::move(plane);
+        state.ants = std::move(ants);
+        state.info = info;
+        return true;
+    }
+
+    // The old format: the size as an int, then one byte per cell. A file
+    // with any byte above 1 holds turmite colors.
+    bool ReadLegacy(Cursor in, UniverseState& state)
+    {
+        const int32_t n = int32_t(uint32_t(in.Take(4)));
+        if (!in.ok || n <= 0 || n > kMaxUniverseSide || uint64_t(in.end - in.at) < uint64_t(n) * uint64_t(n))
+            return false;
+
+        const uint8_t* bytes = in.at;
+        const size_t total = size_t(n) * size_t(n);
+        bool binary = true;
+        for (size_t i = 0; i < total && binary; ++i)
+            binary = bytes[i] <= 1;
+
+        state = UniverseState();
+        if (binary)
+        {
+            state.cells = Grid(n, n);
+            for (int r = 0; r < n; ++r)
+            {
+                const uint8_t* source = bytes + size_t(r) * n;
+                uint64_t* row = state.cells.Row(r);
+                for (int c = 0; c < n; ++c)
+                    row[c >> 6] |= uint64_t(source[c]) << (c & 63);
+            }
+        }
+        else
+        {
+            state.colors = ByteGrid(n, n);
+            for (int r = 0; r < n; ++r)
+                std::memcpy(state.colors.Row(r), bytes + size_t(r) * n, n);
+        }
+        return true;
+    }
+
+    // Sets count cells of a bit row starting at col
+    void SetRun(uint64_t* row, int64_t col, int64_t count)
+    {
+        for (; count > 0; col += 64, count -= 64)
+            WriteBits(row, col, count < 64 ? static_cast<int>(count) : 64, ~uint64_t(0));
+    }
+
+    // What a character of a plain pattern is: kCell for every cell, plus
+    // kAlive or kAnt (with the direction in the top bits) for some of them
+    enum : uint8_t { kCell = 1, kAlive = 2, kAnt = 4 };
+
+    struct PlainTable
+    {
+        uint8_t cell[256] = {};
+        PlainTable()
+        {
+            for (unsigned char ch : { '1', 'X', '*', 'O' })
+                cell[ch] = kCell | kAlive;
+            for (unsigned char ch : { '0', '.', ' ' })
+                cell[ch] = kCell;
+            const char markers[] = "^>v<";
+            for (int direction = 0; direction < 4; ++direction)
+                cell[static_cast<unsigned char>(markers[direction])] = uint8_t(kCell | kAnt | (direction << 4));
+        }
+    };
+
+    const char* LineEnd(const char* at, const char* end)
+    {
+        const void* newline = std::memchr(at, '\n', size_t(end - at));
+        return newline ? static_cast<const char*>(newline) : end;
+    }
+
+    // A line of a plain pattern that holds cells
+    struct PlainLine
+    {
+        const char* begin;
+        const char* end;
+        bool onlyCells;  // Every character is a dead or living cell, so columns are offsets
+    };
+
+    // Plain patterns, one row per line. The first pass finds the lines with
+    // cells, the second writes them into the grid's rows. Lines starting with
+    // '!' are comments (as in .cells files).
+    bool ReadPlain(const char* begin, const char* end, Grid& pattern, std::vector<AntPlacement>& ants)
+    {
+        static const PlainTable table;
+
+        std::vector<PlainLine> lines;
+        int64_t width = 0;
+        for (const char* at = begin; at < end;)
+        {
+            const char* lineEnd = LineEnd(at, end);
+            if (*at != '!')
+            {
+                int64_t cells = 0;
+                uint8_t any = 0;
+                for (const char* ch = at; ch < lineEnd; ++ch)
+                {
+                    const uint8_t cell = table.cell[static_cast<unsigned char>(*ch)];
+                    cells += cell & kCell;
+                    any |= cell;
+                }
+                if (cells > 0)
+                {
+                    lines.push_back(PlainLine{ at, lineEnd, cells == lineEnd - at && !(any & kAnt) });
+                    width = std::max(width, cells);
+                }
+            }
+            at = lineEnd + 1;
+        }
+        if (lines.empty() || lines.size() > size_t(kMaxUniverseSide) || width > kMaxUniverseSide)
+            return false;
+
+        pattern = Grid(static_cast<int>(lines.size()), static_cast<int>(width));
+        for (size_t r = 0; r < lines.size(); ++r)
+        {
+            const PlainLine& line = lines[r];
+            uint64_t* bits = pattern.Row(static_cast<int>(r));
+            if (line.onlyCells)
+            {
+                // Branch-free: each character's living bit goes straight into the word
+                const int64_t n = line.end - line.begin;
+                for (int64_t c0 = 0; c0 < n; c0 += 64)
+                {
+                    const unsigned char* chars = reinterpret_cast<const unsigned char*>(line.begin + c0);
+                    const int count = n - c0 < 64 ? static_cast<int>(n - c0) : 64;
+                    uint64_t word = 0;
+                    for (int i = 0; i < count; ++i)
+                        word |= uint64_t((table.cell[chars[i]] & kAlive) >> 1) << i;
+                    bits[c0 >> 6] = word;
+                }
+                continue;
+            }
+
+            int col = 0;
+            for (const char* ch = line.begin; ch < line.end; ++ch)
+            {
+                const uint8_t cell = table.cell[static_cast<unsigned char>(*ch)];
+                if (!(cell & kCell))
+                    continue;
+                if (cell & kAlive)
+                    bits[col >> 6] |= uint64_t(1) << (col & 63);
+                else if (cell & kAnt)
+                    ants.push_back(AntPlacement{ int64_t(r), col, cell >> 4 });
+                ++col;
+            }
+        }
+        return true;
+    }
+
+    bool IsSpace(char ch)
+    {
+        return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+    }
+
+    // Skips '#' comment lines and blank lines
+    const char* SkipComments(const char* at, const char* end)
+    {
+        while (at < end)
+        {
+            const char* line = at;
+            while (line < end && IsSpace(*line) && *line != '\n')
+                ++line;
+            if (line < end && *line != '#' && *line != '\n')
+                return line;
+            at = LineEnd(line, end) + 1;
+        }
+        return end;
+    }
+
+    // Reads "name = number" from the header, skipping spaces; -1 if it isn't there
+    int64_t HeaderValue(const char*& at, const char* end, char name)
+    {
+        while (at < end && (*at == ' ' || *at == '\t' || *at == ','))
+            ++at;
+        if (at == end || *at != name)
+            return -1;
+        ++at;
+        while (at < end && (*at == ' ' || *at == '\t'))
+            ++at;
+        if (at == end || *at != '=')
+            return -1;
+        ++at;
+        while (at < end && (*at == ' ' || *at == '\t'))
+            ++at;
+        int64_t value = -1;
+        for (; at < end && *at >= '0' && *at <= '9' && value <= kMaxUniverseSide; ++at)
+            value = (value < 0 ? 0 : value * 10) + (*at - '0');
+        return value;
+    }
+
+    // RLE files start (after '#' comments) with a header line "x = W, y = H"
+    bool IsRle(const char* begin, const char* end)
+    {
+        const char* at = SkipComments(begin, end);
+        return HeaderValue(at, end, 'x') >= 0;
+    }
+
+    // Runs the RLE cells in data through alive(row, col, count) for every run
+    // of living cells and returns the extent of those runs. "b" and "." are
+    // dead; "o" and the states of multi-state files ("A".."X", with "p".."y"
+    // prefixes) are alive. "$" ends a row and "!" the pattern. alive returns
+    // false to stop the scan. False for a run past kMaxUniverseSide, a broken
+    // state or a stopped scan.
+    template <typename Alive>
+    bool ScanRle(const char* at, const char* end, int64_t& rows, int64_t& cols, Alive alive)
+    {
+        int64_t row = 0, col = 0, count = 0;
+        rows = 0;
+        cols = 0;
+        while (at < end)
+        {
+            const char ch = *at++;
+            if (ch >= '0' && ch <= '9')
+            {
+                count = count * 10 + (ch - '0');
+                if (count > kMaxUniverseSide)
+                    return false;
+                continue;
+            }
+            if (IsSpace(ch))
+                continue;
+
+            const int64_t n = count > 0 ? count : 1;
+            count = 0;
+            if (ch == 'b' || ch == '.')
+            {
+                col += n;
+            }
+            else if (ch == 'o' || (ch >= 'A' && ch <= 'X') || (ch >= 'p' && ch <= 'y'))
+            {
+                if (ch >= 'p' && (at == end || *at < 'A' || *at > 'X'))
+                    return false;
+                if (ch >= 'p')
+                    ++at;
+                if (row >= kMaxUniverseSide || col + n > kMaxUniverseSide || !alive(row, col, n))
+                    return false;
+                col += n;
+                rows = row + 1;
+                cols = std::max(cols, col);
+            }
+            else if (ch == '$')
+            {
+                row += n;
+                col = 0;
+            }
+            else if (ch == '!')
+            {
+                break;
+            }
+            // Anything else is ignored
+        }
+        return true;
+    }
+
+    bool ReadRle(const char* begin, const char* end, Grid& pattern)
+    {
+        const char* at = SkipComments(begin, end);
+        const int64_t width = HeaderValue(at, end, 'x');
+        const int64_t height = HeaderValue(at, end, 'y');
+        at = LineEnd(at, end);  // The rule, if any, is Life's business
+
+        // One pass into a grid of the header's size; runs past it cost a second pass to measure
+        int64_t rows, cols;
+        if (width > 0 && height > 0 && width <= kMaxUniverseSide && height <= kMaxUniverseSide)
+        {
+            pattern = Grid(static_cast<int>(height), static_cast<int>(width));
+            const bool fits = ScanRle(at, end, rows, cols, [&pattern](int64_t row, int64_t col, int64_t count)
+                {
+                    if (row >= pattern.Rows() || col + count > pattern.Cols())
+                        return false;
+                    SetRun(pattern.Row(static_cast<int>(row)), col, count);
+                    return true;
+                });
+            if (fits)
+                return true;
+        }
+
+        if (!ScanRle(at, end, rows, cols, [](int64_t, int64_t, int64_t) { return true; }))
+            return false;
+        rows = std::max(rows, height);
+        cols = std::max(cols, width);
+        if (rows <= 0 || cols <= 0 || rows > kMaxUniverseSide || cols > kMaxUniverseSide)
+            return false;
+
+        pattern = Grid(static_cast<int>(rows), static_cast<int>(cols));
+        return ScanRle(at, end, rows, cols, [&pattern](int64_t row, int64_t col, int64_t count)
+            {
+                SetRun(pattern.Row(static_cast<int>(row)), col, count);
+                return true;
+            });
+    }
+}
+
+bool ReadPattern(const std::string& path, Grid& pattern)
+{
+    std::vector<AntPlacement> ants;
+    return ReadPattern(path, pattern, ants);
+}
+
+bool ReadPattern(const std::string& path, Grid& pattern, std::vector<AntPlacement>& ants)
+{
+    ANT_PERF_SCOPE(Io);
+    ants.clear();
+    const MappedFile file(path);
+    if (!file.Data())
+        return false;
+
+    const char* begin = reinterpret_cast<const char*>(file.Data());
+    const char* end = begin + file.Size();
+    return IsRle(begin, end) ? ReadRle(begin, end, pattern) : ReadPlain(begin, end, pattern, ants);
+}
+
+bool WriteUniverse(const std::string& path, const Grid& cells, const AntColony& ants, const UniverseInfo& info)
+{
+    ANT_PERF_SCOPE(Io);
+    return WriteCells(path, cells, info.infinitePlane ? kFlagPlane : 0, ants, info);
+}
+
+bool WriteUniverse(const std::string& path, const ByteGrid& colors, const AntColony& ants, const UniverseInfo& info)
+{
+    ANT_PERF_SCOPE(Io);
+    return WriteCells(path, colors, uint16_t(kFlagColors | (info.infinitePlane ? kFlagPlane : 0)), ants, info);
+}
+
+bool WriteUniverse(const std::string& path, const SparseUniverse& plane, const AntColony& ants, const UniverseInfo& info)
+{
+    ANT_PERF_SCOPE(Io);
+    return WriteTiles(path, plane, ants, info);
+}
+
+bool WriteUniverse(const std::string& path, const UniverseState& state)
+{
+    if (state.plane.TileCount() > 0)
+        return WriteUniverse(path, state.plane, state.ants, state.info);
+    if (state.colors.Rows() > 0)
+        return WriteUniverse(path, state.colors, state.ants, state.info);
+    return WriteUniverse(path, state.cells, state.ants, state.info);
+}
+
+bool ReadUniverse(const std::string& path, UniverseState& state)
+{
+    ANT_PERF_SCOPE(Io);
+    const MappedFile file(path);
+    if (!file.Data())
+        return false;
+
+    Cursor in{ file.Data(), file.Data() + file.Size() };
+    if (file.Size() >= 4 && std::memcmp(file.Data(), kMagic, 4) == 0)
+    {
+        in.at += 4;
+        return ReadCurrent(in, state);
+    }
+    return ReadLegacy(in, state);
+}
+
+bool WriteUniverse(const std::string& path, const Grid& grid)
+{
+    return WriteUniverse(path, grid, AntColony(), UniverseInfo());
+}
+
+bool ReadUniverse(const std::string& path, Grid& grid)
+{
+    UniverseState state;
+    if (!ReadUniverse(path, state) || state.plane.TileCount() > 0)
+        return false;
+    grid = state.colors.Rows() > 0 ? ColorsToCells(state.colors) : std::move(state.cells);
+    return true;
+}
+
+bool WriteUniverse(const std::string& path, const ByteGrid& colors)
+{
+    return WriteUniverse(path, colors, AntColony(), UniverseInfo());
+}
+
+bool ReadUniverse(const std::string& path, ByteGrid& colors)
+{
+    UniverseState state;
+    if (!ReadUniverse(path, state) || state.plane.TileCount() > 0)
+        return false;
+    colors = state.cells.Rows() > 0 ? CellsToColors(state.cells) : std::move(state.colors);
+    return true;
+}
+
+ByteGrid CellsToColors(const Grid& cells)
+{
+    ByteGrid colors(cells.Rows(), cells.Cols());
+    for (int r = 0; r < cells.Rows(); ++r)
+    {
+        const uint64_t* source = cells.Row(r);
+        uint8_t* row = colors.Row(r);
+        for (int c = 0; c < cells.Cols(); ++c)
+            row[c] = uint8_t((source[c >> 6] >> (c & 63)) & 1);
+    }
+    return colors;
+}
+
+Grid ColorsToCells(const ByteGrid& colors)
+{
+    Grid cells(colors.Rows(), colors.Cols());
+    for (int r = 0; r < colors.Rows(); ++r)
+    {
+        const uint8_t* source = colors.Row(r);
+        uint64_t* row = cells.Row(r);
+        for (int c = 0; c < colors.Cols(); ++c)
+            row[c >> 6] |= uint64_t(source[c] != 0) << (c & 63);
+    }
+    return cells;
+}
+
+namespace
+{
+    // Copies cells into a grid of the same size, allocating only when the size changed
+    template <typename G>
+    void CopyCells(const G& from, G& to)
+    {
+        if (to.Rows() != from.Rows() || to.Cols() != from.Cols())
+            to = G(from.Rows(), from.Cols());
+        std::memcpy(to.Data(), from.Data(), from.SizeBytes());
+    }
+}
+
+void CaptureCells(const Grid& cells, UniverseState& state)
+{
+    CopyCells(cells, state.cells);
+    if (state.colors.Rows() != 0)
+        state.colors = ByteGrid();
+    state.plane.Clear();
+    state.info.infinitePlane = false;
+    state.info.originRow = 0;
+    state.info.originCol = 0;
+}
+
+void CaptureColors(const ByteGrid& colors, UniverseState& state)
+{
+    CopyCells(colors, state.colors);
+    if (state.cells.Rows() != 0)
+        state.cells = Grid();
+    state.plane.Clear();
+    state.info.infinitePlane = false;
+    state.info.originRow = 0;
+    state.info.originCol = 0;
+}
+
+void CapturePlane(const SparseUniverse& plane, int viewSize, UniverseState& state)
+{
+    const int64_t tileSize = SparseUniverse::kTileSize;
+    int64_t top = 0, left = 0;
+    int64_t bottom = viewSize, right = viewSize;
+    uint64_t living = 0;
+    plane.ForEachTile([&](int64_t tileRow, int64_t tileCol, const SparseUniverse::Tile& tile)
+    {
+        if (!HasLife(tile))
+            return;
+        top = std::min(top, tileRow * tileSize);
+        left = std::min(left, tileCol * tileSize);
+        bottom = std::max(bottom, (tileRow + 1) * tileSize);
+        right = std::max(right, (tileCol + 1) * tileSize);
+        ++living;
+    });
+    state.info.infinitePlane = true;
+    if (state.colors.Rows() != 0)
+        state.colors = ByteGrid();
+
+    // Rows while the box is small and at least a quarter full (counting the
+    // view as full), so a highway's long diagonal is kept as tiles
+    const uint64_t boxTiles = uint64_t((bottom - top) / tileSize) * uint64_t((right - left) / tileSize);
+    const uint64_t viewTiles = uint64_t(viewSize / tileSize + 1) * uint64_t(viewSize / tileSize + 1);
+    if (living > 0 && (bottom - top > kMaxUniverseSide || right - left > kMaxUniverseSide || boxTiles > 4 * (living + viewTiles)))
+    {
+        if (state.cells.Rows() != 0)
+            state.cells = Grid();
+        state.plane.Reset();
+        plane.ForEachTile([&](int64_t tileRow, int64_t tileCol, const SparseUniverse::Tile& tile)
+        {
+            if (HasLife(tile))
+                *state.plane.GetOrCreateTile(tileRow, tileCol) = tile;
+        });
+        state.info.originRow = 0;
+        state.info.originCol = 0;
+        return;
+    }
+
+    state.plane.Clear();
+    if (state.cells.Rows() != bottom - top || state.cells.Cols() != right - left)
+        state.cells = Grid(static_cast<int>(bottom - top), static_cast<int>(right - left));
+    plane.CopyRegion(top, left, state.cells);
+    state.info.originRow = top;
+    state.info.originCol = left;
+}
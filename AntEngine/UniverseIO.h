@@ -0,0 +1,83 @@
+// Declares the pattern and universe file readers/writers.
+// They work on plain Grids with no UI code, so the wx app and the
+// command-line runner load and save files the same way.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "AntColony.h"
+#include "Grid.h"
+#include "SparseUniverse.h"
+#include "Turmite.h"
+
+// Reads a pattern file, plain text or RLE, straight into the pattern's rows.
+// Plain text: '1', 'X', '*' and 'O' are living cells; '0', '.' and ' ' are
+// dead; '^', '>', 'v' and '<' are dead cells with an ant facing up, right,
+// down or left; anything else is ignored. Lines with no cells and lines
+// starting with '!' are skipped, and short lines are padded with dead cells.
+// RLE (a file whose first line after '#' comments is "x = W, y = H"): runs
+// such as "3o2b$", where every state but 'b' and '.' is alive. Returns false
+// if the file can't be opened, holds no cells or is larger than
+// kMaxUniverseSide on a side.
+bool ReadPattern(const std::string& path, Grid& pattern, std::vector<AntPlacement>& ants);
+bool ReadPattern(const std::string& path, Grid& pattern);  // Ant markers are read as dead cells
+
+// Universe files (version 1) start with a header: the "ANTU" magic, version,
+// flags, dimensions, rule, generation, the ants and a checksum of the cells.
+// Rows follow in chunks of about 1 MiB; each row is bit-packed (one byte per
+// cell for turmite colors) and run-length encoded on its own, so the loader
+// can decode it straight into the grid's row. The loader maps the file into
+// memory and also reads the old format (the size as an int, then one byte
+// per cell). Numbers are little-endian.
+// A plane whose living cells are spread too thin for one box of rows (a
+// highway soon runs past kMaxUniverseSide) is stored as tiles instead: the
+// header has no rows, and chunks of 64x64 tiles follow, each with its tile
+// coordinates and its rows encoded like a row of 512 bytes.
+constexpr int kMaxUniverseSide = 65536;
+
+struct UniverseInfo
+{
+    TurmiteRule rule;
+    uint64_t generation = 0;
+    bool infinitePlane = false;            // The cells are a window of the plane...
+    int64_t originRow = 0, originCol = 0;  // ...whose top-left cell is this plane cell
+};
+
+// Everything a universe file holds. Exactly one of cells, colors and plane is
+// loaded: cells for bit-packed files, colors for files of turmite colors and
+// plane (with at least one tile) for planes stored as tiles, whose origin is 0.
+struct UniverseState
+{
+    Grid cells;
+    ByteGrid colors;
+    SparseUniverse plane;
+    AntColony ants;
+    UniverseInfo info;
+};
+
+bool WriteUniverse(const std::string& path, const Grid& cells, const AntColony& ants, const UniverseInfo& info);
+bool WriteUniverse(const std::string& path, const ByteGrid& colors, const AntColony& ants, const UniverseInfo& info);
+bool WriteUniverse(const std::string& path, const SparseUniverse& plane, const AntColony& ants, const UniverseInfo& info);
+bool WriteUniverse(const std::string& path, const UniverseState& state);  // Whichever kind of cells it holds
+bool ReadUniverse(const std::string& path, UniverseState& state);
+
+// Living cells as colors 0/1, and nonzero colors as living cells
+ByteGrid CellsToColors(const Grid& cells);
+Grid ColorsToCells(const ByteGrid& colors);
+
+// Copy running cells into state (emptying the other kinds), reusing its
+// grids when the size hasn't changed; the caller fills in the ants and the
+// rest of the info. The plane is taken as the box of every tile with living
+// cells plus the [0, viewSize) view, or as its living tiles when that box is
+// too big for a universe file or mostly dead.
+void CaptureCells(const Grid& cells, UniverseState& state);
+void CaptureColors(const ByteGrid& colors, UniverseState& state);
+void CapturePlane(const SparseUniverse& plane, int viewSize, UniverseState& state);
+
+// Just the cells (no ants, generation 0); the readers convert between bits
+// and colors, and fail on a plane stored as tiles
+bool WriteUniverse(const std::string& path, const Grid& grid);
+bool ReadUniverse(const std::string& path, Grid& grid);
+bool WriteUniverse(const std::string& path, const ByteGrid& colors);
+bool ReadUniverse(const std::string& path, ByteGrid& colors);
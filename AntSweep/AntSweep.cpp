@@ -0,0 +1,758 @@
+// Parameter sweep runner: reads a manifest of jobs (rules, grid sizes, start
+// directions, patterns and random seeds), runs every job as an independent
+// universe on a pool of threads, and streams one result row per job to a CSV
+// or JSON Lines file as the jobs finish.
+//
+// Manifest: one job per line as key=value words; '#' starts a comment. A value
+// can list choices with '|' and whole-number ranges with "a..b", and a line
+// runs every combination of its choices:
+//   name=spiral rule=RL|LLRR size=256 dir=up|left random=1..100 steps=200000
+// Keys: name, rule, size, steps, dir, plane (0 or 1), pattern (a file),
+// random (a seed; the size x size start area gets random cells) and until
+// (steps, or highway to stop at the first highway found, RL only).
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AntColony.h"
+#include "Grid.h"
+#include "Highway.h"
+#include "LangtonsAnt.h"
+#include "SparseUniverse.h"
+#include "Turmite.h"
+#include "UniverseIO.h"
+
+namespace
+{
+    enum class Format { Csv, Json };
+
+    struct Options
+    {
+        std::string manifestPath;
+        std::string outputPath;  // Empty = stdout
+        Format format = Format::Csv;
+        int threads = 0;         // 0 = one per core
+    };
+
+    // A pattern file, read once and shared by every job that places it
+    struct Pattern
+    {
+        std::string path;
+        Grid cells;
+        std::vector<AntPlacement> ants;
+    };
+
+    struct Job
+    {
+        size_t index = 0;
+        int line = 0;  // Manifest line it came from
+        std::string name = "job";
+        std::string ruleText = "RL";
+        TurmiteRule rule;
+        int size = 256;
+        uint64_t steps = 1000000;
+        int direction = 0;
+        bool infinitePlane = false;
+        int pattern = -1;  // Index into the patterns, -1 = none
+        bool randomFill = false;
+        uint64_t seed = 0;
+        bool untilHighway = false;
+    };
+
+    struct Result
+    {
+        uint64_t generation = 0;  // Steps actually run
+        uint64_t population = 0;  // Living cells (nonzero colors for turmites)
+        bool foundHighway = false;
+        int period = 0;           // The highway found (period 0 if none)
+        int64_t deltaRow = 0, deltaCol = 0;
+        uint64_t highwayAt = 0;   // Generation it set in at (a periodic orbit can set in at 0)
+        int64_t row = 0, col = 0; // First ant at the end
+        int direction = 0;
+        size_t ants = 0;
+        double seconds = 0.0;
+    };
+
+    // Steps between highway checks for until=highway
+    const uint64_t kHighwaySlice = 4096;
+
+    void PrintUsage(const char* program)
+    {
+        std::printf(
+            "Usage: %s [options] --manifest FILE\n"
+            "  --manifest FILE   Jobs to run, one line per job (see below)\n"
+            "  --output FILE     Write the results to FILE instead of stdout\n"
+            "  --format NAME     csv (default) or json (one object per line)\n"
+            "  --threads N       Worker threads (0 = one per core, default 0)\n"
+            "  --help            Show this message\n"
+            "\n"
+            "Each manifest line holds key=value words; '#' starts a comment:\n"
+            "  name=NAME         Label copied into the results (default job)\n"
+            "  rule=RULE         Turmite rule, as for antcli --rule (default RL)\n"
+            "  size=N            Grid size, or the start area on the plane (default 256)\n"
+            "  steps=N           Steps to run (default 1000000)\n"
+            "  dir=DIR           Start direction: up, right, down or left (default up)\n"
+            "  plane=0|1         Run on the unbounded plane (RL only, default 0)\n"
+            "  pattern=FILE      Pattern placed in the center; its ant markers replace the ant\n"
+            "  random=SEED       Fill the start area with random cells from SEED\n"
+            "  until=WHAT        steps (default) or highway: stop once a highway is found\n"
+            "A value can be a list of choices (a|b|c) or a range of whole numbers\n"
+            "(1..100); a line runs every combination of its choices.\n",
+            program);
+    }
+
+    bool ParseNumber(const char* text, uint64_t& value)
+    {
+        char* end = nullptr;
+        value = std::strtoull(text, &end, 10);
+        return end != text && *end == '\0';
+    }
+
+    // Returns false (after printing why) if the arguments can't be used
+    bool ParseOptions(int argc, char** argv, Options& options, bool& showHelp)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const char* arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            uint64_t number = 0;
+
+            if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0)
+            {
+                showHelp = true;
+            }
+            else if (std::strcmp(arg, "--manifest") == 0 && hasValue)
+            {
+                options.manifestPath = argv[++i];
+            }
+            else if (std::strcmp(arg, "--output") == 0 && hasValue)
+            {
+                options.outputPath = argv[++i];
+            }
+            else if (std::strcmp(arg, "--format") == 0 && hasValue)
+            {
+                const char* name = argv[++i];
+                if (std::strcmp(name, "csv") == 0)
+                    options.format = Format::Csv;
+                else if (std::strcmp(name, "json") == 0)
+                    options.format = Format::Json;
+                else
+                {
+                    std::fprintf(stderr, "Unknown output format: %s\n", name);
+                    return false;
+                }
+            }
+            else if (std::strcmp(arg, "--threads") == 0 && hasValue)
+            {
+                if (!ParseNumber(argv[++i], number) || number > 1024)
+                {
+                    std::fprintf(stderr, "Invalid thread count: %s\n", argv[i]);
+                    return false;
+                }
+                options.threads = static_cast<int>(number);
+            }
+            else
+            {
+                std::fprintf(stderr, "Unknown or incomplete option: %s\n", arg);
+                return false;
+            }
+        }
+        if (options.manifestPath.empty() && !showHelp)
+        {
+            std::fprintf(stderr, "No manifest given (--manifest FILE)\n");
+            return false;
+        }
+        return true;
+    }
+
+    const char* DirectionName(int direction)
+    {
+        static const char* const names[] = { "up", "right", "down", "left" };
+        return names[direction & 3];
+    }
+
+    // Splits text at every separator (empty pieces included)
+    std::vector<std::string> Split(const std::string& text, char separator)
+    {
+        std::vector<std::string> pieces;
+        size_t start = 0;
+        for (;;)
+        {
+            const size_t end = text.find(separator, start);
+            pieces.push_back(text.substr(start, end == std::string::npos ? std::string::npos : end - start));
+            if (end == std::string::npos)
+                return pieces;
+            start = end + 1;
+        }
+    }
+
+    // The choices of one value: "a|b" lists them, "a..b" counts from a to b
+    bool ExpandValue(const std::string& value, std::vector<std::string>& choices)
+    {
+        const size_t maxRange = 1000000;
+        for (const std::string& piece : Split(value, '|'))
+        {
+            const size_t dots = piece.find("..");
+            uint64_t first = 0, last = 0;
+            if (dots != std::string::npos && ParseNumber(piece.substr(0, dots).c_str(), first) &&
+                ParseNumber(piece.substr(dots + 2).c_str(), last))
+            {
+                if (last < first || last - first >= maxRange)
+                    return false;
+                for (uint64_t number = first; number <= last; ++number)
+                    choices.push_back(std::to_string(number));
+            }
+            else
+            {
+                choices.push_back(piece);
+            }
+        }
+        return true;
+    }
+
+    // Index of the pattern read from path, reading it the first time it's named
+    bool FindPattern(const std::string& path, std::vector<Pattern>& patterns, int& index)
+    {
+        for (size_t i = 0; i < patterns.size(); ++i)
+        {
+            if (patterns[i].path == path)
+            {
+                index = static_cast<int>(i);
+                return true;
+            }
+        }
+        Pattern pattern;
+        pattern.path = path;
+        if (!ReadPattern(path, pattern.cells, pattern.ants))
+            return false;
+        patterns.push_back(std::move(pattern));
+        index = static_cast<int>(patterns.size() - 1);
+        return true;
+    }
+
+    // Sets one key of a job; false (with why in error) if the value can't be used
+    bool SetField(Job& job, const std::string& key, const std::string& value, std::vector<Pattern>& patterns, std::string& error)
+    {
+        uint64_t number = 0;
+        if (key == "name")
+        {
+            job.name = value;
+        }
+        else if (key == "rule")
+        {
+            if (!ParseTurmiteRule(value, job.rule))
+            {
+                error = "invalid rule " + value;
+                return false;
+            }
+            job.ruleText = value;
+        }
+        else if (key == "size")
+        {
+            if (!ParseNumber(value.c_str(), number) || number < 1 || number > uint64_t(kMaxUniverseSide))
+            {
+                error = "grid size must be between 1 and " + std::to_string(kMaxUniverseSide);
+                return false;
+            }
+            job.size = static_cast<int>(number);
+        }
+        else if (key == "steps")
+        {
+            if (!ParseNumber(value.c_str(), job.steps))
+            {
+                error = "invalid step count " + value;
+                return false;
+            }
+        }
+        else if (key == "dir")
+        {
+            static const char* const names[] = { "up", "right", "down", "left" };
+            const auto name = std::find(std::begin(names), std::end(names), value);
+            if (name == std::end(names))
+            {
+                error = "unknown direction " + value;
+                return false;
+            }
+            job.direction = static_cast<int>(name - std::begin(names));
+        }
+        else if (key == "plane")
+        {
+            if (value != "0" && value != "1")
+            {
+                error = "plane must be 0 or 1";
+                return false;
+            }
+            job.infinitePlane = value == "1";
+        }
+        else if (key == "pattern")
+        {
+            if (!FindPattern(value, patterns, job.pattern))
+            {
+                error = "failed to load pattern from " + value;
+                return false;
+            }
+        }
+        else if (key == "random")
+        {
+            if (!ParseNumber(value.c_str(), job.seed))
+            {
+                error = "invalid seed " + value;
+                return false;
+            }
+            job.randomFill = true;
+        }
+        else if (key == "until")
+        {
+            if (value != "steps" && value != "highway")
+            {
+                error = "until must be steps or highway";
+                return false;
+            }
+            job.untilHighway = value == "highway";
+        }
+        else
+        {
+            error = "unknown key " + key;
+            return false;
+        }
+        return true;
+    }
+
+    // Reads the manifest and expands every line into its jobs; patterns named
+    // by the jobs are read here, once, so the workers share them
+    bool ReadManifest(const std::string& path, std::vector<Job>& jobs, std::vector<Pattern>& patterns)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::fprintf(stderr, "Failed to open manifest %s\n", path.c_str());
+            return false;
+        }
+
+        const size_t maxJobs = size_t(1) << 24;
+        std::string text;
+        for (int lineNumber = 1; std::getline(file, text); ++lineNumber)
+        {
+            text = text.substr(0, text.find('#'));
+
+            // Each key with its choices, in the order written
+            std::vector<std::pair<std::string, std::vector<std::string>>> keys;
+            size_t combinations = 1;
+            size_t pos = 0;
+            while (pos < text.size())
+            {
+                if (std::isspace(static_cast<unsigned char>(text[pos])))
+                {
+                    ++pos;
+                    continue;
+                }
+                size_t end = pos;
+                while (end < text.size() && !std::isspace(static_cast<unsigned char>(text[end])))
+                    ++end;
+                const std::string word = text.substr(pos, end - pos);
+                pos = end;
+
+                const size_t equals = word.find('=');
+                std::vector<std::string> choices;
+                if (equals == std::string::npos || equals == 0 || !ExpandValue(word.substr(equals + 1), choices))
+                {
+                    std::fprintf(stderr, "%s:%d: expected key=value, got %s\n", path.c_str(), lineNumber, word.c_str());
+                    return false;
+                }
+                combinations *= choices.size();
+                if (combinations > maxJobs)
+                {
+                    std::fprintf(stderr, "%s:%d: more than %zu jobs on one line\n", path.c_str(), lineNumber, maxJobs);
+                    return false;
+                }
+                keys.emplace_back(word.substr(0, equals), std::move(choices));
+            }
+            if (keys.empty())
+                continue;
+
+            // Odometer over the choices; the last key changes fastest
+            std::vector<size_t> pick(keys.size(), 0);
+            for (size_t n = 0; n < combinations; ++n)
+            {
+                Job job;
+                job.index = jobs.size();
+                job.line = lineNumber;
+                for (size_t k = 0; k < keys.size(); ++k)
+                {
+                    std::string error;
+                    if (!SetField(job, keys[k].first, keys[k].second[pick[k]], patterns, error))
+                    {
+                        std::fprintf(stderr, "%s:%d: %s\n", path.c_str(), lineNumber, error.c_str());
+                        return false;
+                    }
+                }
+                if (!job.rule.IsLangtonsAnt() && (job.infinitePlane || job.untilHighway))
+                {
+                    std::fprintf(stderr, "%s:%d: plane=1 and until=highway need the RL rule\n", path.c_str(), lineNumber);
+                    return false;
+                }
+                jobs.push_back(std::move(job));
+                if (jobs.size() > maxJobs)
+                {
+                    std::fprintf(stderr, "%s: more than %zu jobs\n", path.c_str(), maxJobs);
+                    return false;
+                }
+
+                for (size_t k = keys.size(); k-- > 0;)
+                {
+                    if (++pick[k] < keys[k].second.size())
+                        break;
+                    pick[k] = 0;
+                }
+            }
+        }
+        return true;
+    }
+
+    // What one worker keeps between jobs. A job of the same size as the last
+    // one clears the cells instead of allocating them again, and the plane
+    // keeps its tiles for the next job to reuse.
+    struct Arena
+    {
+        Grid grid;
+        ByteGrid colors;
+        SparseUniverse plane;
+        HighwayDetector highway;
+        AntColony ants;
+    };
+
+    template <typename Cells>
+    void Prepare(Cells& cells, int n)
+    {
+        if (cells.Rows() != n || cells.Cols() != n)
+            cells = Cells(n, n);
+        else
+            cells.Clear();
+    }
+
+    // The pattern's ants moved by the same offset as its cells; a single ant in
+    // the center, facing the job's direction, when there are none
+    void PlaceAnts(const Job& job, const Pattern* pattern, int64_t startRow, int64_t startCol, AntColony& ants)
+    {
+        const int n = job.size;
+        ants.Clear();
+        if (pattern)
+        {
+            for (const AntPlacement& ant : pattern->ants)
+            {
+                const int64_t row = startRow + ant.row;
+                const int64_t col = startCol + ant.col;
+                if (job.infinitePlane || (row >= 0 && row < n && col >= 0 && col < n))
+                    ants.Add(row, col, ant.direction);
+            }
+        }
+        if (ants.Empty())
+            ants.Add(n / 2, n / 2, job.direction);
+    }
+
+    // Runs a single RL ant through the highway detector, which skips the
+    // periods of a highway once it locks on; returns the ant's final state
+    template <typename Cells>
+    LangtonsAnt RunLangton(const Job& job, Arena& arena, Cells& cells, Result& result)
+    {
+        LangtonsAnt ant(arena.ants.GetRow(0), arena.ants.GetCol(0), arena.ants.GetDirection(0));
+        arena.highway.Reset();
+        while (result.generation < job.steps)
+        {
+            const uint64_t slice = std::min(job.steps - result.generation, kHighwaySlice);
+            arena.highway.StepMany(ant, cells, slice);
+            result.generation += slice;
+            if (!result.foundHighway && arena.highway.Period() > 0)
+            {
+                result.foundHighway = true;
+                result.highwayAt = arena.highway.HighwayStart();  // Not rounded up to the slice
+                result.period = arena.highway.Period();
+                result.deltaRow = arena.highway.DeltaRow();
+                result.deltaCol = arena.highway.DeltaCol();
+                if (job.untilHighway)
+                    break;
+            }
+        }
+        return ant;
+    }
+
+    Result RunJob(const Job& job, const std::vector<Pattern>& patterns, Arena& arena)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const int n = job.size;
+        const bool langton = job.rule.IsLangtonsAnt();
+        const Pattern* pattern = job.pattern >= 0 ? &patterns[job.pattern] : nullptr;
+        Result result;
+
+        // Start area: the grid, or the n x n window of the plane at (0, 0)
+        if (job.infinitePlane)
+            arena.plane.Reset();
+        else if (langton)
+            Prepare(arena.grid, n);
+        else
+            Prepare(arena.colors, n);
+
+        if (job.randomFill)
+        {
+            std::mt19937_64 rng(job.seed);
+            for (int r = 0; r < n; ++r)
+            {
+                for (int c = 0; c < n; ++c)
+                {
+                    if (job.infinitePlane)
+                        arena.plane.Set(r, c, (rng() & 1) != 0);
+                    else if (langton)
+                        arena.grid.Set(r, c, (rng() & 1) != 0);
+                    else
+                        arena.colors.Row(r)[c] = static_cast<uint8_t>(rng() % uint64_t(job.rule.colors));
+                }
+            }
+        }
+
+        // The pattern goes in the center, clipped to the grid; living cells are color 1
+        int64_t startRow = 0, startCol = 0;
+        if (pattern)
+        {
+            startRow = (n - pattern->cells.Rows()) / 2;
+            startCol = (n - pattern->cells.Cols()) / 2;
+            if (job.infinitePlane)
+                arena.plane.Paste(pattern->cells, startRow, startCol);
+            else if (langton)
+                arena.grid.Paste(pattern->cells, startRow, startCol);
+            else
+            {
+                for (int r = 0; r < pattern->cells.Rows(); ++r)
+                {
+                    for (int c = 0; c < pattern->cells.Cols(); ++c)
+                    {
+                        const int64_t gridR = startRow + r;
+                        const int64_t gridC = startCol + c;
+                        if (gridR >= 0 && gridR < n && gridC >= 0 && gridC < n)
+                            arena.colors.Row(static_cast<int>(gridR))[gridC] = pattern->cells.Get(r, c) ? 1 : 0;
+                    }
+                }
+            }
+        }
+        PlaceAnts(job, pattern, startRow, startCol, arena.ants);
+
+        if (langton && arena.ants.Size() == 1)
+        {
+            const LangtonsAnt ant = job.infinitePlane ? RunLangton(job, arena, arena.plane, result)
+                                                      : RunLangton(job, arena, arena.grid, result);
+            arena.ants.Clear();
+            arena.ants.Add(ant.GetRow(), ant.GetCol(), ant.GetDirection());
+        }
+        else
+        {
+            if (job.infinitePlane)
+                arena.ants.StepMany(arena.plane, job.steps);
+            else if (langton)
+                arena.ants.StepMany(arena.grid, job.steps);
+            else
+                arena.ants.StepMany(arena.colors, job.rule, job.steps);
+            result.generation = job.steps;
+        }
+
+        if (job.infinitePlane)
+            result.population = arena.plane.CountAlive();
+        else if (langton)
+            result.population = arena.grid.CountAlive();
+        else
+        {
+            for (int r = 0; r < n; ++r)
+            {
+                const uint8_t* row = arena.colors.Row(r);
+                for (int c = 0; c < n; ++c)
+                    result.population += row[c] != 0;
+            }
+        }
+        result.row = arena.ants.GetRow(0);
+        result.col = arena.ants.GetCol(0);
+        result.direction = arena.ants.GetDirection(0);
+        result.ants = arena.ants.Size();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    // Writes result rows as the workers finish them, one at a time, flushing
+    // each so a long sweep can be watched (or cut short) without losing rows
+    class ResultSink
+    {
+    public:
+        ResultSink(std::FILE* file, Format format) : file(file), format(format) {}
+
+        void WriteHeader()
+        {
+            if (format == Format::Csv)
+            {
+                std::fprintf(file, "job,line,name,rule,size,plane,dir,pattern,seed,steps,generation,population,"
+                    "highway_period,highway_dr,highway_dc,highway_at,ants,row,col,facing,seconds\n");
+                std::fflush(file);
+            }
+        }
+
+        void Write(const Job& job, const std::vector<Pattern>& patterns, const Result& result)
+        {
+            const std::string pattern = job.pattern >= 0 ? patterns[job.pattern].path : std::string();
+            const std::string seed = job.randomFill ? std::to_string(job.seed) : std::string();
+            const std::string highwayAt = result.foundHighway ? std::to_string(result.highwayAt) : std::string();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (format == Format::Csv)
+            {
+                std::fprintf(file, "%zu,%d,%s,%s,%d,%d,%s,%s,%s,%llu,%llu,%llu,%d,%lld,%lld,%s,%zu,%lld,%lld,%s,%.6f\n",
+                    job.index, job.line, Csv(job.name).c_str(), Csv(job.ruleText).c_str(), job.size,
+                    job.infinitePlane ? 1 : 0, DirectionName(job.direction), Csv(pattern).c_str(), seed.c_str(),
+                    static_cast<unsigned long long>(job.steps), static_cast<unsigned long long>(result.generation),
+                    static_cast<unsigned long long>(result.population), result.period,
+                    static_cast<long long>(result.deltaRow), static_cast<long long>(result.deltaCol),
+                    highwayAt.c_str(), result.ants,
+                    static_cast<long long>(result.row), static_cast<long long>(result.col),
+                    DirectionName(result.direction), result.seconds);
+            }
+            else
+            {
+                std::fprintf(file, "{\"job\":%zu,\"line\":%d,\"name\":%s,\"rule\":%s,\"size\":%d,\"plane\":%s,\"dir\":\"%s\","
+                    "\"pattern\":%s,\"seed\":%s,\"steps\":%llu,\"generation\":%llu,\"population\":%llu,"
+                    "\"highway\":{\"period\":%d,\"dr\":%lld,\"dc\":%lld,\"at\":%s},\"ants\":%zu,"
+                    "\"row\":%lld,\"col\":%lld,\"facing\":\"%s\",\"seconds\":%.6f}\n",
+                    job.index, job.line, Json(job.name).c_str(), Json(job.ruleText).c_str(), job.size,
+                    job.infinitePlane ? "true" : "false", DirectionName(job.direction),
+                    pattern.empty() ? "null" : Json(pattern).c_str(), seed.empty() ? "null" : seed.c_str(),
+                    static_cast<unsigned long long>(job.steps), static_cast<unsigned long long>(result.generation),
+                    static_cast<unsigned long long>(result.population), result.period,
+                    static_cast<long long>(result.deltaRow), static_cast<long long>(result.deltaCol),
+                    highwayAt.empty() ? "null" : highwayAt.c_str(), result.ants,
+                    static_cast<long long>(result.row), static_cast<long long>(result.col),
+                    DirectionName(result.direction), result.seconds);
+            }
+            std::fflush(file);
+        }
+
+    private:
+        // Quoted when the text holds a comma, quote or line break
+        static std::string Csv(const std::string& text)
+        {
+            if (text.find_first_of(",\"\r\n") == std::string::npos)
+                return text;
+            std::string quoted = "\"";
+            for (char c : text)
+            {
+                if (c == '"')
+                    quoted += '"';
+                quoted += c;
+            }
+            return quoted + '"';
+        }
+
+        static std::string Json(const std::string& text)
+        {
+            std::string quoted = "\"";
+            for (char c : text)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    quoted += '\\';
+                    quoted += c;
+                }
+                else if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escape[8];
+                    std::snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned>(c));
+                    quoted += escape;
+                }
+                else
+                {
+                    quoted += c;
+                }
+            }
+            return quoted + '"';
+        }
+
+        std::FILE* file;
+        Format format;
+        std::mutex mutex;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    bool showHelp = false;
+    if (!ParseOptions(argc, argv, options, showHelp))
+    {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+    if (showHelp)
+    {
+        PrintUsage(argv[0]);
+        return 0;
+    }
+
+    std::vector<Job> jobs;
+    std::vector<Pattern> patterns;
+    if (!ReadManifest(options.manifestPath, jobs, patterns))
+        return 2;
+    if (jobs.empty())
+    {
+        std::fprintf(stderr, "No jobs in %s\n", options.manifestPath.c_str());
+        return 2;
+    }
+
+    std::FILE* file = stdout;
+    if (!options.outputPath.empty())
+    {
+        file = std::fopen(options.outputPath.c_str(), "w");
+        if (!file)
+        {
+            std::fprintf(stderr, "Failed to open %s for writing\n", options.outputPath.c_str());
+            return 1;
+        }
+    }
+
+    // Jobs are independent, so workers just take the next one until none are left
+    int threads = options.threads > 0 ? options.threads : static_cast<int>(std::thread::hardware_concurrency());
+    threads = std::clamp(threads, 1, static_cast<int>(std::min<size_t>(jobs.size(), 1024)));
+    ResultSink sink(file, options.format);
+    sink.WriteHeader();
+    std::atomic<size_t> next{ 0 };
+    auto work = [&]()
+    {
+        Arena arena;
+        for (size_t i = next.fetch_add(1); i < jobs.size(); i = next.fetch_add(1))
+            sink.Write(jobs[i], patterns, RunJob(jobs[i], patterns, arena));
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t)
+        workers.emplace_back(work);
+    work();
+    for (std::thread& worker : workers)
+        worker.join();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const bool written = std::ferror(file) == 0;
+    if (file != stdout)
+        std::fclose(file);
+    std::fprintf(stderr, "Ran %zu jobs on %d threads in %.3f s (%.1f jobs/s)\n", jobs.size(), threads, seconds,
+        seconds > 0.0 ? double(jobs.size()) / seconds : 0.0);
+    if (!written)
+    {
+        std::fprintf(stderr, "Failed to write the results to %s\n", options.outputPath.empty() ? "stdout" : options.outputPath.c_str());
+        return 1;
+    }
+    return 0;
+}
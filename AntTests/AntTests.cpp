@@ -0,0 +1,143 @@
+// Regression checks for engine behavior a run alone wouldn't show. Each test
+// prints its name and any check that failed; the exit code is the number of
+// tests that failed, so "make check" stops on the first bad build.
+//   anttests [NAME]   runs every test, or only those whose name contains NAME
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Checkpoint.h"
+#include "Grid.h"
+#include "UniverseIO.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    int failedChecks = 0;
+
+#define CHECK(condition)                                                           \
+    do                                                                             \
+    {                                                                              \
+        if (!(condition))                                                          \
+        {                                                                          \
+            std::printf("  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++failedChecks;                                                        \
+        }                                                                          \
+    } while (false)
+
+    // A directory of its own under the system's temporary one, emptied first
+    fs::path ScratchDirectory(const std::string& name)
+    {
+        const fs::path directory = fs::temp_directory_path() / ("anttests-" + name);
+        std::error_code error;
+        fs::remove_all(directory, error);
+        return directory;
+    }
+
+    std::vector<std::string> CheckpointsIn(const fs::path& directory)
+    {
+        std::vector<std::string> names;
+        std::error_code error;
+        for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+            names.push_back(it->path().filename().string());
+        return names;
+    }
+
+    // Hands one generation to the writer and waits until it's on disk, so none is replaced while waiting
+    void WriteCheckpoint(Checkpointer& checkpointer, uint64_t generation)
+    {
+        const uint64_t before = checkpointer.Written() + checkpointer.Failed();
+        UniverseState& state = checkpointer.Buffer();
+        CaptureCells(Grid(64, 64), state);
+        state.ants.Clear();
+        state.ants.Add(32, 32, 0);
+        state.info.generation = generation;
+        checkpointer.Submit();
+        while (checkpointer.Written() + checkpointer.Failed() == before)
+            std::this_thread::yield();
+    }
+
+    uint64_t GenerationOf(const std::string& path)
+    {
+        UniverseState state;
+        return ReadUniverse(path, state) ? state.info.generation : UINT64_MAX;
+    }
+
+    // A run restarted at a lower generation (a new run, a loaded file or a
+    // seek) writes the newest checkpoints, and pruning must keep them
+    void CheckpointRestartAtLowerGeneration()
+    {
+        const fs::path directory = ScratchDirectory("checkpoints");
+        CheckpointConfig config;
+        config.directory = directory.string();
+        config.keep = 3;
+
+        {
+            Checkpointer first(config);
+            for (uint64_t generation : { 3000000, 4000000, 5000000 })
+                WriteCheckpoint(first, generation);
+
+            // The worker starting over with the same writer
+            first.Restart(0);
+            WriteCheckpoint(first, 1000);
+            CHECK(first.Failed() == 0);
+        }
+        CHECK(CheckpointsIn(directory).size() == 3);
+        CHECK(GenerationOf(Checkpointer::FindLatest(config.directory)) == 1000);
+
+        // A second process in the same directory counts on from the first one's checkpoints
+        {
+            Checkpointer second(config);
+            for (uint64_t generation : { 1000000, 2000000 })
+                WriteCheckpoint(second, generation);
+            CHECK(second.Written() == 2);
+        }
+        CHECK(CheckpointsIn(directory).size() == 3);
+        CHECK(GenerationOf(Checkpointer::FindLatest(config.directory)) == 2000000);
+
+        // What's left are the three written last, whatever their generations
+        std::vector<uint64_t> kept;
+        for (const std::string& name : CheckpointsIn(directory))
+            kept.push_back(GenerationOf((directory / name).string()));
+        std::sort(kept.begin(), kept.end());
+        CHECK((kept == std::vector<uint64_t>{ 1000, 1000000, 2000000 }));
+
+        std::error_code error;
+        fs::remove_all(directory, error);
+    }
+
+    struct Test
+    {
+        const char* name;
+        void (*run)();
+    };
+
+    const Test kTests[] = {
+        { "checkpoint/restart_at_lower_generation", CheckpointRestartAtLowerGeneration },
+    };
+}
+
+int main(int argc, char** argv)
+{
+    const std::string filter = argc > 1 ? argv[1] : "";
+    int failedTests = 0;
+    int ran = 0;
+    for (const Test& test : kTests)
+    {
+        if (!filter.empty() && std::string(test.name).find(filter) == std::string::npos)
+            continue;
+        const int before = failedChecks;
+        test.run();
+        const bool passed = failedChecks == before;
+        std::printf("%-48s %s\n", test.name, passed ? "ok" : "FAILED");
+        failedTests += passed ? 0 : 1;
+        ++ran;
+    }
+    std::printf("%d of %d tests passed\n", ran - failedTests, ran);
+    return failedTests;
+}
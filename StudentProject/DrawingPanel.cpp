@@ -2,19 +2,29 @@
 // It draws the grid, handles mouse clicks, and runs the simulation steps.
 
 #include "DrawingPanel.h"
-#include "wx/dcbuffer.h"
-#include "wx/graphics.h"
+#include "wx/dcmemory.h"
 #include "LangtonsAnt.h"  // Includes the ant simulation logic
-#include <fstream>
+#include "UniverseIO.h"   // Pattern and universe file formats
+#include "NeighborCounts.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <sstream>
 
 
 // Paint, mouse click, and import pattern events to the corresponding functions
 wxBEGIN_EVENT_TABLE(DrawingPanel, wxPanel)
 EVT_PAINT(DrawingPanel::OnPaint)
+EVT_SIZE(DrawingPanel::OnSize)
 EVT_LEFT_DOWN(DrawingPanel::OnMouseClick)
+EVT_LEFT_UP(DrawingPanel::OnLeftUp)
+EVT_MOTION(DrawingPanel::OnMouseMove)
+EVT_MOUSEWHEEL(DrawingPanel::OnMouseWheel)
+EVT_RIGHT_DOWN(DrawingPanel::OnRightClick)
 EVT_MENU(ID_IMPORT_PATTERN, DrawingPanel::OnImportPattern)   // Added import pattern event
 EVT_MENU(ID_SAVE_UNIVERSE, DrawingPanel::OnSaveUniverse)    // Save universe event
+EVT_MENU(ID_LOAD_UNIVERSE, DrawingPanel::OnLoadUniverse)    // Load universe event
 wxEND_EVENT_TABLE()
 
 // Constructor  sets up grid, neighbor counts, and places the ant in the center
@@ -23,243 +33,704 @@ DrawingPanel::DrawingPanel(wxWindow* parent, const Settings& settingsRef)
 {
     SetBackgroundStyle(wxBG_STYLE_PAINT); // Enables smoother drawing
 
-    grid.resize(settings.gridSize, std::vector<bool>(settings.gridSize, false)); // All cells start off
-    neighborCounts.resize(settings.gridSize, std::vector<int>(settings.gridSize, 0)); // All counts zero
+    displayGrid = Grid(settings.gridSize, settings.gridSize); // All cells start off
+    // Counts start hidden; UpdateNeighborCounts sizes them once they are shown
+    CacheBrushes();
 
-    ant = new LangtonsAnt(settings.gridSize / 2, settings.gridSize / 2); // Ant starts in the center
+    // The worker owns the universe and the ant (which starts in the center)
+    worker = std::make_unique<SimulationWorker>(MakeConfig());
 }
 
 // Destructor  clean up memory
 DrawingPanel::~DrawingPanel()
 {
-    delete ant;
+    worker.reset(); // Stops and joins the simulation thread
 }
 
-// Paint event  handles all the drawing on the screen
+// Paint event  copies the invalidated part of the backing bitmap to the screen
 void DrawingPanel::OnPaint(wxPaintEvent& event)
 {
-    wxAutoBufferedPaintDC dc(this);  // Prevents flickering
-    dc.Clear();
+    ANT_PERF_SCOPE(Paint);
+    ANT_TRACE_SCOPE("OnPaint");
+    wxPaintDC dc(this);
+
+    // The backing bitmap holds every visible cell; rebuild it only when it went stale
+    wxSize size = GetClientSize();
+    if (!backBufferValid || backBuffer.GetWidth() != size.GetWidth() ||
+        backBuffer.GetHeight() != size.GetHeight())
+    {
+        // Until the user zooms or pans, the camera keeps the whole universe in the window
+        if (cameraFitted)
+            camera.Fit(settings.gridSize, settings.gridSize, size.GetWidth(), size.GetHeight());
+
+        if (DrawsPixels())
+            RenderPixels(size);
+        else
+            RenderBackBuffer(size);
+    }
 
-    wxGraphicsContext* gc = wxGraphicsContext::Create(dc); // Use graphics context for smooth shapes
-    if (!gc) return;
+    // Blit just the region that was invalidated with RefreshRect
+    wxRect box = GetUpdateRegion().GetBox();
+    wxMemoryDC memDC;
+    memDC.SelectObjectAsSource(backBuffer);
+    dc.Blit(box.x, box.y, box.width, box.height, &memDC, box.x, box.y);
 
-    wxSize size = GetSize();
-    float cellWidth = static_cast<float>(size.GetWidth()) / settings.gridSize;
-    float cellHeight = static_cast<float>(size.GetHeight()) / settings.gridSize;
+    // HUD Drawing
+    if (settings.ShowHUD)  // ShowHUD controls if HUD is displayed
+        DrawHUD(dc);
+}
 
-    // Loop through the grid and draw each cell
-    for (int row = 0; row < settings.gridSize; ++row)
-    {
-        for (int col = 0; col < settings.gridSize; ++col)
-        {
-            // Pick color based on if the cell is alive or dead
-            wxBrush brush = grid[row][col]
-                ? wxBrush(settings.GetLivingCellColor())
-                : wxBrush(settings.GetDeadCellColor());
+// Cell rectangles are only drawn while they are big enough to see; past that
+// (or when the setting asks for it) the pixel renderer takes over
+bool DrawingPanel::DrawsPixels() const
+{
+    return settings.pixelRenderer || camera.Scale() < kMinCellPixels;
+}
 
-            gc->SetBrush(brush);
-            gc->DrawRectangle(col * cellWidth, row * cellHeight, cellWidth, cellHeight);
+// Draws the visible cells into the backing bitmap
+void DrawingPanel::RenderBackBuffer(const wxSize& size)
+{
+    backBuffer.Create(std::max(size.GetWidth(), 1), std::max(size.GetHeight(), 1));
 
-            // If neighbor counts are shown, draw them in red
-            if (showNeighborCount && neighborCounts[row][col] > 0)
-            {
-                wxString text = wxString::Format("%d", neighborCounts[row][col]);
-                dc.SetFont(wxFontInfo(16));
-                dc.SetTextForeground(*wxRED);
+    wxMemoryDC memDC(backBuffer);
+    memDC.SetPen(*wxTRANSPARENT_PEN);
 
-                int textWidth, textHeight;
-                dc.GetTextExtent(text, &textWidth, &textHeight);
+    // Fill the area past the universe's edge, then the universe with the dead
+    // color; only living (nonzero color) cells need a rectangle after that
+    memDC.SetBrush(outsideBrush);
+    memDC.DrawRectangle(0, 0, backBuffer.GetWidth(), backBuffer.GetHeight());
 
-                int x = static_cast<int>(col * cellWidth + (cellWidth - textWidth) / 2);
-                int y = static_cast<int>(row * cellHeight + (cellHeight - textHeight) / 2);
+    const CellRange visible = camera.Visible(backBuffer.GetWidth(), backBuffer.GetHeight(), settings.gridSize, settings.gridSize);
+    if (visible.Empty())
+    {
+        backBufferValid = true;
+        return;
+    }
+    const wxRect topLeft = CellRect(static_cast<int>(visible.row0), static_cast<int>(visible.col0));
+    const wxRect bottomRight = CellRect(static_cast<int>(visible.row1 - 1), static_cast<int>(visible.col1 - 1));
+    memDC.SetBrush(cellBrushes[0]);
+    memDC.DrawRectangle(topLeft.Union(bottomRight));
 
-                dc.DrawText(text, x, y);
+    for (int row = static_cast<int>(visible.row0); row < visible.row1; ++row)
+    {
+        for (int col = static_cast<int>(visible.col0); col < visible.col1; ++col)
+        {
+            if (CellAlive(row, col) || (showNeighborCount && neighborCounts[size_t(row) * settings.gridSize + col] > 0))
+            {
+                DrawCell(memDC, row, col);
+                ANT_PERF_ADD(PaintedCells, 1);
             }
         }
     }
 
-    // HUD Drawing
-    if (settings.ShowHUD)  // ShowHUD controls if HUD is displayed
+    backBufferValid = true;
+}
+
+// Renders the visible part of the universe as an image and turns it into
+// the backing bitmap in one conversion
+void DrawingPanel::RenderPixels(const wxSize& size)
+{
+    const int width = std::max(size.GetWidth(), 1);
+    const int height = std::max(size.GetHeight(), 1);
+
+    pixels.resize(size_t(width) * height * 3);
+    if (displayColors.Rows() > 0)
     {
-        // Set font size, bold, color 
-        dc.SetFont(wxFontInfo(16).Bold());
-        dc.SetTextForeground(*wxRED);
+        pixelRenderer.Render(displayColors, camera, width, height, pixels.data());
+    }
+    else
+    {
+        // Zoomed far out, pixels are shaded from the density pyramid; it is
+        // built on first use after a full snapshot and then kept up to date
+        if (!pyramidValid && camera.Scale() * PixelRenderer::kPyramidCellsPerPixel <= 1.0)
+        {
+            pyramid.Build(displayGrid);
+            pyramidValid = true;
+        }
+        pixelRenderer.Render(displayGrid, camera, width, height, pixels.data(), pyramidValid ? &pyramid : nullptr);
+    }
+#if ANT_PERF
+    const CellRange visible = camera.Visible(width, height, settings.gridSize, settings.gridSize);
+    if (!visible.Empty())
+        ANT_PERF_ADD(PaintedCells, uint64_t(visible.row1 - visible.row0) * uint64_t(visible.col1 - visible.col0));
+#endif
+
+    wxImage image(width, height, pixels.data(), true); // Borrows the buffer instead of copying it
+    backBuffer = wxBitmap(image);
+    backBufferValid = true;
+}
 
-        wxString hudText;
-        // Add universe size info (grid size)
-        hudText << "Universe Size: " << settings.gridSize;
+// Draws one cell (and its neighbor count, if shown) with the cached brushes
+void DrawingPanel::DrawCell(wxDC& dc, int row, int col)
+{
+    const wxRect rect = CellRect(row, col);
+
+    // Pick the brush for the cell's color (dead, living, or a turmite color)
+    dc.SetBrush(cellBrushes[CellColor(row, col)]);
+    dc.DrawRectangle(rect);
+
+    // If neighbor counts are shown, draw them in red
+    const int neighbors = showNeighborCount ? neighborCounts[size_t(row) * settings.gridSize + col] : 0;
+    if (neighbors > 0)
+    {
+        wxString text = wxString::Format("%d", neighbors);
+        dc.SetFont(wxFontInfo(16));
+        dc.SetTextForeground(*wxRED);
 
         int textWidth, textHeight;
-        dc.GetTextExtent(hudText, &textWidth, &textHeight);
+        dc.GetTextExtent(text, &textWidth, &textHeight);
 
-        // Position at lower left corner, with a small margin
-        int margin = 10;
-        int x = margin;
-        int y = size.GetHeight() - textHeight - margin;
+        int x = rect.x + (rect.width - textWidth) / 2;
+        int y = rect.y + (rect.height - textHeight) / 2;
 
-        dc.DrawText(hudText, x, y);
+        dc.DrawText(text, x, y);
     }
-
-    delete gc;
 }
 
-// Steps the simulation forward and redraws
-void DrawingPanel::StepSimulation()
+// Pixel rectangle of a cell; edges are floored so neighboring cells never overlap or leave gaps
+wxRect DrawingPanel::CellRect(int row, int col) const
 {
-    ant->Step(grid);           // Move the ant and update the grid
-    UpdateNeighborCounts();    // Update neighbor numbers
-    Refresh();                 // Trigger a redraw
+    const int x0 = static_cast<int>(std::floor(camera.XOf(col)));
+    const int x1 = static_cast<int>(std::floor(camera.XOf(col + 1.0)));
+    const int y0 = static_cast<int>(std::floor(camera.YOf(row)));
+    const int y1 = static_cast<int>(std::floor(camera.YOf(row + 1.0)));
+    return wxRect(x0, y0, x1 - x0, y1 - y0);
 }
 
-// Clears everything and resets the ant
-void DrawingPanel::ClearGrid()
+// Redraws the changed cells into the backing bitmap and invalidates only their rectangles
+void DrawingPanel::InvalidateCells(const std::vector<CellChange>& changes)
 {
-    for (auto& row : grid)
-        std::fill(row.begin(), row.end(), false); // Turn off all cells
+    if (!backBufferValid || DrawsPixels())
+    {
+        InvalidateAll();
+        return;
+    }
+
+    wxMemoryDC memDC(backBuffer);
+    memDC.SetPen(*wxTRANSPARENT_PEN);
+
+    // A flip also changes the counts shown in the 8 neighbors; cells out of view are skipped
+    const int reach = showNeighborCount ? 1 : 0;
+    const CellRange visible = camera.Visible(backBuffer.GetWidth(), backBuffer.GetHeight(), settings.gridSize, settings.gridSize);
+
+    wxRect dirty;
+    for (const CellChange& change : changes)
+    {
+        for (int64_t r = change.row - reach; r <= change.row + reach; ++r)
+        {
+            for (int64_t c = change.col - reach; c <= change.col + reach; ++c)
+            {
+                if (r < visible.row0 || r >= visible.row1 || c < visible.col0 || c >= visible.col1)
+                    continue;
+
+                DrawCell(memDC, static_cast<int>(r), static_cast<int>(c));
+                ANT_PERF_ADD(PaintedCells, 1);
+                const wxRect rect = CellRect(static_cast<int>(r), static_cast<int>(c));
+                dirty = dirty.IsEmpty() ? rect : dirty.Union(rect);
+            }
+        }
+    }
 
-    delete ant;
-    ant = new LangtonsAnt(settings.gridSize / 2, settings.gridSize / 2); // Reset ant to center
+    // One bounding rectangle per batch; the blit in OnPaint is cheap compared to the drawing
+    if (!dirty.IsEmpty())
+        RefreshRect(dirty, false);
 
-    for (auto& row : neighborCounts)
-        std::fill(row.begin(), row.end(), 0); // Clear neighbor counts
+    // The HUD sits on top of the cells, so repaint it as well
+    if (settings.ShowHUD)
+        RefreshRect(hudRect, false);
+}
 
-    Refresh();
+// Throws away the backing bitmap and repaints everything
+void DrawingPanel::InvalidateAll()
+{
+    backBufferValid = false;
+    Refresh(false);
 }
 
-// Handles mouse click  toggles cell state
-void DrawingPanel::OnMouseClick(wxMouseEvent& event)
+// Rebuilds the brushes after a color change instead of once per cell
+void DrawingPanel::CacheBrushes()
 {
-    wxSize size = GetSize();
-    int cellWidth = size.GetWidth() / settings.gridSize;
-    int cellHeight = size.GetHeight() / settings.gridSize;
+    cellBrushes.clear();
+    for (int color = 0; color < kMaxTurmiteColors; ++color)
+        cellBrushes.push_back(wxBrush(settings.GetCellColor(color)));
 
-    int col = event.GetX() / cellWidth;
-    int row = event.GetY() / cellHeight;
+    // Past the universe's edge: a shade darker than dead cells, as the pixel renderer draws it
+    const wxColour dead = settings.GetDeadCellColor();
+    outsideBrush = wxBrush(wxColour(dead.Red() * 3 / 4, dead.Green() * 3 / 4, dead.Blue() * 3 / 4));
 
-    if (row >= 0 && row < settings.gridSize && col >= 0 && col < settings.gridSize)
+    pixelRenderer.SetColors(settings.livingCellRed, settings.livingCellGreen, settings.livingCellBlue,
+        settings.deadCellRed, settings.deadCellGreen, settings.deadCellBlue);
+    for (int color = 2; color < kMaxTurmiteColors; ++color)
     {
-        grid[row][col] = !grid[row][col]; // Flip the cell state
-        UpdateNeighborCounts();           // Update neighbors accordingly
-        Refresh();
+        const wxColour c = settings.GetCellColor(color);
+        pixelRenderer.SetPaletteColor(color, c.Red(), c.Green(), c.Blue());
     }
 }
 
-// Updates settings when changed and resets the grid and ant
-void DrawingPanel::UpdateSettings(const Settings& newSettings)
+void DrawingPanel::OnSize(wxSizeEvent& event)
 {
-    settings = newSettings;
-    grid.resize(settings.gridSize, std::vector<bool>(settings.gridSize, false));
-    neighborCounts.resize(settings.gridSize, std::vector<int>(settings.gridSize, 0));
+    InvalidateAll();  // A fitted camera depends on the panel size
+    event.Skip();
+}
 
-    delete ant;
-    ant = new LangtonsAnt(settings.gridSize / 2, settings.gridSize / 2);
+// Shows the whole universe again and lets the camera follow the window size
+void DrawingPanel::ZoomToFit()
+{
+    cameraFitted = true;
+    InvalidateAll();
+}
 
-    Refresh();
+void DrawingPanel::SetFollowAnt(bool follow)
+{
+    followAnt = follow;
+    FollowAnt();
 }
 
-// Loops through each cell and counts how many living neighbors it has
-void DrawingPanel::UpdateNeighborCounts()
+// Recenters on the first ant once it leaves the middle half of the view, so
+// most frames keep their incremental redraw
+void DrawingPanel::FollowAnt()
 {
-    int n = settings.gridSize;
+    if (!followAnt || antCount == 0)
+        return;
+
+    const wxSize size = GetClientSize();
+    const double x = camera.XOf(antCol + 0.5);
+    const double y = camera.YOf(antRow + 0.5);
+    if (x >= size.GetWidth() / 4.0 && x <= size.GetWidth() * 0.75 && y >= size.GetHeight() / 4.0 && y <= size.GetHeight() * 0.75)
+        return;
+
+    camera.CenterOn(antRow + 0.5, antCol + 0.5, size.GetWidth(), size.GetHeight());
+    cameraFitted = false;
+    InvalidateAll();
+}
+
+#if ANT_PERF
+// 1234567 -> "1.23M"
+static wxString FormatCount(double value)
+{
+    if (value >= 1e9)
+        return wxString::Format("%.2fG", value / 1e9);
+    if (value >= 1e6)
+        return wxString::Format("%.2fM", value / 1e6);
+    if (value >= 1e4)
+        return wxString::Format("%.1fk", value / 1e3);
+    return wxString::Format("%.0f", value);
+}
 
-    for (int row = 0; row < n; ++row)
+// What the panel itself holds besides the worker's universe
+uint64_t DrawingPanel::ViewMemoryBytes() const
+{
+    uint64_t bytes = displayGrid.SizeBytes() + displayColors.SizeBytes() + neighborCounts.capacity() * sizeof(int)
+        + pixels.capacity() + pyramid.MemoryBytes();
+    if (backBuffer.IsOk())
+        bytes += uint64_t(backBuffer.GetWidth()) * backBuffer.GetHeight() * 4;  // 32-bit pixels
+    return bytes;
+}
+#endif
+
+// Draws the HUD in the lower left corner
+void DrawingPanel::DrawHUD(wxDC& dc)
+{
+    // Set font size, bold, color 
+    dc.SetFont(wxFontInfo(16).Bold());
+    dc.SetTextForeground(*wxRED);
+
+    wxString hudText;
+    // Add universe size info (grid size)
+    hudText << "Universe Size: " << settings.gridSize;
+    if (displayColors.Rows() > 0)
+        hudText << "   Rule: " << settings.rule;
+    if (antCount != 1)
+        hudText << "   Ants: " << antCount;
+
+#if ANT_PERF
+    // Performance counters over the last second (Debug builds only)
+    const size_t frame = size_t(PerfPhase::Frame);
+    hudText << "\nSteps/s: " << FormatCount(perfReport.stepsPerSecond)
+        << wxString::Format("   Frame p50/p99: %.1f/%.1f ms", perfReport.p50[frame], perfReport.p99[frame])
+        << "   Cells/frame: " << FormatCount(perfReport.cellsPerFrame)
+        << wxString::Format("   Memory: %.1f MB", double(perfReport.memoryBytes) / (1024.0 * 1024.0));
+
+    static const char* const phaseNames[] = { "Step", "Neighbors", "Paint", "I/O" };
+    hudText << "\np50/p99 ms ";
+    for (size_t phase = 0; phase < size_t(PerfPhase::Frame); ++phase)
     {
-        for (int col = 0; col < n; ++col)
-        {
-            int count = 0;
-            for (int dr = -1; dr <= 1; ++dr)
-            {
-                for (int dc = -1; dc <= 1; ++dc)
-                {
-                    if (dr == 0 && dc == 0)
-                        continue;
+        hudText << "  " << phaseNames[phase] << ": ";
+        if (perfReport.samples[phase] > 0)
+            hudText << wxString::Format("%.2f/%.2f", perfReport.p50[phase], perfReport.p99[phase]);
+        else
+            hudText << "-";
+    }
+#endif
 
-                    int r = row + dr;
-                    int c = col + dc;
+    int textWidth, textHeight;
+    dc.GetMultiLineTextExtent(hudText, &textWidth, &textHeight);
 
-                    if (r >= 0 && r < n && c >= 0 && c < n && grid[r][c])
-                        count++;
-                }
-            }
-            neighborCounts[row][col] = count;
-        }
+    // Position at lower left corner, with a small margin
+    int margin = 10;
+    int x = margin;
+    int y = GetClientSize().GetHeight() - textHeight - margin;
+
+    dc.DrawText(hudText, x, y);
+    hudRect = wxRect(x, y, textWidth, textHeight);
+}
+
+void DrawingPanel::UpdatePerfHUD()
+{
+#if ANT_PERF
+    const auto now = std::chrono::steady_clock::now();
+    if (now - perfSampled < std::chrono::seconds(1))
+        return;
+    perfSampled = now;
+    ANT_PERF_MEMORY(View, ViewMemoryBytes());
+    perfReport = perfSampler.Sample();
+
+    // The HUD's lines change width, so repaint the whole strip they sit in
+    if (settings.ShowHUD)
+    {
+        const wxSize size = GetClientSize();
+        RefreshRect(wxRect(0, hudRect.y, size.GetWidth(), size.GetHeight() - hudRect.y), false);
     }
+#endif
 }
 
-// Enables or disables the neighbor count display
-void DrawingPanel::SetShowNeighborCount(bool show)
+// Queues a batch of steps on the simulation thread
+void DrawingPanel::StepSimulation(uint64_t steps)
 {
-    showNeighborCount = show;
-    Refresh(); // Redraw to reflect change
+    ANT_TRACE_SCOPE("StepSimulation");
+    worker->Step(steps);
 }
 
-// Import a pattern from file and place it centered on the existing grid without resizing
-bool DrawingPanel::ImportPatternFromFile(const wxString& filename)
+void DrawingPanel::Play()
+{
+    worker->Play();
+}
+
+void DrawingPanel::Pause()
+{
+    worker->Pause();
+}
+
+bool DrawingPanel::IsRunning() const
+{
+    return worker->IsRunning();
+}
+
+uint64_t DrawingPanel::GetGenerationCount() const
+{
+    return worker->Generation();
+}
+
+// Queues steps of the inverse rule; the ant won't go back past the last edit
+void DrawingPanel::StepBack(uint64_t steps)
+{
+    ANT_TRACE_SCOPE("StepBack");
+    worker->StepBack(steps);
+}
+
+void DrawingPanel::SeekTo(uint64_t generation)
+{
+    worker->Seek(generation);
+}
+
+bool DrawingPanel::CanRewind() const
+{
+    return worker->CanRewind();
+}
+
+uint64_t DrawingPanel::GetTimelineStart() const
+{
+    return worker->TimelineStart();
+}
+
+uint64_t DrawingPanel::GetTimelineEnd() const
 {
-    std::ifstream file(filename.ToStdString());
-    if (!file.is_open())
+    return worker->TimelineEnd();
+}
+
+// Takes the newest snapshot from the worker (if any) and redraws what it changed.
+// Called at display rate from the main window's frame timer.
+bool DrawingPanel::ConsumeSnapshot()
+{
+    if (!worker->ConsumeSnapshot())
         return false;
+    ANT_TRACE_SCOPE("ConsumeSnapshot");
+    ANT_PERF_FRAME();
+
+    const SimulationSnapshot& snapshot = worker->Snapshot();
+    if (snapshot.antCount != antCount && settings.ShowHUD)
+        RefreshRect(hudRect, false);
+    antCount = snapshot.antCount;
+    antRow = snapshot.antRow;
+    antCol = snapshot.antCol;
+
+    // Once per failing stretch; the worker keeps trying at every interval
+    if (snapshot.checkpointFailing && !checkpointWarned)
+    {
+        CallAfter([] { wxMessageBox(wxString::Format("Failed to write a checkpoint to the \"%s\" folder. "
+            "Checkpoints will be retried while the simulation runs.", kCheckpointDirectory), "Error", wxOK | wxICON_ERROR); });
+    }
+    checkpointWarned = snapshot.checkpointFailing;
 
-    std::vector<std::vector<bool>> pattern;
-    std::string line;
-    while (std::getline(file, line))
+    if (snapshot.full)
     {
-        std::vector<bool> rowPattern;
-        for (char ch : line)
+        // Too much changed to log (or the universe was reloaded): take the whole view
+        if (snapshot.cells.Rows() == displayGrid.Rows() && snapshot.cells.Cols() == displayGrid.Cols())
         {
-            if (ch == '1' || ch == 'X' || ch == '*')
-                rowPattern.push_back(true);
-            else if (ch == '0' || ch == '.' || ch == ' ')
-                rowPattern.push_back(false);
-            // Ignore other characters
+            displayGrid = snapshot.cells;
+            displayColors = snapshot.colors;  // Empty unless a turmite rule is running
         }
-        if (!rowPattern.empty())
-            pattern.push_back(rowPattern);
+        UpdateNeighborCounts();
+        pyramidValid = false;  // Rebuilt when a zoomed-out frame needs it
+        InvalidateAll();
+    }
+    else
+    {
+        // Replay the change log: the snapshots chain, so this is exact
+        {
+            ANT_PERF_SCOPE(Neighbors);
+            const int n = settings.gridSize;
+            for (const CellChange& change : snapshot.changes)
+            {
+                if (change.row < 0 || change.row >= n || change.col < 0 || change.col >= n)
+                    continue;
+                displayGrid.Set(static_cast<int>(change.row), static_cast<int>(change.col), change.alive);
+                ApplyNeighborChange(change.row, change.col, change.alive);
+                if (pyramidValid)
+                    pyramid.Add(change.row, change.col, change.alive ? 1 : -1);
+            }
+        }
+        InvalidateCells(snapshot.changes);  // Repaint only the flipped cells
+    }
+    FollowAnt();
+
+#ifdef _DEBUG
+    if (showNeighborCount)
+        VerifyNeighborCounts();
+#endif
+    return true;
+}
+
+// Clears everything and resets the ant
+void DrawingPanel::ClearGrid()
+{
+    worker->Clear(); // The cleared view arrives with the next snapshot
+}
+
+// Handles mouse press  starts a click, or a drag once the mouse moves far enough
+void DrawingPanel::OnMouseClick(wxMouseEvent& event)
+{
+    leftDown = true;
+    dragging = false;
+    dragOrigin = event.GetPosition();
+    dragLast = dragOrigin;
+}
+
+// A release that wasn't a drag toggles the cell under the mouse
+void DrawingPanel::OnLeftUp(wxMouseEvent& event)
+{
+    const bool click = leftDown && !dragging;
+    leftDown = false;
+    dragging = false;
+
+    int row, col;
+    if (click && CellAt(event.GetPosition(), row, col))
+    {
+        worker->FlipCell(row, col);       // Flip the cell state; the change comes back in the next snapshot
+    }
+}
+
+// Dragging with the left button pans the view
+void DrawingPanel::OnMouseMove(wxMouseEvent& event)
+{
+    if (!leftDown || !event.LeftIsDown())
+    {
+        leftDown = false;
+        dragging = false;
+        return;
+    }
+
+    const wxPoint position = event.GetPosition();
+    if (!dragging)
+    {
+        const wxPoint moved = position - dragOrigin;
+        if (std::abs(moved.x) < kDragThreshold && std::abs(moved.y) < kDragThreshold)
+            return;
+        dragging = true;
     }
-    file.close();
 
-    if (pattern.empty())
+    camera.Pan(position.x - dragLast.x, position.y - dragLast.y);
+    dragLast = position;
+    cameraFitted = false;
+    InvalidateAll();
+}
+
+// The wheel zooms around the point under the mouse
+void DrawingPanel::OnMouseWheel(wxMouseEvent& event)
+{
+    if (event.GetWheelRotation() == 0 || event.GetWheelDelta() == 0)
+        return;
+
+    const double notches = double(event.GetWheelRotation()) / event.GetWheelDelta();
+    camera.ZoomAt(std::pow(kZoomStep, notches), event.GetX(), event.GetY());
+    cameraFitted = false;
+    InvalidateAll();
+}
+
+// Handles right click  adds an ant facing up, or removes the one already there
+void DrawingPanel::OnRightClick(wxMouseEvent& event)
+{
+    int row, col;
+    if (CellAt(event.GetPosition(), row, col))
+        worker->ToggleAnt(row, col);
+}
+
+bool DrawingPanel::CellAt(const wxPoint& position, int& row, int& col) const
+{
+    // Same camera as the drawing, so clicks land on the cell drawn under the
+    // mouse, even when cells are smaller than a pixel
+    int64_t cellRow, cellCol;
+    if (!camera.CellAt(position.x, position.y, settings.gridSize, settings.gridSize, cellRow, cellCol))
         return false;
+    row = static_cast<int>(cellRow);
+    col = static_cast<int>(cellCol);
+    return true;
+}
+
+// Applies new settings. A new size keeps the universe and the ants (the worker
+// moves them); only a new rule or plane mode starts over with a centered ant.
+void DrawingPanel::UpdateSettings(const Settings& newSettings)
+{
+    // The revisions say what changed: nothing, only colors and timing, or the universe itself
+    if (newSettings.revision == settings.revision)
+        return;
+    const bool rebuild = newSettings.universeRevision != settings.universeRevision;
+    const bool restart = rebuild
+        && (newSettings.infinitePlane != settings.infinitePlane || std::strcmp(newSettings.rule, settings.rule) != 0);
 
-    int patternRows = static_cast<int>(pattern.size());
-    int patternCols = static_cast<int>(pattern[0].size());
+    settings = newSettings;
+    CacheBrushes();
+    if (rebuild)
+    {
+        displayGrid.Resize(settings.gridSize, settings.gridSize);
+        UpdateNeighborCounts();  // Sizes the counts only while they are shown
+        pyramidValid = false;
+    }
 
-    int gridSize = settings.gridSize;
+    worker->Configure(MakeConfig(), restart);  // A restart also puts the ant back in the center
 
-    // Calculate top-left corner to center the pattern in the grid
-    int startRow = (gridSize - patternRows) / 2;
-    int startCol = (gridSize - patternCols) / 2;
+    InvalidateAll();
+}
 
-    // Clear current grid cells that will be overwritten
-    for (int r = 0; r < gridSize; ++r)
+// Rebuilds every neighbor count from scratch
+void DrawingPanel::UpdateNeighborCounts()
+{
+    // Counts are only kept while they are on screen; large grids would pay
+    // gridSize^2 ints and a full rebuild on every load for nothing otherwise.
+    // Hidden counts give their memory back (clear would keep the capacity).
+    if (!showNeighborCount)
     {
-        for (int c = 0; c < gridSize; ++c)
-        {
-            if (r >= startRow && r < startRow + patternRows &&
-                c >= startCol && c < startCol + patternCols)
-            {
-                grid[r][c] = false; // reset before importing
-            }
-        }
+        std::vector<int>().swap(neighborCounts);
+        return;
     }
+    ANT_PERF_SCOPE(Neighbors);
+    CountNeighbors(displayGrid, neighborCounts);
+}
+
+// A flipped cell changes the count of each of its 8 neighbors by one
+void DrawingPanel::ApplyNeighborChange(int64_t row, int64_t col, bool alive)
+{
+    if (!showNeighborCount)
+        return;
 
-    // Copy pattern into grid without resizing grid
-    for (int r = 0; r < patternRows; ++r)
+    const int n = settings.gridSize;
+    const int delta = alive ? 1 : -1;
+
+    for (int64_t r = row - 1; r <= row + 1; ++r)
     {
-        for (int c = 0; c < patternCols; ++c)
+        if (r < 0 || r >= n)
+            continue;
+        for (int64_t c = col - 1; c <= col + 1; ++c)
         {
-            int gridR = startRow + r;
-            int gridC = startCol + c;
-            if (gridR >= 0 && gridR < gridSize && gridC >= 0 && gridC < gridSize)
-            {
-                grid[gridR][gridC] = pattern[r][c];
-            }
+            if (c < 0 || c >= n || (r == row && c == col))
+                continue;
+            neighborCounts[r * n + c] += delta;
         }
     }
+}
+
+// Compares the incrementally maintained counts with a full recount
+void DrawingPanel::VerifyNeighborCounts() const
+{
+    std::vector<int> expected;
+    CountNeighbors(displayGrid, expected);
+    wxASSERT_MSG(expected == neighborCounts, "Incremental neighbor counts are out of sync");
+}
+
+// Reads a cell of the displayed view (the latest snapshot)
+bool DrawingPanel::CellAlive(int row, int col) const
+{
+    return displayGrid.Get(row, col);
+}
+
+int DrawingPanel::CellColor(int row, int col) const
+{
+    if (displayColors.Rows() > 0)
+        return displayColors.Row(row)[col] % kMaxTurmiteColors;
+    return displayGrid.Get(row, col) ? 1 : 0;
+}
 
+// Worker settings derived from the panel settings
+SimulationConfig DrawingPanel::MakeConfig() const
+{
+    SimulationConfig config;
+    config.gridSize = settings.gridSize;
+    config.resizeCentered = settings.resizeCentered;
+    config.infinitePlane = settings.infinitePlane;
+    config.stepsPerBatch = settings.stepsPerFrame;
+    config.intervalMs = settings.intervalMs;
+    if (!ParseTurmiteRule(settings.rule, config.rule))
+        config.rule = TurmiteRule();  // Unreadable rule in the settings file: fall back to Langton's ant
+
+    // The change log feeds the neighbor counts and the dirty cells of the
+    // cell renderer; the pixel renderer redraws everything anyway
+    config.trackChanges = showNeighborCount || !settings.pixelRenderer;
+
+    config.checkpointDirectory = kCheckpointDirectory;
+    config.checkpointSeconds = settings.checkpointSeconds;
+    return config;
+}
+
+// Enables or disables the neighbor count display
+void DrawingPanel::SetShowNeighborCount(bool show)
+{
+    showNeighborCount = show;
     UpdateNeighborCounts();
-    Refresh();
+    worker->Configure(MakeConfig(), false);
+    InvalidateAll(); // Redraw to reflect change
+}
+
+// Import a pattern from file and place it centered on the existing grid without resizing
+bool DrawingPanel::ImportPatternFromFile(const wxString& filename)
+{
+    ANT_TRACE_SCOPE("ImportPatternFromFile");
+    Grid patternGrid;
+    std::vector<AntPlacement> patternAnts;  // Ant markers (^ > v <) in the file
+    if (!ReadPattern(filename.ToStdString(), patternGrid, patternAnts))
+        return false;
+
+    int patternRows = patternGrid.Rows();
+    int patternCols = patternGrid.Cols();
+
+    int gridSize = settings.gridSize;
+
+    // Calculate top-left corner to center the pattern in the grid
+    int startRow = (gridSize - patternRows) / 2;
+    int startCol = (gridSize - patternCols) / 2;
+
+    // Stamping writes dead cells too, which clears the target area.
+    // Copy pattern into grid without resizing grid (clipped to the grid by the worker)
+    worker->Stamp(patternGrid, patternAnts, startRow, startCol);
 
     return true;
 }
@@ -268,7 +739,7 @@ bool DrawingPanel::ImportPatternFromFile(const wxString& filename)
 void DrawingPanel::OnImportPattern(wxCommandEvent& event)
 {
     wxFileDialog openFileDialog(this, _("Open Pattern file"), "", "",
-        "Pattern files (*.txt;*.pattern)|*.txt;*.pattern|All files (*.*)|*.*",
+        "Pattern files (*.txt;*.pattern;*.cells;*.rle)|*.txt;*.pattern;*.cells;*.rle|All files (*.*)|*.*",
         wxFD_OPEN | wxFD_FILE_MUST_EXIST);
 
     if (openFileDialog.ShowModal() == wxID_CANCEL)
@@ -290,25 +761,65 @@ void DrawingPanel::OnSaveUniverse(wxCommandEvent& event)
     SaveUniverse(saveFileDialog.GetPath());
 }
 
-// Saves the current grid to the specified file path
-bool DrawingPanel::SaveUniverse(const wxString& filePath)
+// Handles menu command to load a universe saved earlier
+void DrawingPanel::OnLoadUniverse(wxCommandEvent& event)
 {
-    std::ofstream file(filePath.ToStdString(), std::ios::binary);
-    if (!file.is_open())
-        return false;
+    wxFileDialog openFileDialog(this, _("Open Universe file"), "", "",
+        "Universe files (*.uni)|*.uni|All files (*.*)|*.*",
+        wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+
+    if (openFileDialog.ShowModal() == wxID_CANCEL)
+        return;
 
-    int n = settings.gridSize;
-    file.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    if (!LoadUniverse(openFileDialog.GetPath()))
+        wxMessageBox("Failed to load universe from file.", "Error", wxOK | wxICON_ERROR);
+}
 
-    for (int row = 0; row < n; ++row)
+// Saves the universe to the specified file path
+void DrawingPanel::SaveUniverse(const wxString& filePath)
+{
+    ANT_TRACE_SCOPE("SaveUniverse");
+    // The worker owns the ants and the generation, so it writes the file.
+    // It calls back on its own thread; CallAfter brings the result to the UI.
+    worker->Save(filePath.ToStdString(), [this](bool saved)
     {
-        for (int col = 0; col < n; ++col)
-        {
-            char cell = grid[row][col] ? 1 : 0;
-            file.write(&cell, sizeof(cell));
-        }
-    }
-    file.close();
+        if (!saved)
+            CallAfter([] { wxMessageBox("Failed to save universe to file.", "Error", wxOK | wxICON_ERROR); });
+    });
+}
+
+// Replaces the universe with a saved one, taking its rule and size
+bool DrawingPanel::LoadUniverse(const wxString& filePath)
+{
+    ANT_TRACE_SCOPE("LoadUniverse");
+    UniverseState universe;
+    if (!ReadUniverse(filePath.ToStdString(), universe))
+        return false;
+
+    const int rows = std::max(universe.cells.Rows(), universe.colors.Rows());
+    const int cols = std::max(universe.cells.Cols(), universe.colors.Cols());
+    const std::string rule = universe.info.rule.ToString();
+    if (rule.size() >= sizeof(settings.rule))
+        return false;
+    if (!universe.info.infinitePlane && (rows == 0 || rows != cols))
+        return false;  // The panel only shows square grids
+
+    const Settings before = settings;
+    if (!universe.info.infinitePlane)
+        settings.gridSize = rows;
+    settings.infinitePlane = universe.info.infinitePlane;
+    std::strcpy(settings.rule, rule.c_str());
+    settings.NoteChanges(before);
+
+    CacheBrushes();
+    displayGrid = Grid(settings.gridSize, settings.gridSize);
+    displayColors = ByteGrid();
+    UpdateNeighborCounts();
+    pyramidValid = false;
+
+    worker->Load(MakeConfig(), std::move(universe));
+
+    InvalidateAll();
     return true;
 }
 
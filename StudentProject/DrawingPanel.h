@@ -8,6 +8,15 @@
 #include <wx/wx.h>
 #include <vector>
 #include "Settings.h"
+#include "Grid.h"
+#include "SparseUniverse.h"
+#include "PixelRenderer.h"
+#include "Camera.h"
+#include "DensityPyramid.h"
+#include "SimulationWorker.h"
+#include "PerfCounters.h"
+#include <chrono>
+#include <memory>
 #include "LangtonsAnt.h"
 #include <wx/filedlg.h>
 #include <fstream>
@@ -15,6 +24,7 @@
 
 const int ID_SAVE_UNIVERSE = wxID_HIGHEST + 1;
 const int ID_IMPORT_PATTERN = wxID_HIGHEST + 2;
+const int ID_LOAD_UNIVERSE = wxID_HIGHEST + 3;
 
 class DrawingPanel : public wxPanel
 {
@@ -22,35 +32,134 @@ public:
     DrawingPanel(wxWindow* parent, const Settings& settingsRef);
     ~DrawingPanel();
 
-    void StepSimulation();
+    void StepSimulation(uint64_t steps = 1);
     void ClearGrid();
+    void Play();
+    void Pause();
+    bool IsRunning() const;
+    uint64_t GetGenerationCount() const;
+
+    // Time travel for a lone Langton's ant, back and forth between the last
+    // edit and the furthest generation reached since
+    void StepBack(uint64_t steps = 1);
+    void SeekTo(uint64_t generation);
+    bool CanRewind() const;
+    uint64_t GetTimelineStart() const;
+    uint64_t GetTimelineEnd() const;
+
+    // Picks up the worker's newest snapshot; returns false if nothing new arrived
+    bool ConsumeSnapshot();
+
+    // Samples the performance counters about once a second and redraws the
+    // HUD with them. Called every frame; does nothing without ANT_PERF.
+    void UpdatePerfHUD();
     void UpdateSettings(const Settings& newSettings);
     void SetShowNeighborCount(bool show);
 
     bool ImportPatternFromFile(const wxString& filename);
 
+    // Camera: the wheel zooms, dragging pans, and these reset or follow
+    void ZoomToFit();
+    void SetFollowAnt(bool follow);
+    bool GetFollowAnt() const { return followAnt; }
+
+    // Universe files hold the cells, ants, generation and rule. Loading one
+    // takes its rule and grid size (plane files keep the current view size).
+    // Saving returns at once; the worker writes the file and a failure is
+    // reported in a message box once it is done.
+    void SaveUniverse(const wxString& filename);
+    bool LoadUniverse(const wxString& filename);
+    const Settings& GetSettings() const { return settings; }
+
+    // Where the worker writes automatic checkpoints (settings.checkpointSeconds)
+    static constexpr const char* kCheckpointDirectory = "checkpoints";
+
 private:
     void OnPaint(wxPaintEvent& event);
+    void OnSize(wxSizeEvent& event);
     void OnMouseClick(wxMouseEvent& event);
+    void OnLeftUp(wxMouseEvent& event);      // Flips a cell unless the press became a drag
+    void OnMouseMove(wxMouseEvent& event);   // Pans while dragging
+    void OnMouseWheel(wxMouseEvent& event);  // Zooms around the mouse
+    void OnRightClick(wxMouseEvent& event);  // Places or removes an ant
     void OnImportPattern(wxCommandEvent& event);
 
+    // Full rebuild of every count; only needed after load, import or resize
     void UpdateNeighborCounts();
 
+    // Adjusts the 8 neighbors of one flipped cell by +1 or -1
+    void ApplyNeighborChange(int64_t row, int64_t col, bool alive);
+
+    // Debug builds check the incremental counts against a full rebuild
+    void VerifyNeighborCounts() const;
+
+    // Reads the displayed view. In plane mode the view is plane cells [0, gridSize) on both axes.
+    bool CellAlive(int row, int col) const;
+    int CellColor(int row, int col) const;  // Turmite color, or 0/1 for Langton's ant
+
+    SimulationConfig MakeConfig() const;
+
+    // Cell under a mouse position; false when it falls outside the grid
+    bool CellAt(const wxPoint& position, int& row, int& col) const;
+
     void OnSaveUniverse(wxCommandEvent& event);
     void OnLoadUniverse(wxCommandEvent& event);
 
-    bool SaveUniverse(const wxString& filename);
-    bool LoadUniverse(const wxString& filename);
-
     // New helper to draw the HUD
-    void DrawHUD(wxPaintDC& dc);
+    void DrawHUD(wxDC& dc);
+
+    // Rendering goes through a persistent backing bitmap. Flipped cells are
+    // redrawn into it and only their rectangles are sent to the screen.
+    void RenderBackBuffer(const wxSize& size);
+    void RenderPixels(const wxSize& size);
+    void DrawCell(wxDC& dc, int row, int col);
+    wxRect CellRect(int row, int col) const;
+    void InvalidateCells(const std::vector<CellChange>& changes);
+    void InvalidateAll();
+    void CacheBrushes();
+    bool DrawsPixels() const;  // Pixel renderer instead of cell rectangles
+    void FollowAnt();          // Recenters on the ant when following and it nears the edge
 
     Settings settings;
-    std::vector<std::vector<bool>> grid;
-    std::vector<std::vector<int>> neighborCounts;
-    LangtonsAnt* ant;
+    std::unique_ptr<SimulationWorker> worker;  // Runs the ant on its own thread
+    Grid displayGrid;                       // The view as of the last consumed snapshot
+    ByteGrid displayColors;                 // Cell colors of the view for turmite rules (empty otherwise)
+    size_t antCount = 1;                    // Ants in the colony as of the last snapshot
+    bool checkpointWarned = false;          // Told the user checkpoints are failing (until one works again)
+    std::vector<int> neighborCounts;        // gridSize * gridSize counts, row-major
     bool showNeighborCount;
 
+    wxBitmap backBuffer;           // Every cell, drawn at the current panel size
+    bool backBufferValid = false;  // False when the whole bitmap must be redrawn
+    std::vector<wxBrush> cellBrushes;  // One per cell color, cached so painting never builds a brush per cell
+    wxRect hudRect;                // Where the HUD was last drawn
+
+    PixelRenderer pixelRenderer;         // Used instead of cell rectangles when settings.pixelRenderer is on
+    std::vector<unsigned char> pixels;   // RGB buffer the pixel renderer writes into
+    wxBrush outsideBrush;                // Past the universe's edge
+
+    Camera camera;                   // Which cells the view shows, and how big
+    bool cameraFitted = true;        // Refit to the window on every rebuild until the user zooms or pans
+    bool followAnt = false;
+    int64_t antRow = 0, antCol = 0;  // First ant as of the last snapshot
+    DensityPyramid pyramid;          // Living-cell counts of displayGrid for zoomed-out frames
+    bool pyramidValid = false;       // False until built after the last full snapshot
+
+#if ANT_PERF
+    PerfSampler perfSampler;
+    PerfReport perfReport;           // The last second, as shown in the HUD
+    std::chrono::steady_clock::time_point perfSampled;
+    uint64_t ViewMemoryBytes() const;
+#endif
+
+    bool leftDown = false;           // Left button pressed in the panel
+    bool dragging = false;           // ... and moved far enough to pan instead of click
+    wxPoint dragOrigin, dragLast;
+
+    static constexpr double kZoomStep = 1.25;      // Scale change per wheel notch
+    static constexpr int kDragThreshold = 4;       // Pixels of movement that turn a click into a drag
+    static constexpr double kMinCellPixels = 3.0;  // Smaller cells are drawn by the pixel renderer
+
     wxDECLARE_EVENT_TABLE();
 
     // Optional: prevent copying
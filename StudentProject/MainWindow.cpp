@@ -2,6 +2,9 @@
 
 #include "MainWindow.h"
 #include "SettingsDialog.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstdlib>
 #include "play.xpm"
 #include "pause.xpm"
 #include "next.xpm"
@@ -19,37 +22,70 @@ enum
     ID_ResetSettings,
     ID_ImportPattern,  // new ID for Import Pattern
     ID_ToggleHUD,      // new ID for Show HUD menu item
-    ID_SaveUniverse = wxID_HIGHEST + 1,
-    ID_LoadUniverse
+    ID_SaveUniverse = ID_SAVE_UNIVERSE,  // Same ids as the panel's handlers
+    ID_LoadUniverse = ID_LOAD_UNIVERSE,
+    ID_ResumeCheckpoint,
+    ID_SaveSettingsTimer,
+    ID_FollowAnt,
+    ID_ZoomToFit,
+    ID_RecordTrace,
+    ID_SaveTrace,
+    ID_StepBack,
+    ID_Timeline
 };
 
 wxBEGIN_EVENT_TABLE(MainWindow, wxFrame)
 EVT_MENU(ID_Play, MainWindow::OnPlay)
 EVT_MENU(ID_Pause, MainWindow::OnPause)
 EVT_MENU(ID_Step, MainWindow::OnStep)
+EVT_MENU(ID_StepBack, MainWindow::OnStepBack)
+EVT_SLIDER(ID_Timeline, MainWindow::OnScrub)
 EVT_MENU(ID_Clear, MainWindow::OnClear)
 EVT_TIMER(ID_Timer, MainWindow::OnTimer)
+EVT_TIMER(ID_SaveSettingsTimer, MainWindow::OnSaveSettingsTimer)
 EVT_MENU(ID_Settings, MainWindow::OnSettings)
 EVT_MENU(ID_ResetSettings, MainWindow::OnResetSettings)
 EVT_MENU(ID_ImportPattern, MainWindow::OnImportPattern)  // new event
+EVT_MENU(ID_SaveUniverse, MainWindow::OnSaveUniverse)
+EVT_MENU(ID_LoadUniverse, MainWindow::OnLoadUniverse)
+EVT_MENU(ID_ResumeCheckpoint, MainWindow::OnResumeCheckpoint)
+EVT_MENU(ID_FollowAnt, MainWindow::OnFollowAnt)
+EVT_MENU(ID_ZoomToFit, MainWindow::OnZoomToFit)
+EVT_MENU(ID_RecordTrace, MainWindow::OnRecordTrace)
+EVT_MENU(ID_SaveTrace, MainWindow::OnSaveTrace)
 EVT_MENU(ID_ToggleHUD, MainWindow::OnToggleHUD)     
 // new event
 wxEND_EVENT_TABLE()
 
 MainWindow::MainWindow()
-    : wxFrame(nullptr, wxID_ANY, "Langton's Ant", wxDefaultPosition, wxSize(800, 800)),
-    generationCount(0)
+    : wxFrame(nullptr, wxID_ANY, "Langton's Ant", wxDefaultPosition, wxSize(800, 800))
 {
+    // Tracing from launch: ANT_TRACE names the file written at exit
+    Trace().NameThread("UI");
+    if (const char* path = std::getenv("ANT_TRACE"))
+    {
+        if (*path)
+            tracePath = path;
+        Trace().Start();
+    }
+
     settings.LoadSettings();
 
     timer = new wxTimer(this, ID_Timer);
+    saveSettingsTimer = new wxTimer(this, ID_SaveSettingsTimer);
 
     // Setup toolbar
     toolBar = CreateToolBar();
     toolBar->AddTool(ID_Play, "Play", wxBitmap(play_xpm), "Start Simulation");
     toolBar->AddTool(ID_Pause, "Pause", wxBitmap(pause_xpm), "Pause Simulation");
+    toolBar->AddTool(ID_StepBack, "Step Back", wxBitmap(wxImage(next_xpm).Mirror()), "Undo One Step");
     toolBar->AddTool(ID_Step, "Step", wxBitmap(next_xpm), "Advance One Step");
     toolBar->AddTool(ID_Clear, "Clear", wxBitmap(trash_xpm), "Clear Grid");
+    toolBar->AddSeparator();
+    timelineSlider = new wxSlider(toolBar, ID_Timeline, kTimelinePositions, 0, kTimelinePositions,
+        wxDefaultPosition, wxSize(300, -1));
+    timelineSlider->SetToolTip("Scrub through the ant's history since the last edit");
+    toolBar->AddControl(timelineSlider);
     toolBar->Realize();
     toolBar->SetSize(wxSize(800, 50));
 
@@ -65,20 +101,28 @@ MainWindow::MainWindow()
     wxMenu* optionsMenu = new wxMenu();
     optionsMenu->Append(ID_Settings, "Settings");
     optionsMenu->Append(ID_ResetSettings, "Reset Settings");
+    optionsMenu->AppendSeparator();
+    optionsMenu->AppendCheckItem(ID_RecordTrace, "Record Trace", "Record a timeline of frames, simulation batches, paints and file I/O");
+    optionsMenu->Append(ID_SaveTrace, "Save Trace...", "Save the recorded timeline for chrome://tracing or ui.perfetto.dev");
     menuBar->Append(optionsMenu, "Options");
 
     // View menu with Show HUD option (checkable)
     wxMenu* viewMenu = new wxMenu();
     viewMenu->AppendCheckItem(ID_ToggleHUD, "Show HUD");
+    viewMenu->AppendSeparator();
+    viewMenu->Append(ID_ZoomToFit, "Zoom to Fit\tCtrl+0", "Show the whole universe (the wheel zooms, dragging pans)");
+    viewMenu->AppendCheckItem(ID_FollowAnt, "Follow Ant", "Keep the first ant in view");
     menuBar->Append(viewMenu, "View");
 
     SetMenuBar(menuBar);
 
     fileMenu->Append(ID_SaveUniverse, "Save Universe...\tCtrl+S");
     fileMenu->Append(ID_LoadUniverse, "Load Universe...\tCtrl+O");
+    fileMenu->Append(ID_ResumeCheckpoint, "Resume Last Checkpoint", "Load the newest automatic checkpoint");
 
     // Set initial check state for Show HUD menu item
     menuBar->Check(ID_ToggleHUD, settings.ShowHUD);
+    menuBar->Check(ID_RecordTrace, Trace().Enabled());
 
     // Create drawing panel for simulation
     drawingPanel = new DrawingPanel(this, settings);
@@ -86,63 +130,102 @@ MainWindow::MainWindow()
     // Status bar
     CreateStatusBar(2);
     UpdateStatusBar();
+    UpdateTimeline();
     SetStatusText("Ready", 1);
+
+    // The simulation runs on the panel's worker thread; this timer only
+    // picks up its snapshots at display rate
+    timer->Start(kFrameIntervalMs);
 }
 
 MainWindow::~MainWindow()
 {
-    settings.SaveSettings();
+    // A save still waiting on its timer happens now
+    if (settingsDirty)
+        settings.SaveSettings();
+
+    // So does a trace still recording
+    if (Trace().Enabled())
+        Trace().WriteJson(tracePath);
+    delete saveSettingsTimer;
     delete timer;
 }
 
 void MainWindow::OnPlay(wxCommandEvent& /*event*/)
 {
-    timer->Start(settings.intervalMs);
+    drawingPanel->Play();
     SetStatusText("Simulation Running", 1);
 }
 
 void MainWindow::OnPause(wxCommandEvent& /*event*/)
 {
-    timer->Stop();
+    drawingPanel->Pause();
     SetStatusText("Simulation Paused", 1);
 }
 
 void MainWindow::OnStep(wxCommandEvent& /*event*/)
 {
     drawingPanel->StepSimulation();
-    ++generationCount;
-    UpdateStatusBar();
+}
+
+void MainWindow::OnStepBack(wxCommandEvent& /*event*/)
+{
+    PauseForTimeTravel();
+    drawingPanel->StepBack();
+}
+
+// Slider positions split the timeline evenly; the last one is its end
+void MainWindow::OnScrub(wxCommandEvent& /*event*/)
+{
+    PauseForTimeTravel();
+    const uint64_t start = drawingPanel->GetTimelineStart();
+    const uint64_t length = drawingPanel->GetTimelineEnd() - start;
+    const uint64_t position = uint64_t(timelineSlider->GetValue());
+    drawingPanel->SeekTo(start + uint64_t((long double)length * position / kTimelinePositions + 0.5L));
+}
+
+// Running on would carry the ant straight back to where it was
+void MainWindow::PauseForTimeTravel()
+{
+    if (!drawingPanel->IsRunning())
+        return;
+    drawingPanel->Pause();
+    SetStatusText("Simulation Paused", 1);
 }
 
 void MainWindow::OnClear(wxCommandEvent& /*event*/)
 {
     drawingPanel->ClearGrid();
-    generationCount = 0;
-    UpdateStatusBar();
     SetStatusText("Ready", 1);
 }
 
 void MainWindow::OnTimer(wxTimerEvent& /*event*/)
 {
-    drawingPanel->StepSimulation();
-    ++generationCount;
-    UpdateStatusBar();
+    ANT_TRACE_SCOPE("OnTimer");
+    // Show whatever the worker produced since the last frame
+    if (drawingPanel->ConsumeSnapshot())
+    {
+        UpdateStatusBar();
+        UpdateTimeline();
+    }
+    drawingPanel->UpdatePerfHUD();
 }
 
 void MainWindow::OnSettings(wxCommandEvent& /*event*/)
 {
-    settings.LoadSettings();
-
+    // The settings in memory are current; the file is only written from them
+    const Settings before = settings;
     SettingsDialog dlg(this, wxID_ANY, "Settings", &settings);
     if (dlg.ShowModal() == wxID_OK)
     {
-        if (timer->IsRunning())
-            timer->Start(settings.intervalMs);
+        settings.NoteChanges(before);
+        if (settings.revision == before.revision)
+            return;
 
         drawingPanel->UpdateSettings(settings);
         drawingPanel->Refresh();
 
-        settings.SaveSettings();
+        ScheduleSettingsSave();
 
         // Update status bar in case ShowHUD changed
         UpdateStatusBar();
@@ -154,14 +237,13 @@ void MainWindow::OnSettings(wxCommandEvent& /*event*/)
 
 void MainWindow::OnResetSettings(wxCommandEvent& /*event*/)
 {
-    timer->Stop();
+    drawingPanel->Pause();
     settings.ResetToDefaults();
-    settings.SaveSettings();
+    ScheduleSettingsSave();
 
     drawingPanel->UpdateSettings(settings);
     drawingPanel->ClearGrid();
 
-    generationCount = 0;
     UpdateStatusBar();
     drawingPanel->Refresh();
 
@@ -174,7 +256,7 @@ void MainWindow::OnResetSettings(wxCommandEvent& /*event*/)
 void MainWindow::OnImportPattern(wxCommandEvent& /*event*/)
 {
     wxFileDialog openFileDialog(this, _("Open pattern file"), "", "",
-        "Pattern files (*.txt;*.pat)|*.txt;*.pat|All files (*.*)|*.*",
+        "Pattern files (*.txt;*.pat;*.cells;*.rle)|*.txt;*.pat;*.cells;*.rle|All files (*.*)|*.*",
         wxFD_OPEN | wxFD_FILE_MUST_EXIST);
 
     if (openFileDialog.ShowModal() == wxID_CANCEL)
@@ -188,11 +270,70 @@ void MainWindow::OnImportPattern(wxCommandEvent& /*event*/)
     }
 }
 
+void MainWindow::OnSaveUniverse(wxCommandEvent& /*event*/)
+{
+    wxFileDialog saveFileDialog(this, _("Save universe file"), "", "",
+        "Universe files (*.uni)|*.uni|All files (*.*)|*.*",
+        wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+
+    if (saveFileDialog.ShowModal() == wxID_CANCEL)
+        return; // user cancelled
+
+    drawingPanel->SaveUniverse(saveFileDialog.GetPath());  // Reports a failure itself
+}
+
+void MainWindow::OnLoadUniverse(wxCommandEvent& /*event*/)
+{
+    wxFileDialog openFileDialog(this, _("Open universe file"), "", "",
+        "Universe files (*.uni)|*.uni|All files (*.*)|*.*",
+        wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+
+    if (openFileDialog.ShowModal() == wxID_CANCEL)
+        return; // user cancelled
+
+    if (!LoadUniverse(openFileDialog.GetPath()))
+        wxMessageBox("Failed to load universe from file.", "Error", wxOK | wxICON_ERROR);
+}
+
+void MainWindow::OnResumeCheckpoint(wxCommandEvent& /*event*/)
+{
+    // The newest checkpoint that reads back; one cut short by a crash is skipped
+    const std::string path = Checkpointer::FindLatest(DrawingPanel::kCheckpointDirectory);
+    if (path.empty())
+    {
+        wxMessageBox("No checkpoint to resume from. Turn on checkpoints in the settings.", "Resume", wxOK | wxICON_INFORMATION);
+        return;
+    }
+
+    if (!LoadUniverse(path))
+        wxMessageBox("Failed to load the checkpoint.", "Error", wxOK | wxICON_ERROR);
+}
+
+bool MainWindow::LoadUniverse(const wxString& path)
+{
+    if (!drawingPanel->LoadUniverse(path))
+        return false;
+
+    // The file brought its own size and rule; keep them for the settings dialog
+    const Settings& loaded = drawingPanel->GetSettings();
+    settings.gridSize = loaded.gridSize;
+    settings.infinitePlane = loaded.infinitePlane;
+    std::strcpy(settings.rule, loaded.rule);
+    settings.revision = loaded.revision;
+    settings.universeRevision = loaded.universeRevision;
+    ScheduleSettingsSave();
+    UpdateStatusBar();
+    return true;
+}
+
 void MainWindow::OnToggleHUD(wxCommandEvent& /*event*/)
 {
-    // Toggle ShowHUD setting and save
+    // Toggle ShowHUD setting and save; only the HUD changed, so the panel keeps its universe
+    const Settings before = settings;
     settings.ShowHUD = !settings.ShowHUD;
-    settings.SaveSettings();
+    settings.NoteChanges(before);
+    drawingPanel->UpdateSettings(settings);
+    ScheduleSettingsSave();
 
     // Update menu check state to reflect new value
     GetMenuBar()->Check(ID_ToggleHUD, settings.ShowHUD);
@@ -204,14 +345,82 @@ void MainWindow::OnToggleHUD(wxCommandEvent& /*event*/)
     UpdateStatusBar();
 }
 
+// Changes made within kSettingsSaveDelayMs of each other are written once
+void MainWindow::ScheduleSettingsSave()
+{
+    settingsDirty = true;
+    saveSettingsTimer->StartOnce(kSettingsSaveDelayMs);
+}
+
+void MainWindow::OnSaveSettingsTimer(wxTimerEvent& /*event*/)
+{
+    if (settingsDirty && settings.SaveSettings())
+        settingsDirty = false;
+}
+
+void MainWindow::OnFollowAnt(wxCommandEvent& event)
+{
+    drawingPanel->SetFollowAnt(event.IsChecked());
+}
+
+void MainWindow::OnZoomToFit(wxCommandEvent& /*event*/)
+{
+    drawingPanel->ZoomToFit();
+}
+
+void MainWindow::OnRecordTrace(wxCommandEvent& event)
+{
+    if (event.IsChecked())
+    {
+        Trace().Start();
+        SetStatusText("Recording trace", 1);
+    }
+    else
+    {
+        Trace().Stop();
+        SetStatusText("Trace stopped", 1);
+    }
+}
+
+void MainWindow::OnSaveTrace(wxCommandEvent& /*event*/)
+{
+    wxFileDialog saveFileDialog(this, _("Save trace file"), "", kTraceFile,
+        "Chrome trace files (*.json)|*.json|All files (*.*)|*.*",
+        wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+
+    if (saveFileDialog.ShowModal() == wxID_CANCEL)
+        return; // user cancelled
+
+    if (!Trace().WriteJson(saveFileDialog.GetPath().ToStdString()))
+        wxMessageBox("Failed to save the trace.", "Error", wxOK | wxICON_ERROR);
+}
+
 void MainWindow::UpdateStatusBar()
 {
     if (settings.ShowHUD)
     {
-        SetStatusText("Generation: " + std::to_string(generationCount), 0);
+        SetStatusText("Generation: " + std::to_string(drawingPanel->GetGenerationCount()), 0);
     }
     else
     {
         SetStatusText("", 0);
     }
+}
+
+// The slider and the step back button only work while the universe can be rewound
+void MainWindow::UpdateTimeline()
+{
+    const bool canRewind = drawingPanel->CanRewind();
+    toolBar->EnableTool(ID_StepBack, canRewind);
+    timelineSlider->Enable(canRewind);
+
+    // An empty timeline (nothing run since the last edit) sits at its end
+    const uint64_t start = drawingPanel->GetTimelineStart();
+    const uint64_t end = drawingPanel->GetTimelineEnd();
+    const uint64_t generation = std::min(std::max(drawingPanel->GetGenerationCount(), start), end);
+    int position = kTimelinePositions;
+    if (end > start)
+        position = int((long double)(generation - start) * kTimelinePositions / (end - start) + 0.5L);
+    if (timelineSlider->GetValue() != position)
+        timelineSlider->SetValue(position);
 }
\ No newline at end of file
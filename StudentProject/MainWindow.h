@@ -1,7 +1,7 @@
 // Defines the main application window.
 // Handles UI elements like toolbar and simulation controls,
 // contains the drawing panel for Langton's Ant simulation,
-// and manages the timer for automatic simulation steps.
+// and runs the frame timer that shows the simulation's progress.
 
 #pragma once
 
@@ -19,13 +19,20 @@ public:
 
 private:
     // Simulation control event handlers
-    void OnPlay(wxCommandEvent& event);    // Start the simulation timer
-    void OnPause(wxCommandEvent& event);   // Stop the simulation timer
+    void OnPlay(wxCommandEvent& event);    // Start the simulation
+    void OnPause(wxCommandEvent& event);   // Pause the simulation
     void OnStep(wxCommandEvent& event);    // Advance simulation by one step
+    void OnStepBack(wxCommandEvent& event);  // Undo one step
+    void OnScrub(wxCommandEvent& event);   // Timeline slider moved: seek to its generation
     void OnClear(wxCommandEvent& event);   // Clear the simulation grid
-    void OnTimer(wxTimerEvent& event);     // Timer event: update simulation step
+    void OnTimer(wxTimerEvent& event);     // Frame timer: show the latest simulation snapshot
+    void OnSaveSettingsTimer(wxTimerEvent& event);  // Writes settings changed since the last save
 
     void OnImportPattern(wxCommandEvent& event);
+    void OnSaveUniverse(wxCommandEvent& event);
+    void OnLoadUniverse(wxCommandEvent& event);
+    void OnResumeCheckpoint(wxCommandEvent& event);  // Load the newest automatic checkpoint
+    bool LoadUniverse(const wxString& path);        // Loads into the panel and keeps the file's size and rule
 
     // Settings dialog handlers
     void OnSettings(wxCommandEvent& event);       // Open settings dialog
@@ -34,18 +41,38 @@ private:
     // HUD related handler
     void OnToggleHUD(wxCommandEvent& event);      // Toggle HUD visibility
 
+    // Camera handlers
+    void OnFollowAnt(wxCommandEvent& event);      // Keep the first ant in view
+    void OnZoomToFit(wxCommandEvent& event);      // Show the whole universe again
+
+    // Timeline tracing handlers
+    void OnRecordTrace(wxCommandEvent& event);    // Start or stop recording
+    void OnSaveTrace(wxCommandEvent& event);      // Write the recording as a Chrome trace
+
     void UpdateStatusBar();  // Update status bar with current generation count
+    void UpdateTimeline();   // Moves the timeline slider to the current generation
+    void PauseForTimeTravel();
+    void ScheduleSettingsSave();  // Saves the settings once changes stop coming
 
     // UI components
     wxToolBar* toolBar = nullptr;          // Toolbar with control buttons
+    wxSlider* timelineSlider = nullptr;    // Scrubs from the last edit to the furthest generation reached
     DrawingPanel* drawingPanel = nullptr;  // Panel where grid and ant are drawn
-    wxTimer* timer = nullptr;              // Timer for automatic simulation steps
+    wxTimer* timer = nullptr;              // Frame timer that picks up simulation snapshots
+    wxTimer* saveSettingsTimer = nullptr;  // One-shot timer behind ScheduleSettingsSave
+
+    static constexpr int kFrameIntervalMs = 16;  // About 60 frames per second
+    static constexpr int kSettingsSaveDelayMs = 1000;
+    static constexpr int kTimelinePositions = 1000;  // Slider steps; each covers 1/1000 of the timeline
 
-    // Simulation state
-    int generationCount = 0;  // Tracks number of simulation steps taken
+    // A recording still running at exit is written here (or to $ANT_TRACE,
+    // which also starts recording at launch)
+    static constexpr const char* kTraceFile = "trace.json";
+    std::string tracePath = kTraceFile;
 
     // Configuration
     Settings settings;  // Holds current simulation settings
+    bool settingsDirty = false;  // Changed since the last save
 
     wxDECLARE_EVENT_TABLE();
 };
\ No newline at end of file
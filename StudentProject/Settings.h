@@ -2,7 +2,58 @@
 #define SETTINGS_H
 
 #include <wx/colour.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <iterator>
+#include <string>
+#include "Turmite.h"
+
+// settings.bin starts with this magic and version, followed by tagged fields:
+// a 32-bit tag, a 32-bit size and that many bytes. Fields with unknown tags are
+// skipped and missing ones keep their defaults, so new fields never break old
+// files. Files without the magic are the raw struct dumps of earlier versions;
+// only their leading fields (colors, grid size, interval) had a stable layout.
+namespace SettingsFile
+{
+    const char kMagic[4] = { 'A', 'N', 'T', 'S' };
+    const uint32_t kVersion = 2;
+
+    enum Tag : uint32_t
+    {
+        kLivingColor = 1,
+        kDeadColor,
+        kGridSize,
+        kIntervalMs,
+        kShowHUD,
+        kStepsPerFrame,
+        kInfinitePlane,
+        kPixelRenderer,
+        kRule,
+        kPalette,
+        kCheckpointSeconds,
+        kResizeCentered
+    };
+
+    template <typename T>
+    void Put(std::string& out, uint32_t tag, const T& value)
+    {
+        const uint32_t size = sizeof(T);
+        out.append(reinterpret_cast<const char*>(&tag), sizeof(tag));
+        out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    // Copies a field of exactly the expected size; anything else keeps the default
+    template <typename T>
+    void Take(const char* data, uint32_t size, T& value)
+    {
+        if (size == sizeof(T))
+            std::memcpy(&value, data, sizeof(T));
+    }
+}
 
 struct Settings
 {
@@ -18,15 +69,73 @@ struct Settings
     unsigned int deadCellBlue = 255;
     unsigned int deadCellAlpha = 255;
 
-    // Grid size (number of cells per row/column)
+    // Grid size (number of cells per row/column). The dialog allows up to 4096;
+    // a loaded universe file can bring anything up to kMaxGridSize.
+    static constexpr int kMaxGridSize = 65536;
     int gridSize = 15;
 
-    // Timer interval in milliseconds between simulation steps
+    // Time in milliseconds between step batches (0 = run as fast as possible)
     int intervalMs = 50;
 
     // New: Show Heads Up Display (HUD) or not
     bool ShowHUD = false;  // This will be saved and loaded via LoadSettings/SaveSettings
 
+    // Number of ant steps run per batch (the panel repaints at display rate, not per batch)
+    int stepsPerFrame = 1;
+
+    // Run on an unbounded plane instead of a wrapping grid (gridSize is then just the view size)
+    bool infinitePlane = false;
+
+    // Draw the universe as a scaled image instead of one rectangle per cell
+    // (much faster for large universes; neighbor counts are not drawn)
+    bool pixelRenderer = false;
+
+    // Turmite rule: "RL" is Langton's ant. Other turn strings ("LLRR", "RLR", ...)
+    // or a {{{write, turn, next}, ...}} state table run the multi-color turmite engine.
+    char rule[64] = "RL";
+
+    // Colors for cell colors 2 and up as 0xRRGGBB (0 uses the dead color, 1 the living color)
+    static constexpr int kPaletteSize = kMaxTurmiteColors - 2;
+    unsigned int paletteColors[kPaletteSize] = {
+        0xE53935, 0x43A047, 0x1E88E5, 0xFDD835, 0x8E24AA, 0x00ACC1, 0xFB8C00,
+        0x6D4C41, 0xD81B60, 0x00897B, 0x7CB342, 0x3949AB, 0x546E7A, 0x000000
+    };
+
+    // Save the universe in the background every this many seconds while it runs (0 = never)
+    int checkpointSeconds = 0;
+
+    // A new grid size keeps the universe and its ants centered (false: anchored at the top-left)
+    bool resizeCentered = true;
+
+    // Not saved. Bumped by NoteChanges: revision on any change, universeRevision
+    // when the universe itself must be rebuilt (size, plane mode or rule), so
+    // the panel can skip the rebuild when only colors or timing changed.
+    uint64_t revision = 0;
+    uint64_t universeRevision = 0;
+
+    // Bumps the revisions for whatever differs from before
+    void NoteChanges(const Settings& before)
+    {
+        static uint64_t counter = 0;  // Shared by every copy, so revisions never repeat
+        if (gridSize != before.gridSize || infinitePlane != before.infinitePlane || std::strcmp(rule, before.rule) != 0)
+            universeRevision = ++counter;
+        if (!SameValues(before))
+            revision = ++counter;
+    }
+
+    bool SameValues(const Settings& other) const
+    {
+        return livingCellRed == other.livingCellRed && livingCellGreen == other.livingCellGreen
+            && livingCellBlue == other.livingCellBlue && livingCellAlpha == other.livingCellAlpha
+            && deadCellRed == other.deadCellRed && deadCellGreen == other.deadCellGreen
+            && deadCellBlue == other.deadCellBlue && deadCellAlpha == other.deadCellAlpha
+            && gridSize == other.gridSize && intervalMs == other.intervalMs && ShowHUD == other.ShowHUD
+            && stepsPerFrame == other.stepsPerFrame && infinitePlane == other.infinitePlane
+            && pixelRenderer == other.pixelRenderer && std::strcmp(rule, other.rule) == 0
+            && std::memcmp(paletteColors, other.paletteColors, sizeof(paletteColors)) == 0
+            && checkpointSeconds == other.checkpointSeconds && resizeCentered == other.resizeCentered;
+    }
+
     // Return wxColour for living cells from RGBA components
     wxColour GetLivingCellColor() const
     {
@@ -39,6 +148,24 @@ struct Settings
         return wxColour(deadCellRed, deadCellGreen, deadCellBlue, deadCellAlpha);
     }
 
+    // Color of a cell color index: the dead color, the living color, then the palette
+    wxColour GetCellColor(int color) const
+    {
+        if (color <= 0)
+            return GetDeadCellColor();
+        if (color == 1)
+            return GetLivingCellColor();
+
+        const unsigned int rgb = paletteColors[(color - 2) % kPaletteSize];
+        return wxColour((rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF);
+    }
+
+    void SetPaletteColor(int color, const wxColour& c)
+    {
+        if (color >= 2 && color - 2 < kPaletteSize)
+            paletteColors[color - 2] = (c.Red() << 16) | (c.Green() << 8) | c.Blue();
+    }
+
     // Set living cell color from wxColour object
     void SetLivingCellColor(const wxColour& c)
     {
@@ -57,30 +184,109 @@ struct Settings
         deadCellAlpha = c.Alpha();
     }
 
-    // Load settings from binary file "settings.bin"
+    // Load settings from "settings.bin". Missing or broken fields keep
+    // their defaults and out-of-range values are clamped.
     void LoadSettings()
     {
+        using namespace SettingsFile;
+
         std::ifstream file("settings.bin", std::ios::binary | std::ios::in);
-        if (file.is_open())
+        if (!file.is_open())
+            return;
+        const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        const Settings before = *this;
+
+        if (data.size() < sizeof(kMagic) + sizeof(uint32_t) || std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0)
         {
-            file.read(reinterpret_cast<char*>(this), sizeof(Settings));
-            file.close();
+            // An old raw dump: 8 color components, the grid size and the interval
+            unsigned int colors[8];
+            int sizes[2];
+            if (data.size() >= sizeof(colors) + sizeof(sizes))
+            {
+                std::memcpy(colors, data.data(), sizeof(colors));
+                std::memcpy(sizes, data.data() + sizeof(colors), sizeof(sizes));
+                SetColors(colors);
+                gridSize = sizes[0];
+                intervalMs = sizes[1];
+            }
         }
+        else
+        {
+            // Later versions only add tags, so any version is read the same way
+            for (size_t at = sizeof(kMagic) + sizeof(uint32_t); at + 2 * sizeof(uint32_t) <= data.size();)
+            {
+                uint32_t tag, size;
+                std::memcpy(&tag, data.data() + at, sizeof(tag));
+                std::memcpy(&size, data.data() + at + sizeof(tag), sizeof(size));
+                at += 2 * sizeof(uint32_t);
+                if (size > data.size() - at)
+                    break;  // Cut short; the fields before it still count
+                ReadField(tag, data.data() + at, size);
+                at += size;
+            }
+        }
+        Validate();
+        NoteChanges(before);
     }
 
-    // Save settings to binary file "settings.bin"
-    void SaveSettings() const
+    // Save settings to "settings.bin". The file is written beside it and
+    // renamed into place, so a crash mid-save leaves the old one intact.
+    bool SaveSettings() const
     {
-        std::ofstream file("settings.bin", std::ios::binary | std::ios::out);
-        if (file.is_open())
+        using namespace SettingsFile;
+
+        std::string data(kMagic, sizeof(kMagic));
+        data.append(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
+        const unsigned int living[4] = { livingCellRed, livingCellGreen, livingCellBlue, livingCellAlpha };
+        const unsigned int dead[4] = { deadCellRed, deadCellGreen, deadCellBlue, deadCellAlpha };
+        Put(data, kLivingColor, living);
+        Put(data, kDeadColor, dead);
+        Put(data, kGridSize, gridSize);
+        Put(data, kIntervalMs, intervalMs);
+        Put(data, kShowHUD, uint8_t(ShowHUD));
+        Put(data, kStepsPerFrame, stepsPerFrame);
+        Put(data, kInfinitePlane, uint8_t(infinitePlane));
+        Put(data, kPixelRenderer, uint8_t(pixelRenderer));
+        Put(data, kRule, rule);
+        Put(data, kPalette, paletteColors);
+        Put(data, kCheckpointSeconds, checkpointSeconds);
+        Put(data, kResizeCentered, uint8_t(resizeCentered));
+
         {
-            file.write(reinterpret_cast<const char*>(this), sizeof(Settings));
-            file.close();
+            std::ofstream file("settings.bin.tmp", std::ios::binary | std::ios::out | std::ios::trunc);
+            if (!file.write(data.data(), data.size()))
+                return false;
         }
+        std::error_code error;
+        std::filesystem::rename("settings.bin.tmp", "settings.bin", error);
+        return !error;
+    }
+
+    // Clamps every field into the range the settings dialog allows
+    void Validate()
+    {
+        const Settings defaults;
+        unsigned int* components[8] = { &livingCellRed, &livingCellGreen, &livingCellBlue, &livingCellAlpha,
+            &deadCellRed, &deadCellGreen, &deadCellBlue, &deadCellAlpha };
+        for (unsigned int* component : components)
+            *component = std::min(*component, 255u);
+        if (gridSize < 1 || gridSize > kMaxGridSize)
+            gridSize = defaults.gridSize;
+        intervalMs = std::clamp(intervalMs, 0, 1000);
+        stepsPerFrame = std::clamp(stepsPerFrame, 1, 10000000);
+        checkpointSeconds = std::clamp(checkpointSeconds, 0, 86400);
+        for (unsigned int& rgb : paletteColors)
+            rgb &= 0xFFFFFF;
+
+        rule[sizeof(rule) - 1] = '\0';  // Never trust the file to terminate the string
+        TurmiteRule parsed;
+        if (!ParseTurmiteRule(std::string(rule), parsed))
+            std::strcpy(rule, defaults.rule);
     }
 
     void ResetToDefaults()
     {
+        const Settings before = *this;
         livingCellRed = 128;
         livingCellGreen = 128;
         livingCellBlue = 128;
@@ -95,6 +301,70 @@ struct Settings
         intervalMs = 50;
 
         ShowHUD = false;
+        stepsPerFrame = 1;
+        infinitePlane = false;
+        pixelRenderer = false;
+
+        const Settings defaults;
+        std::strcpy(rule, defaults.rule);
+        std::memcpy(paletteColors, defaults.paletteColors, sizeof(paletteColors));
+        checkpointSeconds = 0;
+        resizeCentered = true;
+        NoteChanges(before);
+    }
+
+private:
+    void SetColors(const unsigned int colors[8])
+    {
+        livingCellRed = colors[0];
+        livingCellGreen = colors[1];
+        livingCellBlue = colors[2];
+        livingCellAlpha = colors[3];
+        deadCellRed = colors[4];
+        deadCellGreen = colors[5];
+        deadCellBlue = colors[6];
+        deadCellAlpha = colors[7];
+    }
+
+    void ReadField(uint32_t tag, const char* data, uint32_t size)
+    {
+        using namespace SettingsFile;
+
+        unsigned int colors[8] = { livingCellRed, livingCellGreen, livingCellBlue, livingCellAlpha,
+            deadCellRed, deadCellGreen, deadCellBlue, deadCellAlpha };
+        uint8_t flag = 0;
+        switch (tag)
+        {
+        case kLivingColor:
+        case kDeadColor:
+            if (size == 4 * sizeof(unsigned int))
+            {
+                std::memcpy(colors + (tag == kLivingColor ? 0 : 4), data, size);
+                SetColors(colors);
+            }
+            break;
+        case kGridSize: Take(data, size, gridSize); break;
+        case kIntervalMs: Take(data, size, intervalMs); break;
+        case kShowHUD: Take(data, size, flag); ShowHUD = flag != 0; break;
+        case kStepsPerFrame: Take(data, size, stepsPerFrame); break;
+        case kInfinitePlane: Take(data, size, flag); infinitePlane = flag != 0; break;
+        case kPixelRenderer: Take(data, size, flag); pixelRenderer = flag != 0; break;
+        case kCheckpointSeconds: Take(data, size, checkpointSeconds); break;
+        case kResizeCentered: Take(data, size, flag); resizeCentered = flag != 0; break;
+        case kRule:
+            if (size <= sizeof(rule))
+            {
+                std::memset(rule, 0, sizeof(rule));
+                std::memcpy(rule, data, size);
+            }
+            break;
+        case kPalette:
+            // A shorter palette (from a build with fewer colors) fills the front
+            std::memcpy(paletteColors, data, std::min<size_t>(size, sizeof(paletteColors)) / sizeof(unsigned int) * sizeof(unsigned int));
+            break;
+        default:
+            break;  // A field from a newer version
+        }
     }
 };
 
@@ -52,7 +52,7 @@ SettingsDialog::SettingsDialog(wxWindow* parent, wxWindowID id, const wxString&
         gridSizeSizer->Add(label, 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 10);
 
         gridSizeSpinCtrl = new wxSpinCtrl(this, wxID_ANY, wxEmptyString, wxDefaultPosition, wxSize(80, -1));
-        gridSizeSpinCtrl->SetRange(1, 100); // Acceptable grid size range
+        gridSizeSpinCtrl->SetRange(1, 4096); // Acceptable grid size range (use the pixel renderer past ~200)
         gridSizeSpinCtrl->SetValue(settings->gridSize);
         gridSizeSizer->Add(gridSizeSpinCtrl, 0);
 
@@ -62,17 +62,95 @@ SettingsDialog::SettingsDialog(wxWindow* parent, wxWindowID id, const wxString&
     // Timer Interval input row (in milliseconds)
     {
         wxBoxSizer* intervalSizer = new wxBoxSizer(wxHORIZONTAL);
-        wxStaticText* label = new wxStaticText(this, wxID_ANY, "Interval (ms):");
+        wxStaticText* label = new wxStaticText(this, wxID_ANY, "Interval (ms, 0 = free run):");
         intervalSizer->Add(label, 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 10);
 
         intervalSpinCtrl = new wxSpinCtrl(this, wxID_ANY, wxEmptyString, wxDefaultPosition, wxSize(80, -1));
-        intervalSpinCtrl->SetRange(10, 1000); // Reasonable interval range
+        intervalSpinCtrl->SetRange(0, 1000); // 0 runs batches back to back
         intervalSpinCtrl->SetValue(settings->intervalMs);
         intervalSizer->Add(intervalSpinCtrl, 0);
 
         mainSizer->Add(intervalSizer, 0, wxEXPAND | wxALL, 5);
     }
 
+    // Steps per frame input row (how many steps each timer tick runs)
+    {
+        wxBoxSizer* stepsSizer = new wxBoxSizer(wxHORIZONTAL);
+        wxStaticText* label = new wxStaticText(this, wxID_ANY, "Steps per Frame:");
+        stepsSizer->Add(label, 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 10);
+
+        stepsPerFrameSpinCtrl = new wxSpinCtrl(this, wxID_ANY, wxEmptyString, wxDefaultPosition, wxSize(100, -1));
+        stepsPerFrameSpinCtrl->SetRange(1, 10000000); // Up to 10M steps per tick
+        stepsPerFrameSpinCtrl->SetValue(settings->stepsPerFrame);
+        stepsSizer->Add(stepsPerFrameSpinCtrl, 0);
+
+        mainSizer->Add(stepsSizer, 0, wxEXPAND | wxALL, 5);
+    }
+
+    // Where the universe ends up when the grid size changes
+    {
+        resizeCenteredCheckBox = new wxCheckBox(this, wxID_ANY, "Keep Universe Centered When Resizing");
+        resizeCenteredCheckBox->SetValue(settings->resizeCentered);
+        mainSizer->Add(resizeCenteredCheckBox, 0, wxEXPAND | wxALL, 5);
+    }
+
+    // Infinite plane toggle (the grid size then only sets how much of the plane is shown)
+    {
+        infinitePlaneCheckBox = new wxCheckBox(this, wxID_ANY, "Infinite Plane (no wraparound)");
+        infinitePlaneCheckBox->SetValue(settings->infinitePlane);
+        mainSizer->Add(infinitePlaneCheckBox, 0, wxEXPAND | wxALL, 5);
+    }
+
+    // Pixel renderer toggle for large universes
+    {
+        pixelRendererCheckBox = new wxCheckBox(this, wxID_ANY, "Pixel Renderer (fast, for large universes)");
+        pixelRendererCheckBox->SetValue(settings->pixelRenderer);
+        mainSizer->Add(pixelRendererCheckBox, 0, wxEXPAND | wxALL, 5);
+    }
+
+    // Automatic checkpoints while running (resumed from File > Resume Last Checkpoint)
+    {
+        wxBoxSizer* checkpointSizer = new wxBoxSizer(wxHORIZONTAL);
+        wxStaticText* label = new wxStaticText(this, wxID_ANY, "Checkpoint Every (s, 0 = off):");
+        checkpointSizer->Add(label, 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 10);
+
+        checkpointSpinCtrl = new wxSpinCtrl(this, wxID_ANY, wxEmptyString, wxDefaultPosition, wxSize(80, -1));
+        checkpointSpinCtrl->SetRange(0, 86400); // Up to once a day
+        checkpointSpinCtrl->SetValue(settings->checkpointSeconds);
+        checkpointSizer->Add(checkpointSpinCtrl, 0);
+
+        mainSizer->Add(checkpointSizer, 0, wxEXPAND | wxALL, 5);
+    }
+
+    // Turmite rule: a turn string like "LLRR" or a {{{write, turn, next}, ...}} state table
+    {
+        wxBoxSizer* ruleSizer = new wxBoxSizer(wxHORIZONTAL);
+        wxStaticText* label = new wxStaticText(this, wxID_ANY, "Rule:");
+        ruleSizer->Add(label, 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 10);
+
+        ruleTextCtrl = new wxTextCtrl(this, wxID_ANY, settings->rule);
+        ruleSizer->Add(ruleTextCtrl, 1, wxEXPAND);
+
+        mainSizer->Add(ruleSizer, 0, wxEXPAND | wxALL, 5);
+    }
+
+    // Palette for rules with more than two colors (colors 0 and 1 are the dead and living colors)
+    {
+        wxStaticText* label = new wxStaticText(this, wxID_ANY, "Colors 2 and up:");
+        mainSizer->Add(label, 0, wxLEFT | wxRIGHT | wxTOP, 5);
+
+        wxGridSizer* paletteSizer = new wxGridSizer(2, Settings::kPaletteSize / 2, 4, 4);
+        for (int i = 0; i < Settings::kPaletteSize; ++i)
+        {
+            wxColourPickerCtrl* picker = new wxColourPickerCtrl(this, wxID_ANY, settings->GetCellColor(i + 2),
+                wxDefaultPosition, wxSize(36, -1));
+            paletteSizer->Add(picker, 0);
+            palettePickers.push_back(picker);
+        }
+
+        mainSizer->Add(paletteSizer, 0, wxALL, 5);
+    }
+
     // Add standard OK and Cancel buttons
     wxSizer* buttonSizer = CreateButtonSizer(wxOK | wxCANCEL);
     mainSizer->Add(buttonSizer, 0, wxEXPAND | wxALL, 10);
@@ -83,6 +161,17 @@ SettingsDialog::SettingsDialog(wxWindow* parent, wxWindowID id, const wxString&
 // When OK clicked: save changes back to settings and close dialog
 void SettingsDialog::OnOkButtonClick(wxCommandEvent& WXUNUSED(event))
 {
+    // Keep the dialog open until the rule parses
+    const std::string ruleText = ruleTextCtrl->GetValue().ToStdString();
+    TurmiteRule rule;
+    if (ruleText.size() >= sizeof(settings->rule) || !ParseTurmiteRule(ruleText, rule))
+    {
+        wxMessageBox("The rule must be a turn string such as \"LLRR\" (L, R, N, U; 2 to 16 colors) "
+            "or a state table such as {{{1,8,1},{1,8,1}},{{1,2,1},{0,1,0}}}.",
+            "Invalid Rule", wxOK | wxICON_ERROR, this);
+        return;
+    }
+
     wxColour livingColor = livingCellColorPicker->GetColour();
     settings->livingCellRed = livingColor.Red();
     settings->livingCellGreen = livingColor.Green();
@@ -97,6 +186,15 @@ void SettingsDialog::OnOkButtonClick(wxCommandEvent& WXUNUSED(event))
 
     settings->gridSize = gridSizeSpinCtrl->GetValue();
     settings->intervalMs = intervalSpinCtrl->GetValue();
+    settings->stepsPerFrame = stepsPerFrameSpinCtrl->GetValue();
+    settings->resizeCentered = resizeCenteredCheckBox->GetValue();
+    settings->infinitePlane = infinitePlaneCheckBox->GetValue();
+    settings->pixelRenderer = pixelRendererCheckBox->GetValue();
+    settings->checkpointSeconds = checkpointSpinCtrl->GetValue();
+
+    std::strcpy(settings->rule, ruleText.c_str());
+    for (int i = 0; i < Settings::kPaletteSize; ++i)
+        settings->SetPaletteColor(i + 2, palettePickers[i]->GetColour());
 
     EndModal(wxID_OK);
 }
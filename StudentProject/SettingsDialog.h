@@ -9,6 +9,7 @@
 #include <wx/wx.h>
 #include <wx/spinctrl.h>
 #include <wx/clrpicker.h>
+#include <vector>
 #include "Settings.h"  // Include your Settings struct header
 
 
@@ -25,7 +26,14 @@ private:
     wxColourPickerCtrl* livingCellColorPicker; // Living cell color selector
     wxColourPickerCtrl* deadCellColorPicker;   // Dead cell color selector
     wxSpinCtrl* gridSizeSpinCtrl;               // Grid size input
+    wxCheckBox* resizeCenteredCheckBox;         // Resize around the center instead of the top-left
     wxSpinCtrl* intervalSpinCtrl;               // Timer interval input
+    wxSpinCtrl* stepsPerFrameSpinCtrl;          // Steps run per timer tick
+    wxCheckBox* infinitePlaneCheckBox;          // Unbounded plane instead of wrapping grid
+    wxCheckBox* pixelRendererCheckBox;          // Image blit instead of per-cell rectangles
+    wxSpinCtrl* checkpointSpinCtrl;             // Seconds between automatic checkpoints
+    wxTextCtrl* ruleTextCtrl;                   // Turmite rule ("RL" = Langton's ant)
+    std::vector<wxColourPickerCtrl*> palettePickers;  // Colors for cell colors 2 and up
 
     // Event handlers for dialog buttons
     void OnOkButtonClick(wxCommandEvent& event);